@@ -0,0 +1,270 @@
+/***********************************************************************
+ *  Project: db-query-generator-bench
+ *  File: bench.cpp
+ *  Date: 2026-10-17
+ *  Author: R2yH2l
+ ***********************************************************************/
+
+ /* Includes
+ ************************************************************************/
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdio>
+#include <iostream>
+
+#include "bench.h"
+#include "hashing.h"
+
+/* Helpers
+************************************************************************/
+
+void expect(bool condition, std::string_view message) {
+    if (!condition) {
+        throw check_failed{ std::string{ message } };
+    }
+}
+
+size_t argument(bench_arguments arguments, std::string_view name, size_t fallback) {
+    for (std::string_view argument : arguments) {
+        if (argument.size() > name.size() && argument.starts_with(name) && argument[name.size()] == '=') {
+            std::string_view text{ argument.substr(name.size() + 1) };
+
+            size_t value{};
+            auto [end, error] { std::from_chars(text.data(), text.data() + text.size(), value) };
+            if (error != std::errc{} || end != text.data() + text.size()) {
+                throw std::invalid_argument{ "Invalid value for " + std::string{ name } + ": " + std::string{ text } };
+            }
+
+            return value;
+        }
+    }
+
+    return fallback;
+}
+
+size_t total_rows(const std::vector<std::shared_ptr<table_info>>& tables) {
+    size_t rows{};
+    for (const auto& table : tables) {
+        rows += table->row_count();
+    }
+
+    return rows;
+}
+
+/* Synthetic Database
+************************************************************************/
+
+// A column every synthetic table may carry, with how its values are made
+struct column_template {
+    const wchar_t* name{};
+    const wchar_t* data_type{};
+    enum class values { identity, key, name, date, guid, money, small, flag, text } kind{};
+    unsigned null_percent{};
+};
+
+static constexpr std::array<column_template, 9> column_templates{ {
+    { L"ID", L"int", column_template::values::identity },
+    { L"ParentID", L"int", column_template::values::key },
+    { L"Name", L"nvarchar", column_template::values::name },
+    { L"ModifiedDate", L"datetime", column_template::values::date },
+    { L"rowguid", L"uniqueidentifier", column_template::values::guid },
+    { L"Amount", L"money", column_template::values::money },
+    { L"Quantity", L"smallint", column_template::values::small },
+    { L"Active", L"bit", column_template::values::flag },
+    { L"Comment", L"nvarchar", column_template::values::text, 40 },
+} };
+
+static constexpr std::array<const wchar_t*, 16> words{
+    L"Mountain", L"Road", L"Touring", L"Frame", L"Wheel", L"Seat", L"Chain", L"Pedal",
+    L"Black", L"Silver", L"Red", L"Large", L"Medium", L"Small", L"Classic", L"Sport",
+};
+
+// Writes the value of a field into the buffer, returning false for NULL
+static bool synthetic_value(const column_template& column, size_t row, uint64_t bits, std::wstring& value) {
+    if (column.null_percent && bits % 100 < column.null_percent) {
+        return false;
+    }
+
+    wchar_t buffer[64]{};
+    switch (column.kind) {
+    case column_template::values::identity:
+        value = std::to_wstring(row + 1);
+        break;
+    case column_template::values::key:
+        value = std::to_wstring(bits % 997 + 1);
+        break;
+    case column_template::values::name:
+        value = std::wstring{ words[bits % words.size()] } + L' ' + words[(bits >> 8) % words.size()] + L' ' + std::to_wstring(bits % 100);
+        break;
+    case column_template::values::date:
+        std::swprintf(buffer, std::size(buffer), L"20%02u-%02u-%02u %02u:%02u:%02u.000",
+            unsigned(10 + bits % 14), unsigned(1 + (bits >> 8) % 12), unsigned(1 + (bits >> 16) % 28),
+            unsigned((bits >> 24) % 24), unsigned((bits >> 32) % 60), unsigned((bits >> 40) % 60));
+        value = buffer;
+        break;
+    case column_template::values::guid:
+        std::swprintf(buffer, std::size(buffer), L"%08X-%04X-%04X-%04X-%012llX",
+            unsigned(bits), unsigned(bits >> 32) & 0xFFFF, unsigned(bits >> 48), unsigned(mix_bits(bits)) & 0xFFFF,
+            static_cast<unsigned long long>(mix_bits(bits + 1) & 0xFFFFFFFFFFFFull));
+        value = buffer;
+        break;
+    case column_template::values::money:
+        value = std::to_wstring(bits % 100000) + L'.' + std::to_wstring(1000 + (bits >> 20) % 9000) + L'0';
+        break;
+    case column_template::values::small:
+        value = std::to_wstring(bits % 1000);
+        break;
+    case column_template::values::flag:
+        value = bits & 1 ? L"1" : L"0";
+        break;
+    case column_template::values::text:
+        value.clear();
+        for (size_t word = 0; word < 3 + bits % 6; word++) {
+            value += words[(bits >> (word * 4)) % words.size()];
+            value += L' ';
+        }
+        value.pop_back();
+        break;
+    }
+
+    return true;
+}
+
+std::vector<std::shared_ptr<table_info>> synthetic_tables(size_t table_count, size_t total_rows, uint64_t seed) {
+    // Zipf-like weights: table i gets a share proportional to 1 / (i + 1)
+    double harmonic{};
+    for (size_t i = 0; i < table_count; i++) {
+        harmonic += 1.0 / double(i + 1);
+    }
+
+    std::vector<std::shared_ptr<table_info>> tables{};
+    tables.reserve(table_count);
+
+    std::wstring value{};
+    for (size_t i = 0; i < table_count; i++) {
+        uint64_t table_bits{ mix_bits(seed ^ (i + 1)) };
+        auto table{ std::make_shared<table_info>(L"Table" + std::to_wstring(i + 1), i % 3 == 0 ? L"Sales" : L"Production") };
+
+        // The identity and two to eight more columns, picked from the templates
+        std::vector<const column_template*> shape{ &column_templates[0] };
+        for (size_t k = 1; k < column_templates.size(); k++) {
+            if ((table_bits >> k) % 4 != 0 || k == 2) {
+                shape.push_back(&column_templates[k]);
+            }
+        }
+
+        for (const column_template* column : shape) {
+            table->columns.push_back(std::make_shared<column_info>(column->name, column->data_type));
+            table->columns.back()->ordinal = int(table->columns.size());
+        }
+        table->columns.front()->primary_key = true;
+
+        size_t rows{ std::max<size_t>(1, size_t(double(total_rows) / (double(i + 1) * harmonic))) };
+        table->row_estimate = rows;
+
+        for (size_t row = 0; row < rows; row++) {
+            for (size_t column = 0; column < shape.size(); column++) {
+                uint64_t bits{ mix_bits(table_bits ^ (row * shape.size() + column)) };
+
+                if (synthetic_value(*shape[column], row, bits, value)) {
+                    table->add_field(column, value);
+                }
+                else {
+                    table->add_field(column, field_value::null_field());
+                }
+            }
+            table->finish_row();
+        }
+
+        tables.push_back(std::move(table));
+    }
+
+    return tables;
+}
+
+// Table i references table i * 7, wrapping around, which spreads the keys without cycles of two
+std::vector<foreign_key> keyed_memory_source::load_foreign_keys() {
+    std::vector<foreign_key> keys{};
+
+    for (size_t i = 0; i < tables->size(); i++) {
+        const table_info& table{ *(*tables)[i] };
+        const table_info& referenced{ *(*tables)[i * 7 % tables->size()] };
+
+        for (const auto& column : table.columns) {
+            if (column->name == L"ParentID" && &table != &referenced) {
+                keys.emplace_back(foreign_key{ L"FK_" + table.name + L"_" + referenced.name, table.schema, table.name,
+                    referenced.schema, referenced.name, { column->name }, { referenced.columns.front()->name } });
+            }
+        }
+    }
+
+    return keys;
+}
+
+/* Entry Point
+************************************************************************/
+
+static constexpr std::array<bench_case, 11> cases{ {
+    { "layout", "Memory and build time of the shared_ptr row graph against the columnar table_info.", run_layout },
+    { "scheduler", "Static split against work stealing when one source is much slower than the others.", run_scheduler },
+    { "dom", "Peak heap and throughput of a DOM-shaped database document against xml_database_writer.", run_dom },
+    { "merge", "Checks merge_delta against XML and columnar snapshots when the delta updates prior keys and adds new ones.", run_merge },
+    { "factory", "Statements created per second, and heap allocations and bytes per statement.", run_factory },
+    { "render", "Renders per second of the SQL, label and template of 1M statements into one reused buffer.", run_render },
+    { "shards", "Checks that 1 and N generation threads produce identical statements from the same rows.", run_shards },
+    { "sampling", "Rows read, time and accuracy of streamed, pushed-down and stratified sampling.", run_sampling },
+    { "decode", "Per-row decode cost of looking fields up by name per cell against ordinals resolved once.", run_decode },
+    { "prefetch", "Rows per second against rows per round trip, read directly and through prefetching_reader.", run_prefetch },
+    { "replay", "Replays a generated statement set on simulated connections, in a closed and an open loop.", run_replay },
+} };
+
+static void print_usage() {
+    std::wcout << L"Usage: db-query-generator-bench <case|all> [name=value ...]\n\n";
+    for (const bench_case& entry : cases) {
+        std::wcout << L"    " << std::wstring(entry.name.begin(), entry.name.end()) << L'\n'
+            << L"        " << std::wstring(entry.summary.begin(), entry.summary.end()) << L'\n';
+    }
+    std::wcout << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        print_usage();
+        return 1;
+    }
+
+    std::string_view name{ argv[1] };
+    std::vector<std::string_view> arguments(argv + 2, argv + argc);
+
+    int result{};
+    bool found{};
+    for (const bench_case& entry : cases) {
+        if (name != "all" && name != entry.name) {
+            continue;
+        }
+        found = true;
+
+        std::wcout << L"[-] Running " << std::wstring(entry.name.begin(), entry.name.end()) << L"...\n";
+        try {
+            if (entry.run(arguments) != 0) {
+                result = 1;
+            }
+        }
+        catch (const check_failed& err) {
+            std::wcout << L"[!] Check failed: " << err.what() << L"\n\n";
+            result = 1;
+        }
+        catch (const std::exception& err) {
+            std::wcout << L"[!] " << err.what() << L"\n\n";
+            result = 1;
+        }
+    }
+
+    if (!found) {
+        print_usage();
+        return 1;
+    }
+
+    return result;
+}
@@ -0,0 +1,149 @@
+#ifndef _BENCH_H
+#define _BENCH_H
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "row_source.h"
+
+class sql_statement_factory;
+
+/* Type Definitions
+************************************************************************/
+
+// The arguments after the case name, e.g. "rows=100000"
+using bench_arguments = std::span<const std::string_view>;
+
+/**
+ * @struct bench_case
+ * @brief A benchmark or check that can be run by name from the command line.
+ */
+struct bench_case {
+    std::string_view name{};
+    std::string_view summary{};
+    int (*run)(bench_arguments arguments) {};
+};
+
+/**
+ * @class check_failed
+ * @brief Thrown when a check finds results that differ from what was expected.
+ */
+class check_failed : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+/**
+ * @struct heap_usage
+ * @brief Counters kept by the global operator new of the bench executable.
+ */
+struct heap_usage {
+    uint64_t allocations{};     ///< Number of allocations made since the program started.
+    uint64_t live_bytes{};      ///< Bytes currently allocated.
+    uint64_t peak_bytes{};      ///< Highest value of live_bytes since the last reset_heap_peak().
+};
+
+/**
+ * @class stopwatch
+ * @brief Measures the time elapsed since it was created or last restarted.
+ */
+class stopwatch {
+    std::chrono::steady_clock::time_point start{ std::chrono::steady_clock::now() };
+
+public:
+    void restart() { start = std::chrono::steady_clock::now(); }
+
+    double seconds() const { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); }
+};
+
+/**
+ * @class keyed_memory_source
+ * @brief Serves synthetic tables with a foreign key from every 'ParentID' column, so joins are generated too.
+ */
+class keyed_memory_source : public memory_source {
+    std::shared_ptr<const std::vector<std::shared_ptr<table_info>>> tables{};
+
+public:
+
+    /**
+     * @param tables : The tables made by synthetic_tables().
+     */
+    keyed_memory_source(std::shared_ptr<const std::vector<std::shared_ptr<table_info>>> tables) :
+        memory_source(tables), tables(tables) {}
+
+    std::vector<foreign_key> load_foreign_keys() override;
+};
+
+/* Function Declarations
+************************************************************************/
+
+/**
+ * @brief Returns the heap counters of the process.
+ */
+heap_usage current_heap_usage();
+
+/**
+ * @brief Lowers the peak heap counter to the bytes currently allocated.
+ */
+void reset_heap_peak();
+
+/**
+ * @brief Throws check_failed with the given message when a condition does not hold.
+ */
+void expect(bool condition, std::string_view message);
+
+/**
+ * @brief Returns the value of a "name=value" argument, or a fallback when it is missing.
+ *
+ * @param arguments : The arguments of the case.
+ * @param name : The name of the argument.
+ * @param fallback : The value used when the argument is missing.
+ */
+size_t argument(bench_arguments arguments, std::string_view name, size_t fallback);
+
+/**
+ * @brief Builds tables shaped like a small OLTP database, filled with deterministic values.
+ *
+ * Row counts fall off like a Zipf distribution across the tables, so a few large
+ * tables hold most rows, as in AdventureWorks. Columns mix integers, names, dates,
+ * GUIDs, money and flags, with NULLs in some of the text columns.
+ *
+ * @param table_count : The number of tables.
+ * @param total_rows : The number of rows across all tables.
+ * @param seed : The seed of the values.
+ */
+std::vector<std::shared_ptr<table_info>> synthetic_tables(size_t table_count, size_t total_rows, uint64_t seed);
+
+/**
+ * @brief Creates statements the way the generator does for tables of 20 columns, until the factory holds the given number.
+ *
+ * @param factory : The factory to fill.
+ * @param statement_count : The number of statements to create.
+ */
+void fill_factory(sql_statement_factory& factory, size_t statement_count);
+
+/**
+ * @brief Returns the number of rows across the given tables.
+ */
+size_t total_rows(const std::vector<std::shared_ptr<table_info>>& tables);
+
+// Cases, one per file
+int run_layout(bench_arguments arguments);
+int run_scheduler(bench_arguments arguments);
+int run_dom(bench_arguments arguments);
+int run_merge(bench_arguments arguments);
+int run_factory(bench_arguments arguments);
+int run_render(bench_arguments arguments);
+int run_shards(bench_arguments arguments);
+int run_sampling(bench_arguments arguments);
+int run_decode(bench_arguments arguments);
+int run_prefetch(bench_arguments arguments);
+int run_replay(bench_arguments arguments);
+
+#endif // !_BENCH_H
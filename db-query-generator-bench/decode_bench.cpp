@@ -0,0 +1,106 @@
+#include "bench.h"
+#include "row_source.h"
+
+#include <algorithm>
+#include <cwctype>
+#include <iomanip>
+#include <iostream>
+
+// Reads the rows of a stored table, finding every field either by cached ordinal or by name, per cell, the way SACommand::Field(name) does
+class decoding_reader : public row_reader {
+    const table_info& stored;
+    const table_info& table;
+    bool cached{};
+    std::vector<size_t> ordinals{};
+    std::vector<number_buffer> digits{};
+    size_t row{ SIZE_MAX };
+
+    // A case-insensitive scan of the result set's columns, like a driver's lookup by name
+    size_t find(std::wstring_view name) const {
+        for (size_t i = 0; i < stored.columns.size(); i++) {
+            const std::wstring& candidate{ stored.columns[i]->name };
+
+            if (std::equal(candidate.begin(), candidate.end(), name.begin(), name.end(),
+                [](wchar_t a, wchar_t b) { return std::towupper(a) == std::towupper(b); })) {
+                return i;
+            }
+        }
+
+        throw std::runtime_error{ "a column is missing from the stored table" };
+    }
+
+public:
+
+    decoding_reader(const table_info& stored, const table_info& table, bool cached) :
+        row_reader(table.columns.size()), stored(stored), table(table), cached(cached), ordinals(table.columns.size()), digits(table.columns.size()) {
+        for (size_t i = 0; i < table.columns.size(); i++) {
+            ordinals[i] = find(table.columns[i]->name);
+        }
+    }
+
+    bool next() override { return ++row < stored.row_count(); }
+    field_value field(size_t column) override { return stored.field(row, cached ? ordinals[column] : find(table.columns[column]->name)); }
+    std::wstring_view text(size_t column) override { return stored.value(row, cached ? ordinals[column] : find(table.columns[column]->name), digits[column]); }
+};
+
+int run_decode(bench_arguments arguments) {
+    auto stored{ std::make_shared<const std::vector<std::shared_ptr<table_info>>>(
+        synthetic_tables(argument(arguments, "tables", 8), argument(arguments, "rows", 400000), argument(arguments, "seed", 1))) };
+
+    // The columns are requested in reverse, so no ordinal matches its index
+    memory_source source{ stored };
+    std::vector<std::shared_ptr<table_info>> tables{ source.load_catalog() };
+    for (const auto& table : tables) {
+        std::reverse(table->columns.begin(), table->columns.end());
+    }
+
+    size_t rows{}, fields{};
+    for (const auto& table : *stored) {
+        rows += table->row_count();
+        fields += table->row_count() * table->columns.size();
+    }
+
+    // Characters of every field, to check both ways read the same rows and keep the reads from being optimized away
+    auto decode = [&](bool cached, size_t& characters) {
+        stopwatch watch{};
+
+        for (size_t t = 0; t < tables.size(); t++) {
+            decoding_reader{ *(*stored)[t], *tables[t], cached }.read_rows([&](const std::vector<std::wstring_view>& row) {
+                for (std::wstring_view field : row) {
+                    characters += field.size();
+                }
+            });
+        }
+
+        return watch.seconds();
+    };
+
+    size_t by_name_characters{}, cached_characters{}, source_characters{};
+    double by_name_seconds{ decode(false, by_name_characters) };
+    double cached_seconds{ decode(true, cached_characters) };
+
+    stopwatch watch{};
+    for (const auto& table : tables) {
+        source.fetch_rows(*table, [&](const std::vector<std::wstring_view>& row) {
+            for (std::wstring_view field : row) {
+                source_characters += field.size();
+            }
+        });
+    }
+    double source_seconds{ watch.seconds() };
+
+    expect(by_name_characters == cached_characters && cached_characters == source_characters, "the readers decoded different fields");
+
+    auto report = [&](const wchar_t* name, double seconds) {
+        std::wcout << L"    " << std::left << std::setw(22) << name << std::right << std::setw(9) << seconds * 1e9 / double(rows) << L" ns/row"
+            << std::setw(9) << seconds * 1e9 / double(fields) << L" ns/field\n";
+    };
+
+    std::wcout << L"[+] Decoded " << rows << L" rows, " << fields << L" fields.\n" << std::fixed << std::setprecision(1);
+    report(L"by name, per cell", by_name_seconds);
+    report(L"cached ordinals", cached_seconds);
+    report(L"memory_source", source_seconds);
+    std::wcout << L'\n';
+
+    return 0;
+}
@@ -0,0 +1,185 @@
+#include "bench.h"
+#include "pipeline.h"
+#include "xml_output.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <unordered_map>
+
+// An element of an in-memory document tree, shaped like the DOM the database sink used to build
+//
+// Tag and attribute names are shared and every value is a wchar_t copy, which is UTF-16
+// like XMLCh on Windows. Xerces also allocates a node per attribute and an attribute
+// map per element, so this tree is a lower bound on the memory the DOM needed.
+struct dom_element {
+    const char* tag{};
+    std::vector<std::pair<const char*, std::wstring>> attributes{};
+    std::vector<std::unique_ptr<dom_element>> children{};
+
+    dom_element* append_child(const char* child_tag) {
+        children.push_back(std::make_unique<dom_element>());
+        children.back()->tag = child_tag;
+        return children.back().get();
+    }
+};
+
+// Builds the whole document, then serializes it once every table is done, as the Xerces sink did
+class dom_database_sink : public row_sink {
+    std::filesystem::path file_path{};
+    std::unique_ptr<dom_element> root{};
+    std::unordered_map<const table_info*, dom_element*> table_elements{};
+
+public:
+
+    dom_database_sink(std::filesystem::path file_path) :
+        file_path(std::move(file_path)) {}
+
+    void begin_database(const std::vector<std::shared_ptr<table_info>>& tables) override {
+        root = std::make_unique<dom_element>();
+        root->tag = "database";
+        root->attributes.emplace_back("number_of_tables", std::to_wstring(tables.size()));
+
+        for (const auto& table : tables) {
+            dom_element* element{ root->append_child("table") };
+            element->attributes.emplace_back("name", table->schema + L'.' + table->name);
+            table_elements.emplace(table.get(), element);
+        }
+    }
+
+    void begin_table(const table_info& table) override {
+        dom_element* element{ table_elements.at(&table) };
+        element->attributes.emplace_back("number_of_columns", std::to_wstring(table.columns.size()));
+
+        for (const auto& column : table.columns) {
+            dom_element* column_element{ element->append_child("column") };
+            column_element->attributes.emplace_back("name", column->name);
+            column_element->attributes.emplace_back("type", column->data_type);
+        }
+    }
+
+    void write_rows(const table_info& table, const table_info& chunk) override {
+        dom_element* element{ table_elements.at(&table) };
+        number_buffer digits{};
+
+        for (size_t i = 0; i < chunk.row_count(); i++) {
+            dom_element* row{ element->append_child("row") };
+
+            for (size_t c = 0; c < chunk.columns.size(); c++) {
+                dom_element* field{ row->append_child("field") };
+                field->attributes.emplace_back("parent_column", chunk.columns[c]->name);
+                field->attributes.emplace_back("value", chunk.value(i, c, digits));
+            }
+        }
+    }
+
+    void end_table(const table_info& table, size_t row_count) override {
+        table_elements.at(&table)->attributes.emplace_back("number_of_rows", std::to_wstring(row_count));
+    }
+
+    void end_database() override {
+        output_file output{};
+        output.open(file_path);
+        output.buffer().append("<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\" ?>");
+        serialize(output, *root);
+        output.close();
+
+        root.reset();
+        table_elements.clear();
+    }
+
+private:
+    static void serialize(output_file& output, const dom_element& element) {
+        std::string& out{ output.buffer() };
+        out.append("<").append(element.tag);
+
+        for (const auto& [name, value] : element.attributes) {
+            out.append(" ").append(name).append("=\"");
+            append_xml_escaped(out, value, xml_escape::attribute);
+            out.append("\"");
+        }
+
+        if (element.children.empty()) {
+            out.append("/>");
+            return;
+        }
+
+        out.append(">");
+        output.commit();
+
+        for (const auto& child : element.children) {
+            serialize(output, *child);
+        }
+
+        output.buffer().append("</").append(element.tag).append(">");
+    }
+};
+
+// What extracting the tables into one sink cost
+struct sink_cost {
+    uint64_t peak_bytes{};      ///< Highest heap use above what was allocated before the run.
+    double seconds{};
+    uintmax_t file_bytes{};
+};
+
+static sink_cost run_sink(row_sink& sink, const std::filesystem::path& path, const std::shared_ptr<const std::vector<std::shared_ptr<table_info>>>& tables) {
+    memory_source source{ tables };
+    std::vector<std::shared_ptr<table_info>> requested{ source.load_catalog() };
+
+    row_pipeline pipeline{};
+    pipeline.add_sink(sink);
+
+    uint64_t before{ current_heap_usage().live_bytes };
+    reset_heap_peak();
+    stopwatch watch{};
+
+    pipeline.run(source, requested);
+
+    return sink_cost{ current_heap_usage().peak_bytes - before, watch.seconds(), std::filesystem::file_size(path) };
+}
+
+static std::string read_file(const std::filesystem::path& path) {
+    std::ifstream input{ path, std::ios::binary };
+    return std::string{ std::istreambuf_iterator<char>{ input }, std::istreambuf_iterator<char>{} };
+}
+
+int run_dom(bench_arguments arguments) {
+    auto tables{ std::make_shared<const std::vector<std::shared_ptr<table_info>>>(
+        synthetic_tables(argument(arguments, "tables", 71), argument(arguments, "rows", 200000), argument(arguments, "seed", 1))) };
+
+    std::filesystem::path directory{ std::filesystem::temp_directory_path() };
+    std::filesystem::path dom_path{ directory / "db-query-generator-bench-dom.xml" };
+    std::filesystem::path stream_path{ directory / "db-query-generator-bench-stream.xml" };
+
+    sink_cost dom{};
+    {
+        dom_database_sink sink{ dom_path };
+        dom = run_sink(sink, dom_path, tables);
+    }
+
+    sink_cost stream{};
+    {
+        xml_database_writer sink{ stream_path };
+        stream = run_sink(sink, stream_path, tables);
+    }
+
+    bool same{ read_file(dom_path) == read_file(stream_path) };
+    std::filesystem::remove(dom_path);
+    std::filesystem::remove(stream_path);
+    expect(same, "the streamed document differs from the serialized tree");
+
+    auto print = [&](const wchar_t* name, const sink_cost& cost) {
+        std::wcout << std::left << std::setw(14) << std::wstring{ L"    " } + name << std::right << std::fixed << std::setprecision(1)
+            << std::setw(10) << cost.peak_bytes / (1024.0 * 1024.0) << L" MiB peak"
+            << std::setw(10) << cost.seconds * 1000.0 << L" ms"
+            << std::setw(10) << cost.file_bytes / (1024.0 * 1024.0) / cost.seconds << L" MiB/s\n";
+    };
+
+    std::wcout << std::fixed << std::setprecision(1) << L"[+] Wrote " << total_rows(*tables) << L" rows to " << stream.file_bytes / (1024.0 * 1024.0) << L" MiB of identical XML.\n";
+    print(L"tree", dom);
+    print(L"stream", stream);
+    std::wcout << L'\n';
+
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include "bench.h"
+#include "sql_statement_factory.h"
+
+#include <iomanip>
+#include <iostream>
+
+static constexpr size_t columns_per_table{ 20 };
+
+void fill_factory(sql_statement_factory& factory, size_t statement_count) {
+    const data_type_info& int_type{ lookup_type(L"int") };
+    const data_type_info& date_type{ lookup_type(L"datetime") };
+
+    std::vector<name_id> columns{};
+    for (size_t c = 0; c < columns_per_table; c++) {
+        columns.push_back(factory.intern(L"ColumnName" + std::to_wstring(c)));
+    }
+
+    // One table at a time, with the kinds of statements the generator makes for it
+    for (size_t t = 0; factory.size() < statement_count; t++) {
+        name_id table{ factory.intern(L"Production.Table" + std::to_wstring(t)) };
+        factory.create_select_all_statement(table);
+
+        for (size_t c = 0; c < columns_per_table; c++) {
+            factory.create_select_statement(table, std::span{ &columns[c], 1 });
+            if (c > 0) {
+                factory.create_select_statement(table, std::span{ columns.data(), c + 1 });
+            }
+
+            factory.create_filter_statement(table, columns[c], int_type, comparison_operators::equals, std::to_wstring(t * columns_per_table + c));
+            factory.create_filter_statement(table, columns[c], date_type, comparison_operators::less_equals, L"2014-01-01 00:00:00.000");
+        }
+    }
+}
+
+int run_factory(bench_arguments arguments) {
+    size_t statement_count{ argument(arguments, "statements", 1000000) };
+
+    heap_usage before{ current_heap_usage() };
+    stopwatch watch{};
+
+    size_t created{};
+    heap_usage filled{};
+    double seconds{};
+    {
+        sql_statement_factory factory{};
+        fill_factory(factory, statement_count);
+
+        seconds = watch.seconds();
+        filled = current_heap_usage();
+        created = factory.size();
+
+        expect(factory.duplicates_removed() == 0, "distinct statements were taken for duplicates");
+    }
+    expect(current_heap_usage().live_bytes == before.live_bytes, "the factory did not release its memory");
+
+    std::wcout << L"[+] Created " << created << L" statements.\n" << std::fixed << std::setprecision(2)
+        << L"    " << created / seconds / 1e6 << L"M statements/s\n"
+        << L"    " << double(filled.allocations - before.allocations) / double(created) << L" allocations/statement\n"
+        << L"    " << double(filled.live_bytes - before.live_bytes) / double(created) << L" bytes/statement held\n\n";
+
+    return 0;
+}
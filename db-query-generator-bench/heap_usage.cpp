@@ -0,0 +1,52 @@
+#include "bench.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Replaces the global operator new of the bench executable so cases can measure
+// their heap use. Every allocation carries its size in a header, so delete can
+// subtract it.
+static constexpr size_t heap_header{ alignof(std::max_align_t) };
+
+static std::atomic<uint64_t> heap_allocations{};
+static std::atomic<uint64_t> heap_live{};
+static std::atomic<uint64_t> heap_peak{};
+
+void* operator new(size_t size) {
+    auto block{ static_cast<unsigned char*>(std::malloc(size + heap_header)) };
+    if (!block) {
+        throw std::bad_alloc{};
+    }
+
+    *reinterpret_cast<size_t*>(block) = size;
+
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    uint64_t live{ heap_live.fetch_add(size, std::memory_order_relaxed) + size };
+    uint64_t peak{ heap_peak.load(std::memory_order_relaxed) };
+    while (live > peak && !heap_peak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+
+    return block + heap_header;
+}
+
+void operator delete(void* pointer) noexcept {
+    if (!pointer) {
+        return;
+    }
+
+    auto block{ static_cast<unsigned char*>(pointer) - heap_header };
+    heap_live.fetch_sub(*reinterpret_cast<size_t*>(block), std::memory_order_relaxed);
+    std::free(block);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    operator delete(pointer);
+}
+
+heap_usage current_heap_usage() {
+    return heap_usage{ heap_allocations.load(), heap_live.load(), heap_peak.load() };
+}
+
+void reset_heap_peak() {
+    heap_peak.store(heap_live.load());
+}
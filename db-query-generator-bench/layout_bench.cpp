@@ -0,0 +1,154 @@
+#include "bench.h"
+
+#include <iomanip>
+#include <iostream>
+
+// The row layout table_info replaced: a shared_ptr graph with one heap node and
+// one wstring per field, each field pointing back at its row and column
+namespace legacy {
+    struct row_info;
+
+    struct column_info {
+        column_info(std::wstring name, std::wstring data_type) :
+            name(name), data_type(data_type) {}
+
+        std::wstring name{}, data_type{};
+    };
+
+    struct field_info {
+        field_info(std::wstring value, std::shared_ptr<row_info> row, std::shared_ptr<column_info> column) :
+            value(value), row(row), column(column) {}
+
+        std::wstring value{};
+        std::shared_ptr<row_info> row{};
+        std::shared_ptr<column_info> column{};
+    };
+
+    struct row_info {
+        std::vector<std::shared_ptr<field_info>> fields{};
+    };
+
+    struct table_info {
+        table_info(std::wstring name, std::wstring schema) :
+            name(name), schema(schema) {}
+
+        std::wstring name{}, schema{};
+        std::vector<std::shared_ptr<column_info>> columns{};
+        std::vector<std::shared_ptr<row_info>> rows{};
+    };
+}
+
+// What building one layout from the same field texts cost
+struct layout_cost {
+    uint64_t bytes{};           ///< Heap bytes held once every table is built.
+    uint64_t allocations{};     ///< Heap allocations made while building.
+    double seconds{};           ///< Time taken to build.
+};
+
+static void print_cost(const wchar_t* name, const layout_cost& cost, size_t fields) {
+    std::wcout << std::left << std::setw(14) << std::wstring{ L"    " } + name << std::right << std::fixed << std::setprecision(1)
+        << std::setw(12) << cost.bytes / (1024.0 * 1024.0) << L" MiB"
+        << std::setw(10) << double(cost.bytes) / double(fields) << L" B/field"
+        << std::setw(12) << cost.allocations << L" allocs"
+        << std::setw(10) << cost.seconds * 1000.0 << L" ms\n";
+}
+
+int run_layout(bench_arguments arguments) {
+    size_t table_count{ argument(arguments, "tables", 71) };
+    size_t rows{ argument(arguments, "rows", 760000) };
+
+    auto source{ synthetic_tables(table_count, rows, argument(arguments, "seed", 1)) };
+
+    size_t fields{};
+    for (const auto& table : source) {
+        fields += table->row_count() * table->columns.size();
+    }
+
+    number_buffer digits{};
+
+    // Old layout, built the way the parser used to: one row and one field node at a time
+    std::vector<std::shared_ptr<legacy::table_info>> old_tables{};
+    layout_cost old_cost{};
+    {
+        heap_usage before{ current_heap_usage() };
+        stopwatch watch{};
+
+        for (const auto& table : source) {
+            auto copy{ std::make_shared<legacy::table_info>(table->name, table->schema) };
+            for (const auto& column : table->columns) {
+                copy->columns.push_back(std::make_shared<legacy::column_info>(column->name, column->data_type));
+            }
+
+            for (size_t row = 0; row < table->row_count(); row++) {
+                auto fields_of_row{ std::make_shared<legacy::row_info>() };
+                for (size_t column = 0; column < copy->columns.size(); column++) {
+                    fields_of_row->fields.push_back(std::make_shared<legacy::field_info>(
+                        std::wstring{ table->value(row, column, digits) }, fields_of_row, copy->columns[column]));
+                }
+                copy->rows.push_back(fields_of_row);
+            }
+
+            old_tables.push_back(std::move(copy));
+        }
+
+        old_cost.seconds = watch.seconds();
+        heap_usage after{ current_heap_usage() };
+        old_cost.bytes = after.live_bytes - before.live_bytes;
+        old_cost.allocations = after.allocations - before.allocations;
+    }
+
+    // New layout, filled through add_field() like the parser does now
+    std::vector<std::shared_ptr<table_info>> new_tables{};
+    layout_cost new_cost{};
+    size_t reported{};
+    {
+        heap_usage before{ current_heap_usage() };
+        stopwatch watch{};
+
+        for (const auto& table : source) {
+            auto copy{ std::make_shared<table_info>(table->name, table->schema) };
+            copy->copy_layout(*table);
+
+            for (size_t row = 0; row < table->row_count(); row++) {
+                for (size_t column = 0; column < copy->columns.size(); column++) {
+                    copy->add_field(column, table->value(row, column, digits));
+                }
+                copy->finish_row();
+            }
+
+            reported += copy->memory_usage();
+            new_tables.push_back(std::move(copy));
+        }
+
+        new_cost.seconds = watch.seconds();
+        heap_usage after{ current_heap_usage() };
+        new_cost.bytes = after.live_bytes - before.live_bytes;
+        new_cost.allocations = after.allocations - before.allocations;
+    }
+
+    // Both layouts must hold the same text in every field
+    number_buffer other{};
+    for (size_t i = 0; i < source.size(); i++) {
+        for (size_t row = 0; row < source[i]->row_count(); row++) {
+            for (size_t column = 0; column < source[i]->columns.size(); column++) {
+                expect(old_tables[i]->rows[row]->fields[column]->value == new_tables[i]->value(row, column, other),
+                    "the layouts hold different values");
+            }
+        }
+    }
+
+    std::wcout << L"[+] Built " << source.size() << L" tables with " << total_rows(source) << L" rows and " << fields << L" fields.\n";
+    print_cost(L"shared_ptr", old_cost, fields);
+    print_cost(L"columnar", new_cost, fields);
+    std::wcout << L"    memory_usage() reports " << reported / (1024.0 * 1024.0) << L" MiB; the columnar layout uses "
+        << std::setprecision(2) << double(old_cost.bytes) / double(new_cost.bytes) << L"x less heap.\n\n";
+
+    // Every field holds its row, so the graph only frees once the cycles are broken
+    for (const auto& table : old_tables) {
+        for (const auto& row : table->rows) {
+            row->fields.clear();
+        }
+    }
+
+    return 0;
+}
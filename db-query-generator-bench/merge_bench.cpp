@@ -0,0 +1,126 @@
+#include "bench.h"
+#include "exporter.h"
+#include "incremental.h"
+#include "parser.h"
+#include "pipeline.h"
+
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+
+// The text of every field of a row, in column order
+using row_text = std::vector<std::wstring>;
+
+static row_text text_of_row(const table_info& table, size_t row) {
+    number_buffer digits{};
+    row_text text{};
+
+    for (size_t column = 0; column < table.columns.size(); column++) {
+        text.emplace_back(table.value(row, column, digits));
+    }
+
+    return text;
+}
+
+// Changes every 'stride'-th row of a table, keeping its key, and adds 'added' rows with new keys
+static std::shared_ptr<table_info> make_delta(const table_info& table, size_t stride, size_t added) {
+    auto delta{ std::make_shared<table_info>(table_info{ L"", L"" }) };
+    delta->copy_layout(table);
+
+    size_t rows{ table.row_count() };
+    auto add_row = [&](const std::wstring& key, size_t values_from) {
+        row_text values{ text_of_row(table, values_from) };
+        values[0] = key;
+
+        for (size_t column = 0; column < values.size(); column++) {
+            delta->add_field(column, values[column]);
+        }
+        delta->finish_row();
+    };
+
+    // Updated rows take the other values of their neighbour
+    for (size_t row = stride / 2; row < rows; row += stride) {
+        number_buffer digits{};
+        add_row(std::wstring{ table.value(row, 0, digits) }, (row + 1) % rows);
+    }
+
+    for (size_t i = 0; i < added; i++) {
+        add_row(std::to_wstring(rows + 1 + i), i % rows);
+    }
+
+    return delta;
+}
+
+int run_merge(bench_arguments arguments) {
+    size_t stride{ argument(arguments, "stride", 7) };
+    auto tables{ std::make_shared<const std::vector<std::shared_ptr<table_info>>>(
+        synthetic_tables(argument(arguments, "tables", 8), argument(arguments, "rows", 40000), argument(arguments, "seed", 1))) };
+
+    std::filesystem::path stem{ std::filesystem::temp_directory_path() / "db-query-generator-bench-prior" };
+
+    for (export_format format : { export_format::xml, export_format::columnar }) {
+        // Export the prior snapshot the way a run does
+        std::unique_ptr<snapshot_exporter> exporter{ make_exporter(format, stem) };
+        {
+            memory_source source{ tables };
+            row_pipeline pipeline{};
+            pipeline.add_sink(*exporter);
+            pipeline.run(source, source.load_catalog());
+        }
+
+        size_t merged_rows{}, changed_rows{};
+        double seconds{};
+        {
+            snapshot prior{ exporter->path() };
+
+            for (size_t t = 0; t < tables->size(); t++) {
+                const table_info& table{ *(*tables)[t] };
+                auto delta{ make_delta(table, stride, table.row_count() / 20 + 1) };
+
+                // What the table holds after the changes, by key
+                std::map<std::wstring, row_text> expected{};
+                for (size_t row = 0; row < table.row_count(); row++) {
+                    row_text text{ text_of_row(table, row) };
+                    expected[text[0]] = std::move(text);
+                }
+                for (size_t row = 0; row < delta->row_count(); row++) {
+                    row_text text{ text_of_row(*delta, row) };
+                    expected[text[0]] = std::move(text);
+                }
+
+                std::vector<row_text> merged{};
+                stopwatch watch{};
+                merge_delta(prior, t, *delta, { 0 }, [&](const std::vector<std::wstring_view>& fields) {
+                    merged.emplace_back(fields.begin(), fields.end());
+                });
+                seconds += watch.seconds();
+
+                // Every key once, with its latest values, and the changed rows last in delta order
+                expect(merged.size() == expected.size(), "the merged table has a wrong number of rows");
+
+                std::set<std::wstring> seen{};
+                for (const row_text& row : merged) {
+                    expect(seen.insert(row[0]).second, "a key appears more than once in the merged table");
+                    expect(expected.at(row[0]) == row, "a merged row does not hold the latest values of its key");
+                }
+
+                for (size_t row = 0; row < delta->row_count(); row++) {
+                    expect(merged[merged.size() - delta->row_count() + row] == text_of_row(*delta, row), "the changed rows are not last, in delta order");
+                }
+
+                merged_rows += merged.size();
+                changed_rows += delta->row_count();
+            }
+        }
+
+        std::filesystem::remove(exporter->path());
+
+        std::wcout << L"[+] Merged " << changed_rows << L" changed rows into " << (format == export_format::xml ? L"an XML" : L"a columnar")
+            << L" snapshot: " << merged_rows << L" rows in " << std::fixed << std::setprecision(1) << seconds * 1000.0 << L" ms ("
+            << merged_rows / seconds / 1e6 << L"M rows/s).\n";
+    }
+
+    std::wcout << L'\n';
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include "bench.h"
+#include "row_source.h"
+#include "statistics.h"
+
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+// Serves the rows of a stored table with a round trip every 'prefetch_rows' rows, like a driver fetching arrays
+class round_trip_reader : public row_reader {
+    const table_info& stored;
+    size_t rows{};
+    size_t prefetch_rows{};
+    std::chrono::microseconds latency{};
+    std::vector<number_buffer> digits{};
+    size_t row{ SIZE_MAX };
+
+public:
+
+    round_trip_reader(const table_info& stored, size_t rows, size_t prefetch_rows, std::chrono::microseconds latency) :
+        row_reader(stored.columns.size()), stored(stored), rows(rows), prefetch_rows(prefetch_rows), latency(latency), digits(stored.columns.size()) {}
+
+    bool next() override {
+        if (++row % prefetch_rows == 0 && row < rows) {
+            std::this_thread::sleep_for(latency);
+        }
+
+        return row < rows;
+    }
+
+    field_value field(size_t column) override { return stored.field(row % stored.row_count(), column); }
+    std::wstring_view text(size_t column) override { return stored.value(row % stored.row_count(), column, digits[column]); }
+};
+
+int run_prefetch(bench_arguments arguments) {
+    size_t round_trips{ argument(arguments, "round_trips", 200) };
+    size_t block_rows{ argument(arguments, "block", 4096) };
+    std::chrono::microseconds latency{ static_cast<int64_t>(argument(arguments, "latency", 200)) };
+
+    std::vector<std::shared_ptr<table_info>> tables{ synthetic_tables(1, 20000, argument(arguments, "seed", 1)) };
+    const table_info& stored{ *tables.front() };
+
+    std::wcout << L"[+] Read " << round_trips << L" round trips of " << latency.count() << L" us, gathering the statistics of every row ("
+        << block_rows << L"-row blocks).\n"
+        << L"    rows per round trip      direct rows/s   prefetching rows/s\n";
+
+    for (size_t prefetch_rows : { 1, 10, 100, 1000 }) {
+        size_t rows{ round_trips * prefetch_rows };
+        double rates[2]{};
+        size_t characters[2]{};
+
+        // The consumer decodes every row into column statistics, as extraction does
+        for (bool prefetching : { false, true }) {
+            round_trip_reader source{ stored, rows, prefetch_rows, latency };
+            table_statistics stats{ stored, 1 };
+            size_t& read{ characters[prefetching] };
+
+            number_buffer digits{};
+            auto decode = [&](const std::vector<field_value>& fields) {
+                stats.add(fields);
+                for (const field_value& field : fields) {
+                    read += format_field(field, digits).size();
+                }
+            };
+
+            stopwatch watch{};
+            if (prefetching) {
+                prefetching_reader{ source, stored, block_rows }.read_fields(decode);
+            }
+            else {
+                source.read_fields(decode);
+            }
+            rates[prefetching] = double(rows) / watch.seconds();
+        }
+
+        expect(characters[0] == characters[1], "the prefetching reader read different rows");
+
+        std::wcout << L"    " << std::setw(19) << prefetch_rows << std::fixed << std::setprecision(0)
+            << std::setw(19) << rates[0] << std::setw(21) << rates[1] << L'\n';
+    }
+
+    std::wcout << L'\n';
+    return 0;
+}
@@ -0,0 +1,33 @@
+#include "bench.h"
+#include "sql_statement_factory.h"
+
+#include <iomanip>
+#include <iostream>
+
+int run_render(bench_arguments arguments) {
+    sql_statement_factory factory{};
+    fill_factory(factory, argument(arguments, "statements", 1000000));
+
+    std::wstring buffer{};
+    size_t characters{};
+
+    heap_usage before{ current_heap_usage() };
+    stopwatch watch{};
+
+    for (size_t i = 0; i < factory.size(); i++) {
+        rendered_statement statement{ factory.render(i, buffer) };
+        characters += statement.sql.size() + statement.label.size() + statement.template_sql.size();
+
+        expect(statement.sql.starts_with(L"SELECT ") && !statement.label.empty(), "a statement rendered without its SQL or label");
+    }
+
+    double seconds{ watch.seconds() };
+    heap_usage after{ current_heap_usage() };
+
+    std::wcout << L"[+] Rendered " << factory.size() << L" statements, " << characters << L" characters.\n" << std::fixed << std::setprecision(2)
+        << L"    " << factory.size() / seconds / 1e6 << L"M renders/s\n"
+        << L"    " << characters / seconds / 1e6 << L"M characters/s\n"
+        << L"    " << double(after.allocations - before.allocations) / double(factory.size()) << L" allocations/render\n\n";
+
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include "bench.h"
+#include "parser.h"
+#include "replay.h"
+#include "statement_generation.h"
+#include "xml_output.h"
+
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+
+// Generates the statements of the tables and writes them as a statement set, returning how many there are
+static size_t write_synthetic_set(const std::filesystem::path& file_path, const std::shared_ptr<const std::vector<std::shared_ptr<table_info>>>& stored, uint64_t seed) {
+    source_pool sources{ 1, [&]() { return std::make_unique<keyed_memory_source>(stored); } };
+
+    catalog db{};
+    db.load(sources[0]);
+    sources[0].estimate_rows(db.tables());
+
+    sharded_statement_factory factory{ 1 };
+    statement_sink sink{ factory, db, generation_budget{}, sampler_options{ 100, seed }, { 0.01, 0.1 } };
+
+    row_pipeline pipeline{};
+    pipeline.add_sink(sink);
+    pipeline.run(sources, db.tables());
+
+    std::set<std::wstring> schemas{};
+    for (const auto& table : db.tables()) {
+        schemas.insert(table->schema);
+    }
+
+    write_statement_set(file_path, schemas, db.tables(), factory);
+    return factory.size();
+}
+
+static void print_report(const replay_report& report) {
+    auto milliseconds = [](std::chrono::nanoseconds latency) { return std::chrono::duration<double, std::milli>(latency).count(); };
+
+    std::wcout << std::left << std::setw(26) << L"    Kind" << std::right << std::setw(8) << L"Count" << std::setw(14) << L"Statements/s"
+        << std::setw(10) << L"p50 ms" << std::setw(10) << L"p99 ms" << std::setw(10) << L"p99.9 ms" << std::setw(10) << L"Max ms" << L'\n';
+
+    for (const latency_summary& kind : report.kinds) {
+        std::wcout << std::left << std::setw(26) << L"    " + kind.name << std::right << std::setw(8) << kind.count
+            << std::fixed << std::setprecision(1) << std::setw(14) << kind.throughput << std::setprecision(3)
+            << std::setw(10) << milliseconds(kind.p50) << std::setw(10) << milliseconds(kind.p99)
+            << std::setw(10) << milliseconds(kind.p999) << std::setw(10) << milliseconds(kind.max) << L'\n';
+    }
+}
+
+int run_replay(bench_arguments arguments) {
+    uint64_t seed{ argument(arguments, "seed", 1) };
+    std::chrono::microseconds mean_latency{ static_cast<int64_t>(argument(arguments, "latency", 500)) };
+
+    replay_options options{};
+    options.workers = argument(arguments, "workers", 4);
+    options.rate = static_cast<double>(argument(arguments, "rate", 2000));
+    options.warmup = std::chrono::milliseconds{ static_cast<int64_t>(argument(arguments, "warmup", 200)) };
+    options.duration = std::chrono::milliseconds{ static_cast<int64_t>(argument(arguments, "duration", 2000)) };
+
+    auto stored{ std::make_shared<const std::vector<std::shared_ptr<table_info>>>(
+        synthetic_tables(argument(arguments, "tables", 12), argument(arguments, "rows", 20000), seed)) };
+
+    std::filesystem::path file_path{ std::filesystem::temp_directory_path() / "db-query-generator-bench-statements.xml" };
+    size_t generated{ write_synthetic_set(file_path, stored, seed) };
+
+    statement_reader reader{ file_path };
+    recorded_statement statement{};
+
+    // Every generated statement is read back, templates once per parameter set
+    size_t read_back{};
+    while (reader.next(statement)) {
+        read_back++;
+    }
+    expect(read_back == generated, "the statement set does not read back every generated statement");
+
+    for (arrival_model arrival : { arrival_model::closed, arrival_model::open }) {
+        options.arrival = arrival;
+        reader.rewind();
+
+        // The statements handed to the workers, per kind; warmup and unfinished ones are not recorded
+        std::map<std::wstring_view, uint64_t> supplied{};
+        statement_supplier next_statement{ [&](recorded_statement& next) {
+            if (!reader.next(next)) {
+                reader.rewind();
+                if (!reader.next(next)) {
+                    return false;
+                }
+            }
+
+            supplied[label_kind(next.label)]++;
+            return true;
+        } };
+
+        std::atomic<uint64_t> next_seed{ seed };
+        runner_factory open{ [&]() -> std::unique_ptr<statement_runner> {
+            return std::make_unique<simulated_runner>(mean_latency, next_seed++);
+        } };
+
+        replay_report report{ replay_statements(next_statement, open, options) };
+
+        uint64_t recorded{};
+        for (const latency_summary& kind : report.kinds) {
+            expect(kind.errors == 0, "a simulated statement failed");
+            expect(kind.count <= supplied[kind.name], "more statements of a kind were recorded than supplied");
+            expect(kind.p50 <= kind.p99 && kind.p99 <= kind.p999 && kind.p999 <= kind.max, "the percentiles of a kind are out of order");
+            recorded += kind.count;
+        }
+
+        double seconds{ std::chrono::duration<double>(report.elapsed).count() };
+        double throughput{ static_cast<double>(recorded) / seconds };
+        expect(recorded > 0, "the replay recorded no statements");
+
+        if (arrival == arrival_model::open) {
+            expect(throughput > options.rate * 0.9 && throughput < options.rate * 1.1, "the open loop did not keep to its rate");
+        }
+
+        std::wcout << L"[+] Replayed a set of " << generated << L" statements " << (arrival == arrival_model::open ? L"in an open loop at " + std::to_wstring(size_t(options.rate)) + L"/s" : L"in a closed loop")
+            << L" on " << options.workers << L" simulated connections with a " << mean_latency.count() << L" us mean latency: "
+            << recorded << L" recorded in " << std::fixed << std::setprecision(2) << seconds << L" s (" << std::setprecision(0) << throughput << L"/s).\n";
+        print_report(report);
+        std::wcout << L'\n';
+    }
+
+    std::filesystem::remove(file_path);
+    return 0;
+}
@@ -0,0 +1,139 @@
+#include "bench.h"
+#include "row_source.h"
+#include "sampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+
+// Samples on the client, offering every row of the table, the way streamed statistics see them
+class streaming_memory_source : public memory_source {
+public:
+
+    using memory_source::memory_source;
+
+    uint64_t sample_rows(const table_info& table, row_sampler& sample) override {
+        return row_source::sample_rows(table, sample);
+    }
+};
+
+// The rows of every sample, as text or NULL, in table order
+using sample_rows_text = std::vector<std::vector<std::optional<std::wstring>>>;
+
+static sample_rows_text text_of_samples(const table_samples& sampled) {
+    sample_rows_text text{};
+
+    for (const auto& sample : sampled.samples) {
+        sample->for_each_row([&](const std::vector<field_value>& fields) {
+            auto& row{ text.emplace_back() };
+
+            for (const field_value& field : fields) {
+                row.emplace_back(field.null ? std::nullopt : std::optional<std::wstring>{ field.text });
+            }
+        });
+    }
+
+    return text;
+}
+
+// How far the median ID of every sample lands from that of its table, as a fraction of the table's rows
+static double median_error(const std::vector<std::shared_ptr<table_info>>& tables, const table_samples& sampled) {
+    double error{};
+
+    for (size_t t = 0; t < tables.size(); t++) {
+        std::vector<double> ids{};
+        sampled.samples[t]->for_each_row([&](const std::vector<field_value>& fields) {
+            ids.push_back(std::stod(std::wstring{ fields[0].text }));
+        });
+
+        if (ids.empty()) {
+            continue;
+        }
+
+        // IDs run from 1 to the row count
+        std::nth_element(ids.begin(), ids.begin() + ids.size() / 2, ids.end());
+        double rows{ static_cast<double>(tables[t]->row_estimate) };
+        error += std::abs(ids[ids.size() / 2] - (rows + 1.0) / 2.0) / rows;
+    }
+
+    return error / static_cast<double>(tables.size());
+}
+
+int run_sampling(bench_arguments arguments) {
+    size_t connections{ argument(arguments, "connections", 4) };
+    std::chrono::microseconds latency{ static_cast<int64_t>(argument(arguments, "latency", 200)) };
+    sampler_options options{ argument(arguments, "sample", 100), argument(arguments, "seed", 1) };
+
+    auto stored{ std::make_shared<const std::vector<std::shared_ptr<table_info>>>(
+        synthetic_tables(argument(arguments, "tables", 71), argument(arguments, "rows", 760000), options.seed)) };
+
+    // The tables as a catalog load sees them, without rows
+    std::vector<std::shared_ptr<table_info>> tables{ memory_source{ stored }.load_catalog() };
+    memory_source{ stored }.estimate_rows(tables);
+
+    struct strategy {
+        const wchar_t* name{};
+        bool pushed_down{};
+        std::wstring stratify_column{};
+    };
+
+    const strategy strategies[]{
+        { L"streamed", false },
+        { L"pushed-down", true },
+        { L"stratified", true, L"Active" },
+    };
+
+    std::wcout << L"[+] Sampled " << options.rows << L" rows from each of " << tables.size() << L" tables holding "
+        << total_rows(*stored) << L" rows, " << connections << L" connections, " << latency.count() << L" us round trips.\n"
+        << L"    strategy        rows read       ms    median error\n";
+
+    uint64_t streamed_read{};
+
+    for (const strategy& entry : strategies) {
+        sampler_options settings{ options };
+        settings.stratify_column = entry.stratify_column;
+
+        source_pool sources{ connections, [&]() -> std::unique_ptr<row_source> {
+            if (entry.pushed_down) {
+                return std::make_unique<memory_source>(stored, latency);
+            }
+            return std::make_unique<streaming_memory_source>(stored, latency);
+        } };
+
+        stopwatch watch{};
+        table_samples sampled{ sample_tables(sources, tables, settings) };
+        double seconds{ watch.seconds() };
+
+        for (size_t t = 0; t < tables.size(); t++) {
+            size_t kept{ sampled.samples[t]->size() };
+
+            // Strata share the rows, so a stratified sample may keep fewer when one value is rare
+            if (settings.stratify_column.empty()) {
+                expect(kept == std::min<size_t>(settings.rows, tables[t]->row_estimate), "a sample kept a wrong number of rows");
+            }
+            else {
+                expect(kept > 0 && kept <= settings.rows, "a stratified sample kept no rows or too many");
+            }
+        }
+
+        // The same seed picks the same rows
+        expect(text_of_samples(sampled) == text_of_samples(sample_tables(sources, tables, settings)), "sampling twice with the same seed kept different rows");
+
+        if (!entry.pushed_down) {
+            streamed_read = sampled.rows_read;
+            expect(streamed_read == total_rows(*stored), "streamed sampling did not offer every row");
+        }
+        else if (settings.stratify_column.empty()) {
+            expect(sampled.rows_read < streamed_read, "pushed-down sampling read as many rows as streaming them");
+        }
+
+        std::wcout << L"    " << std::left << std::setw(12) << entry.name << std::right << std::setw(13) << sampled.rows_read
+            << std::fixed << std::setprecision(1) << std::setw(9) << seconds * 1000.0
+            << std::setprecision(4) << std::setw(16) << median_error(tables, sampled) << L'\n';
+    }
+
+    std::wcout << L'\n';
+    return 0;
+}
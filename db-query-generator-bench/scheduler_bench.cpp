@@ -0,0 +1,88 @@
+#include "bench.h"
+#include "row_source.h"
+#include "scheduler.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+// Reads every table once through the sources, with tables dealt round-robin and never moved, as before work stealing
+static void run_static(std::vector<std::unique_ptr<memory_source>>& sources, const std::vector<std::shared_ptr<table_info>>& tables,
+    const std::vector<size_t>& order, std::vector<size_t>& rows) {
+    std::vector<std::thread> workers{};
+
+    for (size_t worker = 0; worker < sources.size(); worker++) {
+        workers.emplace_back([&, worker]() {
+            for (size_t i = worker; i < order.size(); i += sources.size()) {
+                sources[worker]->fetch_rows(*tables[order[i]], [&](std::span<const std::wstring_view>) { rows[order[i]]++; });
+            }
+        });
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+int run_scheduler(bench_arguments arguments) {
+    size_t worker_count{ argument(arguments, "workers", 4) };
+    size_t slowdown{ argument(arguments, "slowdown", 20) };
+    std::chrono::microseconds latency{ argument(arguments, "latency_us", 2000) };
+
+    auto tables{ std::make_shared<const std::vector<std::shared_ptr<table_info>>>(
+        synthetic_tables(argument(arguments, "tables", 71), argument(arguments, "rows", 20000), argument(arguments, "seed", 1))) };
+
+    // One source answers 'slowdown' times slower than the others, like a busy replica
+    std::chrono::microseconds slow_latency{ latency.count() * static_cast<int64_t>(slowdown) };
+    std::vector<std::unique_ptr<memory_source>> sources{};
+    for (size_t worker = 0; worker < worker_count; worker++) {
+        sources.push_back(std::make_unique<memory_source>(tables, worker == 0 ? slow_latency : latency));
+    }
+
+    // Largest tables first, as row_pipeline and sample_tables order them
+    std::vector<size_t> order(tables->size());
+    std::iota(order.begin(), order.end(), size_t{});
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return (*tables)[a]->row_count() > (*tables)[b]->row_count(); });
+
+    std::vector<size_t> static_rows(tables->size());
+    stopwatch watch{};
+    run_static(sources, *tables, order, static_rows);
+    double static_seconds{ watch.seconds() };
+
+    std::vector<size_t> stolen_rows(tables->size());
+    std::vector<size_t> tasks_run(worker_count);
+    std::mutex mutex{};
+    watch.restart();
+    work_stealing_scheduler{ worker_count }.run(order, [&](size_t worker, size_t table) {
+        size_t rows{};
+        sources[worker]->fetch_rows(*(*tables)[table], [&](std::span<const std::wstring_view>) { rows++; });
+
+        std::lock_guard<std::mutex> lock{ mutex };
+        stolen_rows[table] += rows;
+        tasks_run[worker]++;
+    });
+    double stolen_seconds{ watch.seconds() };
+
+    // Every table is read exactly once, whichever worker ran it
+    for (size_t table = 0; table < tables->size(); table++) {
+        expect(static_rows[table] == (*tables)[table]->row_count(), "the static split read a table a wrong number of times");
+        expect(stolen_rows[table] == (*tables)[table]->row_count(), "the scheduler read a table a wrong number of times");
+    }
+    expect(std::accumulate(tasks_run.begin(), tasks_run.end(), size_t{}) == tables->size(), "the scheduler ran a wrong number of tasks");
+
+    std::wcout << L"[+] Read " << tables->size() << L" tables on " << worker_count << L" workers; worker 0 waits "
+        << slow_latency.count() << L" us per call, the others " << latency.count() << L" us.\n";
+    std::wcout << std::fixed << std::setprecision(1)
+        << L"    Static split:   " << std::setw(8) << static_seconds * 1000.0 << L" ms\n"
+        << L"    Work stealing:  " << std::setw(8) << stolen_seconds * 1000.0 << L" ms (" << std::setprecision(2)
+        << static_seconds / stolen_seconds << L"x)\n    Tables per worker:";
+    for (size_t count : tasks_run) {
+        std::wcout << L' ' << count;
+    }
+    std::wcout << L"\n\n";
+
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include "bench.h"
+#include "statement_generation.h"
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+// Extracts the tables with the given number of connections and generates their statements on the given number of threads
+static std::vector<std::wstring> generate_rendered(const std::shared_ptr<const std::vector<std::shared_ptr<table_info>>>& tables,
+    size_t threads, uint64_t seed, double& seconds) {
+    source_pool sources{ threads, [&]() { return std::make_unique<keyed_memory_source>(tables); } };
+
+    catalog db{};
+    db.load(sources[0]);
+    sources[0].estimate_rows(db.tables());
+
+    sharded_statement_factory factory{ threads };
+    statement_sink sink{ factory, db, generation_budget{}, sampler_options{ 100, seed }, { 0.001, 0.01, 0.1, 0.5 } };
+
+    stopwatch watch{};
+    row_pipeline pipeline{};
+    pipeline.add_sink(sink);
+    pipeline.run(sources, db.tables());
+    seconds = watch.seconds();
+
+    // Every field of every statement, in stream order
+    std::vector<std::wstring> rendered{};
+    for (const rendered_statement& statement : factory.stream()) {
+        std::wostringstream text{};
+        text << statement.table << L'\n' << statement.sql << L'\n' << statement.label << L'\n' << statement.template_sql;
+
+        for (const statement_parameter& parameter : statement.parameters) {
+            text << L'\n' << parameter.value << L' ' << (parameter.type ? parameter.type->name : L"");
+        }
+
+        rendered.emplace_back(text.str());
+    }
+
+    return rendered;
+}
+
+int run_shards(bench_arguments arguments) {
+    size_t threads{ argument(arguments, "threads", 4) };
+    uint64_t seed{ argument(arguments, "seed", 1) };
+
+    auto tables{ std::make_shared<const std::vector<std::shared_ptr<table_info>>>(
+        synthetic_tables(argument(arguments, "tables", 71), argument(arguments, "rows", 50000), seed)) };
+
+    double serial_seconds{}, sharded_seconds{};
+    std::vector<std::wstring> serial{ generate_rendered(tables, 1, seed, serial_seconds) };
+    std::vector<std::wstring> sharded{ generate_rendered(tables, threads, seed, sharded_seconds) };
+
+    expect(serial.size() == sharded.size(), "the sharded run generated a different number of statements");
+
+    for (size_t i = 0; i < serial.size(); i++) {
+        if (serial[i] != sharded[i]) {
+            std::wcout << L"[!] Statement " << i << L" differs:\n" << serial[i] << L"\n---\n" << sharded[i] << L'\n';
+            expect(false, "the sharded run generated different statements");
+        }
+    }
+
+    std::wcout << L"[+] 1 and " << threads << L" threads generated the same " << serial.size() << L" statements.\n"
+        << std::fixed << std::setprecision(1)
+        << L"    1 thread:   " << std::setw(8) << serial_seconds * 1000.0 << L" ms\n"
+        << L"    " << threads << L" threads:  " << std::setw(8) << sharded_seconds * 1000.0 << L" ms\n\n";
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+#ifndef _BINARY_IO_H
+#define _BINARY_IO_H
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "encoding.h"
+
+/* Function Definitions
+************************************************************************/
+
+// Appends the bytes of a trivially copyable value
+template <typename T>
+void append_raw(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// Overwrites the bytes at 'at' with a trivially copyable value
+template <typename T>
+void put_raw(std::string& out, size_t at, const T& value) {
+    std::memcpy(out.data() + at, &value, sizeof(T));
+}
+
+// Appends a uint32 byte length followed by the UTF-8 encoding of the text
+inline void append_string(std::string& out, std::wstring_view text) {
+    size_t length_at{ out.size() };
+    append_raw(out, uint32_t{});
+    append_utf8(out, text);
+    put_raw(out, length_at, static_cast<uint32_t>(out.size() - length_at - sizeof(uint32_t)));
+}
+
+/* Type Definitions
+************************************************************************/
+
+/**
+ * @class byte_reader
+ * @brief Reads values written with append_raw() and append_string() back from a buffer.
+ *
+ * Every read is checked against the end of the buffer; reading past it throws
+ * std::runtime_error.
+ */
+class byte_reader {
+    std::string_view bytes{};
+    size_t pos{};
+    const char* what{};
+
+public:
+
+    /**
+     * @param bytes : The buffer to read.
+     * @param pos : The offset of the first value.
+     * @param what : Names the buffer in error messages.
+     */
+    byte_reader(std::string_view bytes, size_t pos, const char* what) :
+        bytes(bytes), pos(pos), what(what) {}
+
+    template <typename T>
+    T read() {
+        require(sizeof(T));
+
+        T value{};
+        std::memcpy(&value, bytes.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+
+    // Returns a view of the UTF-8 characters, pointing into the buffer
+    std::string_view read_string() {
+        uint32_t length{ read<uint32_t>() };
+        require(length);
+
+        std::string_view text{ bytes.substr(pos, length) };
+        pos += length;
+        return text;
+    }
+
+    size_t position() const { return pos; }
+
+private:
+    void require(size_t count) const {
+        if (pos > bytes.size() || bytes.size() - pos < count) {
+            throw std::runtime_error{ std::string{ "Truncated " } + what };
+        }
+    }
+};
+
+#endif // !_BINARY_IO_H
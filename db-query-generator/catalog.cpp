@@ -0,0 +1,214 @@
+#include "catalog.h"
+#include "binary_io.h"
+#include "mapped_file.h"
+#include "output_file.h"
+
+#include <algorithm>
+
+static constexpr std::string_view cache_magic{ "DBQC0003" };
+
+void catalog::load(row_source& source) {
+    auto start{ std::chrono::steady_clock::now() };
+
+    std::vector<std::shared_ptr<table_info>> loaded{ source.load_catalog() };
+
+    table_list.clear();
+    index.clear();
+    index.reserve(loaded.size());
+
+    for (auto& table : loaded) {
+        add(std::move(table));
+    }
+
+    link(source.load_foreign_keys());
+    elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+}
+
+// Layout: magic, uint64 fingerprint, uint32 table count, then per table the schema,
+// name, uint64 row estimate and uint32 column count, then per column the name,
+// data type, int32 ordinal and uint8 primary key flag; then uint32 key count, then per
+// foreign key the name, schema, table, referenced schema, referenced table and uint32
+// column count, then per column the name and referenced name; strings are written with append_string()
+uint64_t catalog::load(const std::filesystem::path& file_path) {
+    auto start{ std::chrono::steady_clock::now() };
+
+    mapped_file file{ file_path };
+    std::string_view bytes{ file.bytes() };
+
+    if (bytes.substr(0, cache_magic.size()) != cache_magic) {
+        throw std::runtime_error{ "Not a catalog cache: " + file_path.string() };
+    }
+
+    byte_reader reader{ bytes, cache_magic.size(), "catalog cache" };
+    uint64_t fingerprint{ reader.read<uint64_t>() };
+    uint32_t table_count{ reader.read<uint32_t>() };
+
+    std::vector<std::shared_ptr<table_info>> loaded{};
+    loaded.reserve(table_count);
+
+    for (uint32_t t{}; t < table_count; t++) {
+        std::wstring schema{ utf8_to_wide(reader.read_string()) };
+        std::wstring name{ utf8_to_wide(reader.read_string()) };
+
+        auto table{ std::make_shared<table_info>(table_info{ name, schema }) };
+        table->row_estimate = static_cast<size_t>(reader.read<uint64_t>());
+
+        uint32_t column_count{ reader.read<uint32_t>() };
+        table->columns.reserve(column_count);
+
+        for (uint32_t c{}; c < column_count; c++) {
+            std::wstring column_name{ utf8_to_wide(reader.read_string()) };
+            std::wstring data_type{ utf8_to_wide(reader.read_string()) };
+
+            table->columns.emplace_back(std::make_shared<column_info>(column_info{ column_name, data_type }));
+            table->columns.back()->ordinal = reader.read<int32_t>();
+            table->columns.back()->primary_key = reader.read<uint8_t>() != 0;
+        }
+
+        loaded.emplace_back(std::move(table));
+    }
+
+    uint32_t key_count{ reader.read<uint32_t>() };
+    std::vector<foreign_key> keys(key_count);
+
+    for (foreign_key& key : keys) {
+        key.name = utf8_to_wide(reader.read_string());
+        key.schema = utf8_to_wide(reader.read_string());
+        key.table = utf8_to_wide(reader.read_string());
+        key.referenced_schema = utf8_to_wide(reader.read_string());
+        key.referenced_table = utf8_to_wide(reader.read_string());
+
+        uint32_t column_count{ reader.read<uint32_t>() };
+
+        for (uint32_t c{}; c < column_count; c++) {
+            key.columns.emplace_back(utf8_to_wide(reader.read_string()));
+            key.referenced_columns.emplace_back(utf8_to_wide(reader.read_string()));
+        }
+    }
+
+    table_list.clear();
+    index.clear();
+    index.reserve(loaded.size());
+
+    for (auto& table : loaded) {
+        add(std::move(table));
+    }
+
+    link(std::move(keys));
+    elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    return fingerprint;
+}
+
+void catalog::save(const std::filesystem::path& file_path, uint64_t fingerprint) const {
+    std::filesystem::path temp_path{ file_path };
+    temp_path += ".tmp";
+
+    output_file file{};
+    file.open(temp_path);
+
+    std::string& out{ file.buffer() };
+    out.append(cache_magic);
+    append_raw(out, fingerprint);
+    append_raw(out, static_cast<uint32_t>(table_list.size()));
+
+    for (const auto& table : table_list) {
+        append_string(out, table->schema);
+        append_string(out, table->name);
+        append_raw(out, static_cast<uint64_t>(table->row_estimate));
+        append_raw(out, static_cast<uint32_t>(table->columns.size()));
+
+        for (const auto& column : table->columns) {
+            append_string(out, column->name);
+            append_string(out, column->data_type);
+            append_raw(out, static_cast<int32_t>(column->ordinal));
+            append_raw(out, static_cast<uint8_t>(column->primary_key));
+        }
+
+        file.commit();
+    }
+
+    append_raw(out, static_cast<uint32_t>(key_list.size()));
+
+    for (const auto& key : key_list) {
+        append_string(out, key.name);
+        append_string(out, key.schema);
+        append_string(out, key.table);
+        append_string(out, key.referenced_schema);
+        append_string(out, key.referenced_table);
+        append_raw(out, static_cast<uint32_t>(key.columns.size()));
+
+        for (size_t c{}; c < key.columns.size(); c++) {
+            append_string(out, key.columns[c]);
+            append_string(out, key.referenced_columns[c]);
+        }
+
+        file.commit();
+    }
+
+    file.close();
+    std::filesystem::rename(temp_path, file_path);
+}
+
+void catalog::add(std::shared_ptr<table_info> table) {
+    auto [found, inserted] { index.try_emplace(table->schema + L'.' + table->name, table) };
+
+    if (inserted) {
+        table_list.emplace_back(std::move(table));
+        return;
+    }
+
+    std::replace(table_list.begin(), table_list.end(), found->second, table);
+    found->second = std::move(table);
+}
+
+std::shared_ptr<table_info> catalog::find(std::wstring_view schema, std::wstring_view name) const {
+    std::wstring qualified_name{ schema };
+    qualified_name.push_back(L'.');
+    qualified_name.append(name);
+
+    return find(qualified_name);
+}
+
+std::shared_ptr<table_info> catalog::find(const std::wstring& qualified_name) const {
+    auto found{ index.find(qualified_name) };
+    return found == index.end() ? nullptr : found->second;
+}
+
+// Keys whose columns do not all exist cannot be joined on, so they stay out of the graph like self-references do
+void catalog::link(std::vector<foreign_key> keys) {
+    key_list = std::move(keys);
+    graph.assign(table_list.size(), {});
+
+    std::unordered_map<const table_info*, size_t> position{};
+    for (size_t i{}; i < table_list.size(); i++) {
+        position.emplace(table_list[i].get(), i);
+    }
+
+    auto has_columns = [](const table_info& table, const std::vector<std::wstring>& names) {
+        return std::all_of(names.begin(), names.end(), [&](const std::wstring& name) {
+            return std::any_of(table.columns.begin(), table.columns.end(), [&](const auto& column) { return column->name == name; });
+        });
+    };
+
+    for (size_t k{}; k < key_list.size(); k++) {
+        const foreign_key& key{ key_list[k] };
+
+        auto from{ find(key.schema, key.table) };
+        auto to{ find(key.referenced_schema, key.referenced_table) };
+
+        if (!from || !to || from == to || key.columns.empty() || key.columns.size() != key.referenced_columns.size()
+            || !has_columns(*from, key.columns) || !has_columns(*to, key.referenced_columns)) {
+            continue;
+        }
+
+        size_t referencing{ position.at(from.get()) };
+        size_t referenced{ position.at(to.get()) };
+
+        graph[referencing].emplace_back(join_edge{ referenced, k, true });
+        graph[referenced].emplace_back(join_edge{ referencing, k, false });
+    }
+}
+
+std::span<const join_edge> catalog::joins(size_t table) const {
+    return table < graph.size() ? std::span<const join_edge>{ graph[table] } : std::span<const join_edge>{};
+}
@@ -0,0 +1,113 @@
+#ifndef _CATALOG_H
+#define _CATALOG_H
+
+#include <chrono>
+#include <filesystem>
+#include <span>
+#include <unordered_map>
+
+#include "row_source.h"
+
+// A foreign key seen from one of the two tables it joins
+struct join_edge {
+    size_t table{};         ///< The table at the other end, as an index into catalog::tables().
+    size_t key{};           ///< The key, as an index into catalog::foreign_keys().
+    bool referencing{};     ///< Whether the table the edge leaves holds the referencing columns.
+};
+
+/**
+ * @class catalog
+ * @brief The tables and columns of a database, indexed by qualified name, and the foreign keys between them.
+ *
+ * The foreign keys are kept as an adjacency graph over the tables: every key is
+ * an edge both ways, so joins can be walked from either end. Keys of a table to
+ * itself and keys to tables outside the catalog are left out of the graph.
+ */
+class catalog {
+    std::vector<std::shared_ptr<table_info>> table_list{};
+    std::unordered_map<std::wstring, std::shared_ptr<table_info>> index{};
+    std::vector<foreign_key> key_list{};
+    std::vector<std::vector<join_edge>> graph{};    ///< The edges leaving every table, in table order.
+    std::chrono::microseconds elapsed{};
+
+public:
+
+    /**
+     * @brief Loads every table, column and foreign key from the source, in one call for each.
+     *
+     * @param source : The source to describe.
+     */
+    void load(row_source& source);
+
+    /**
+     * @brief Loads the tables, columns and foreign keys from a cache file written by save().
+     *
+     * Throws std::runtime_error if the file is missing or malformed.
+     *
+     * @param file_path : The cache file.
+     * @return The schema fingerprint the cache was saved with.
+     */
+    uint64_t load(const std::filesystem::path& file_path);
+
+    /**
+     * @brief Saves the tables, columns, row estimates and foreign keys to a compact cache file.
+     *
+     * The file is written next to its destination and then renamed over it, so an
+     * interrupted save leaves the previous cache intact.
+     *
+     * @param file_path : The cache file.
+     * @param fingerprint : The schema fingerprint of the source the catalog describes.
+     */
+    void save(const std::filesystem::path& file_path, uint64_t fingerprint) const;
+
+    /**
+     * @brief Adds a table to the catalog, replacing any table with the same name.
+     *
+     * @param table : The table to add.
+     */
+    void add(std::shared_ptr<table_info> table);
+
+    /**
+     * @brief Looks up a table by schema and name.
+     *
+     * @return The table, or nullptr if the catalog has no such table.
+     */
+    std::shared_ptr<table_info> find(std::wstring_view schema, std::wstring_view name) const;
+
+    /**
+     * @brief Looks up a table by its 'schema.table' name.
+     *
+     * @return The table, or nullptr if the catalog has no such table.
+     */
+    std::shared_ptr<table_info> find(const std::wstring& qualified_name) const;
+
+    /**
+     * @brief Returns the tables in the order the source listed them.
+     */
+    const std::vector<std::shared_ptr<table_info>>& tables() const { return table_list; }
+
+    /**
+     * @brief Returns the foreign keys the source listed.
+     */
+    const std::vector<foreign_key>& foreign_keys() const { return key_list; }
+
+    /**
+     * @brief Returns the foreign keys a table can be joined through, as of the last load().
+     *
+     * @param table : The index of the table in tables().
+     * @return The edges to the tables it references and to those referencing it.
+     */
+    std::span<const join_edge> joins(size_t table) const;
+
+    /**
+     * @brief Returns the time the last load() took.
+     */
+    std::chrono::microseconds load_time() const { return elapsed; }
+
+    size_t size() const { return table_list.size(); }
+
+private:
+    void link(std::vector<foreign_key> keys);
+};
+
+#endif // !_CATALOG_H
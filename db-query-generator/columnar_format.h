@@ -0,0 +1,36 @@
+#ifndef _COLUMNAR_FORMAT_H
+#define _COLUMNAR_FORMAT_H
+
+#include <cstdint>
+#include <string_view>
+
+#include "data_types.h"
+
+/* Type Definitions
+************************************************************************/
+
+// Opens and closes every columnar snapshot
+inline constexpr std::string_view columnar_magic{ "DBQS0001" };
+
+// How the values of a column are stored in the file
+enum struct column_kind : uint8_t {
+    int64,      ///< Little-endian int64_t per row.
+    float64,    ///< IEEE 754 double per row.
+    boolean,    ///< One bit per row, least significant bit first.
+    utf8        ///< UTF-8 text; decimals and dates are kept as text so they stay exact.
+};
+
+// How the values of a single column chunk are laid out
+enum struct chunk_encoding : uint8_t {
+    plain,      ///< The values, in row order.
+    dictionary  ///< utf8 only: the distinct values, then one index per row.
+};
+
+/**
+ * @brief Returns the storage kind of a column of the given type.
+ *
+ * @param type : The data type of the column.
+ */
+column_kind column_kind_from_type(data_types type);
+
+#endif // !_COLUMNAR_FORMAT_H
@@ -0,0 +1,341 @@
+#include "columnar_output.h"
+#include "binary_io.h"
+#include "encoding.h"
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <stdexcept>
+
+static_assert(std::endian::native == std::endian::little, "The columnar format is written in native byte order");
+
+// Numbers as some sources write them, with a leading '+' that std::from_chars rejects
+template <typename T>
+static bool parse_signed_number(std::wstring_view value, T& result) {
+    if (value.size() > 1 && value.front() == L'+') {
+        value.remove_prefix(1);
+    }
+
+    return parse_number(value, result);
+}
+
+static bool parse_boolean(std::wstring_view value, bool& result) {
+    if (value == L"1" || value == L"true" || value == L"True" || value == L"TRUE") {
+        result = true;
+        return true;
+    }
+    else if (value == L"0" || value == L"false" || value == L"False" || value == L"FALSE") {
+        result = false;
+        return true;
+    }
+
+    return false;
+}
+
+static std::runtime_error conversion_error(const table_info& table, const column_info& column, std::wstring_view value) {
+    return std::runtime_error{ "Cannot store '" + wide_to_utf8(value) + "' in column " +
+        wide_to_utf8(table.schema + L'.' + table.name + L'.' + column.name) + " (" + wide_to_utf8(column.data_type) + ")" };
+}
+
+column_kind column_kind_from_type(data_types type) {
+    switch (type) {
+    case data_types::ext_bit:
+        return column_kind::boolean;
+    case data_types::ext_tinyint:
+    case data_types::ext_smallint:
+    case data_types::ext_int:
+    case data_types::ext_bigint:
+        return column_kind::int64;
+    case data_types::aprx_float:
+    case data_types::aprx_real:
+        return column_kind::float64;
+    default:
+        return column_kind::utf8;
+    }
+}
+
+// --------------------
+// START OF COLUMNAR WRITER FUNCTIONS
+// --------------------
+
+columnar_writer::columnar_writer(std::filesystem::path file_path) :
+    file_path(std::move(file_path)) {}
+
+void columnar_writer::begin_database(const std::vector<std::shared_ptr<table_info>>& tables) {
+    this->tables = tables;
+    states.clear();
+    states.resize(tables.size());
+    table_index.clear();
+
+    for (size_t i{}; i < tables.size(); i++) {
+        table_index.emplace(tables[i].get(), i);
+
+        for (const auto& column : tables[i]->columns) {
+            states[i].columns.emplace_back(column_state{ column_kind_from_type(column->type->type) });
+        }
+    }
+
+    output.open(file_path);
+    output.write(columnar_magic);
+}
+
+void columnar_writer::write_rows(const table_info& table, const table_info& chunk) {
+    if (chunk.row_count() == 0) {
+        return;
+    }
+
+    table_state& state{ states[table_index.at(&table)] };
+
+    for (size_t c{}; c < state.columns.size(); c++) {
+        column_state& column{ state.columns[c] };
+
+        align();
+        uint64_t offset{ output.size() };
+        chunk_encoding encoding{};
+
+        switch (column.kind) {
+        case column_kind::int64:
+        case column_kind::float64:
+            encoding = write_numbers(table, chunk, c, column.kind);
+            break;
+        case column_kind::boolean:
+            encoding = write_booleans(table, chunk, c);
+            break;
+        case column_kind::utf8:
+            encoding = write_strings(chunk, c);
+            break;
+        }
+
+        column.chunks.emplace_back(chunk_ref{ offset, output.size() - offset, static_cast<uint32_t>(chunk.row_count()), encoding });
+        output.commit();
+    }
+}
+
+void columnar_writer::end_table(const table_info& table, size_t row_count) {
+    states[table_index.at(&table)].row_count = row_count;
+}
+
+void columnar_writer::end_database() {
+    align();
+    uint64_t directory_offset{ output.size() };
+
+    write_directory();
+
+    std::string& out{ output.buffer() };
+    append_raw(out, directory_offset);
+    out.append(columnar_magic);
+
+    output.close();
+}
+
+// Null fields are stored as missing values; numbers the row store kept as text are parsed
+chunk_encoding columnar_writer::write_numbers(const table_info& table, const table_info& chunk, size_t column, column_kind kind) {
+    size_t bitmap_at{ write_validity(chunk.row_count()) };
+    std::string& out{ output.buffer() };
+
+    for (size_t i{}; i < chunk.row_count(); i++) {
+        field_value value{ chunk.field(i, column) };
+        bool present{ !value.null };
+        bool parsed{ present };
+
+        if (kind == column_kind::int64) {
+            int64_t number{ value.integer };
+
+            if (present && value.kind != value_storage::integer) {
+                parsed = value.kind == value_storage::text && parse_signed_number(value.text, number);
+            }
+
+            append_raw(out, number);
+        }
+        else {
+            double number{ value.real };
+
+            if (present && value.kind != value_storage::real) {
+                parsed = value.kind == value_storage::text && parse_signed_number(value.text, number);
+            }
+
+            append_raw(out, number);
+        }
+
+        if (present && !parsed) {
+            number_buffer digits{};
+            throw conversion_error(table, *chunk.columns[column], format_field(value, digits));
+        }
+
+        if (present) {
+            out[bitmap_at + i / 8] |= static_cast<char>(1 << (i % 8));
+        }
+    }
+
+    return chunk_encoding::plain;
+}
+
+chunk_encoding columnar_writer::write_booleans(const table_info& table, const table_info& chunk, size_t column) {
+    size_t bitmap_at{ write_validity(chunk.row_count()) };
+    std::string& out{ output.buffer() };
+    size_t values_at{ out.size() };
+    out.append((chunk.row_count() + 7) / 8, '\0');
+
+    for (size_t i{}; i < chunk.row_count(); i++) {
+        field_value value{ chunk.field(i, column) };
+
+        if (value.null) {
+            continue;
+        }
+
+        bool flag{ value.integer != 0 };
+        if (value.kind != value_storage::integer && (value.kind != value_storage::text || !parse_boolean(value.text, flag))) {
+            number_buffer digits{};
+            throw conversion_error(table, *chunk.columns[column], format_field(value, digits));
+        }
+
+        out[bitmap_at + i / 8] |= static_cast<char>(1 << (i % 8));
+
+        if (flag) {
+            out[values_at + i / 8] |= static_cast<char>(1 << (i % 8));
+        }
+    }
+
+    return chunk_encoding::plain;
+}
+
+// NULLs are missing from the validity bitmap and written as empty strings; empty strings are present.
+// Only columns of text types are written as strings, and the row store keeps those as text.
+chunk_encoding columnar_writer::write_strings(const table_info& chunk, size_t column) {
+    size_t bitmap_at{ write_validity(chunk.row_count()) };
+
+    for (size_t i{}; i < chunk.row_count(); i++) {
+        if (!chunk.field(i, column).null) {
+            output.buffer()[bitmap_at + i / 8] |= static_cast<char>(1 << (i % 8));
+        }
+    }
+
+    if (build_dictionary(chunk, column)) {
+        std::string& out{ output.buffer() };
+        append_raw(out, static_cast<uint32_t>(entries.size()));
+        write_characters(entries);
+
+        if (entries.size() <= 256) {
+            for (uint32_t index : indices) {
+                append_raw(out, static_cast<uint8_t>(index));
+            }
+        }
+        else {
+            for (uint32_t index : indices) {
+                append_raw(out, static_cast<uint16_t>(index));
+            }
+        }
+
+        return chunk_encoding::dictionary;
+    }
+
+    entries.clear();
+    for (size_t i{}; i < chunk.row_count(); i++) {
+        entries.emplace_back(chunk.field(i, column).text);
+    }
+
+    write_characters(entries);
+    return chunk_encoding::plain;
+}
+
+// Collects the distinct values of a column chunk; false when they are too many to pay off
+bool columnar_writer::build_dictionary(const table_info& chunk, size_t column) {
+    size_t limit{ std::min<size_t>(chunk.row_count() / 2, std::numeric_limits<uint16_t>::max() + size_t{ 1 }) };
+
+    dictionary.clear();
+    entries.clear();
+    indices.clear();
+
+    for (size_t i{}; i < chunk.row_count(); i++) {
+        std::wstring_view value{ chunk.field(i, column).text };
+        auto [found, inserted] { dictionary.try_emplace(value, static_cast<uint32_t>(entries.size())) };
+
+        if (inserted) {
+            if (entries.size() == limit) {
+                return false;
+            }
+
+            entries.emplace_back(value);
+        }
+
+        indices.emplace_back(found->second);
+    }
+
+    return true;
+}
+
+// Appends a validity bitmap with every row missing and returns where it starts in the buffer
+size_t columnar_writer::write_validity(size_t row_count) {
+    std::string& out{ output.buffer() };
+    size_t bitmap_at{ out.size() };
+
+    out.append((row_count + 7) / 8, '\0');
+
+    align();
+    return bitmap_at;
+}
+
+// Appends uint32 offsets[values + 1] and the UTF-8 characters they point into
+void columnar_writer::write_characters(const std::vector<std::wstring_view>& values) {
+    characters.clear();
+
+    std::string& out{ output.buffer() };
+    append_raw(out, uint32_t{});
+
+    for (const auto& value : values) {
+        append_utf8(characters, value);
+
+        if (characters.size() > std::numeric_limits<uint32_t>::max()) {
+            throw std::runtime_error{ "Column chunk holds more than 4 GiB of text" };
+        }
+
+        append_raw(out, static_cast<uint32_t>(characters.size()));
+    }
+
+    align();
+    out.append(characters);
+    align();
+}
+
+void columnar_writer::write_directory() {
+    std::string& out{ output.buffer() };
+    append_raw(out, static_cast<uint32_t>(tables.size()));
+
+    for (size_t t{}; t < tables.size(); t++) {
+        const table_info& table{ *tables[t] };
+        const table_state& state{ states[t] };
+
+        append_string(out, table.schema);
+        append_string(out, table.name);
+        append_raw(out, state.row_count);
+        append_raw(out, static_cast<uint32_t>(table.columns.size()));
+
+        for (size_t c{}; c < table.columns.size(); c++) {
+            const column_state& column{ state.columns[c] };
+
+            append_string(out, table.columns[c]->name);
+            append_string(out, table.columns[c]->data_type);
+            append_raw(out, column.kind);
+            append_raw(out, static_cast<uint32_t>(column.chunks.size()));
+
+            for (const auto& chunk : column.chunks) {
+                append_raw(out, chunk.offset);
+                append_raw(out, chunk.size);
+                append_raw(out, chunk.row_count);
+                append_raw(out, chunk.encoding);
+            }
+        }
+
+        output.commit();
+    }
+}
+
+// Pads the output with zeros up to the next 8-byte boundary
+void columnar_writer::align() {
+    size_t padding{ static_cast<size_t>((8 - output.size() % 8) % 8) };
+    output.buffer().append(padding, '\0');
+}
+
+// --------------------
+// END OF COLUMNAR WRITER FUNCTIONS
+// --------------------
@@ -0,0 +1,94 @@
+#ifndef _COLUMNAR_OUTPUT_H
+#define _COLUMNAR_OUTPUT_H
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "columnar_format.h"
+#include "exporter.h"
+#include "output_file.h"
+
+/**
+ * @class columnar_writer
+ * @brief Writes the extracted tables to a memory-mappable binary column store.
+ *
+ * Every chunk of rows the pipeline delivers becomes one chunk per column, written
+ * as soon as it arrives, so tables may interleave freely in the file. All integers
+ * are little-endian and every array starts on an 8-byte boundary from the start of
+ * the file, so a reader can map the file and use the arrays in place.
+ *
+ * File layout:
+ *  - "DBQS0001"
+ *  - column chunks, each starting with a validity bitmap of ceil(rows / 8) bytes
+ *    (bit set when the value is present), padded to 8 bytes, then:
+ *     - int64 / float64 : the values, 8 bytes each;
+ *     - boolean : a bitmap of the values;
+ *     - utf8 plain : uint32 offsets[rows + 1], padding, the characters;
+ *     - utf8 dictionary : uint32 entry count, uint32 offsets[entries + 1], padding,
+ *       the characters, padding, then one index per row, uint8 when there are at
+ *       most 256 entries and uint16 otherwise.
+ *  - the directory:
+ *     - uint32 table count, then per table: schema, name, uint64 row count,
+ *       uint32 column count, then per column: name, data type, uint8 column_kind,
+ *       uint32 chunk count, then per chunk: uint64 offset, uint64 byte size,
+ *       uint32 row count, uint8 chunk_encoding.
+ *     - Strings are a uint32 byte length followed by UTF-8 characters.
+ *  - uint64 offset of the directory, then "DBQS0001" again.
+ */
+class columnar_writer : public snapshot_exporter {
+    struct chunk_ref {
+        uint64_t offset{}, size{};
+        uint32_t row_count{};
+        chunk_encoding encoding{};
+    };
+
+    struct column_state {
+        column_kind kind{};
+        std::vector<chunk_ref> chunks{};
+    };
+
+    struct table_state {
+        std::vector<column_state> columns{};
+        uint64_t row_count{};
+    };
+
+    std::filesystem::path file_path{};
+    output_file output{};
+    std::vector<std::shared_ptr<table_info>> tables{};
+    std::unordered_map<const table_info*, size_t> table_index{};
+    std::vector<table_state> states{};
+
+    // Reused between chunks
+    std::string characters{};
+    std::unordered_map<std::wstring_view, uint32_t> dictionary{};
+    std::vector<std::wstring_view> entries{};
+    std::vector<uint32_t> indices{};
+
+public:
+
+    /**
+     * @param file_path : The file to write the snapshot to.
+     */
+    columnar_writer(std::filesystem::path file_path);
+
+    const std::filesystem::path& path() const override { return file_path; }
+
+    void begin_database(const std::vector<std::shared_ptr<table_info>>& tables) override;
+    void write_rows(const table_info& table, const table_info& chunk) override;
+    void end_table(const table_info& table, size_t row_count) override;
+    void end_database() override;
+
+private:
+    chunk_encoding write_numbers(const table_info& table, const table_info& chunk, size_t column, column_kind kind);
+    chunk_encoding write_booleans(const table_info& table, const table_info& chunk, size_t column);
+    chunk_encoding write_strings(const table_info& chunk, size_t column);
+    bool build_dictionary(const table_info& chunk, size_t column);
+    size_t write_validity(size_t row_count);
+    void write_characters(const std::vector<std::wstring_view>& values);
+    void write_directory();
+    void align();
+};
+
+#endif // !_COLUMNAR_OUTPUT_H
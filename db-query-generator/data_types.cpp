@@ -0,0 +1,109 @@
+#include "data_types.h"
+
+#include <algorithm>
+#include <array>
+#include <initializer_list>
+
+// Numbers are written as they are
+static std::wstring bare_literal(std::wstring_view value) {
+    return std::wstring{ value };
+}
+
+// Quotes a value, doubling the quotes inside it; 'prefix' is the N of Unicode strings, if any
+static std::wstring quote(std::wstring_view value, std::wstring_view prefix) {
+    std::wstring literal{};
+    literal.reserve(value.size() + prefix.size() + 2);
+
+    literal += prefix;
+    literal += L'\'';
+
+    for (wchar_t ch : value) {
+        if (ch == L'\'') {
+            literal += L'\'';
+        }
+
+        literal += ch;
+    }
+
+    literal += L'\'';
+    return literal;
+}
+
+static std::wstring quoted_literal(std::wstring_view value) {
+    return quote(value, {});
+}
+
+static std::wstring unicode_literal(std::wstring_view value) {
+    return quote(value, L"N");
+}
+
+static constexpr comparison_set operators(std::initializer_list<comparison_operators> ops) {
+    comparison_set set{};
+
+    for (auto op : ops) {
+        set |= static_cast<comparison_set>(1u << static_cast<unsigned>(op));
+    }
+
+    return set;
+}
+
+using enum comparison_operators;
+
+// Orderable types take every operator; strings are only compared for equality, as their order depends on the collation
+static constexpr comparison_set ordered_operators{ operators({ equals, not_equals, greater, less, greater_equals, less_equals, is }) };
+static constexpr comparison_set equality_operators{ operators({ equals, not_equals, is }) };
+
+// Every known type, sorted by name so a name is found by binary search
+static constexpr std::array<data_type_info, 23> type_registry{ {
+    { L"bigint", data_types::ext_bigint, data_type_groups::exact_numeric, value_storage::integer, ordered_operators, bare_literal },
+    { L"bit", data_types::ext_bit, data_type_groups::exact_numeric, value_storage::integer, ordered_operators, bare_literal },
+    { L"char", data_types::str_char, data_type_groups::character_string, value_storage::text, equality_operators, quoted_literal },
+    { L"date", data_types::dat_date, data_type_groups::date_and_time, value_storage::text, ordered_operators, quoted_literal },
+    { L"datetime", data_types::dat_datetime, data_type_groups::date_and_time, value_storage::text, ordered_operators, quoted_literal },
+    { L"datetime2", data_types::dat_datetime2, data_type_groups::date_and_time, value_storage::text, ordered_operators, quoted_literal },
+    { L"datetimeoffset", data_types::dat_datetimeoffset, data_type_groups::date_and_time, value_storage::text, ordered_operators, quoted_literal },
+    { L"decimal", data_types::ext_decimal, data_type_groups::exact_numeric, value_storage::text, ordered_operators, bare_literal },
+    { L"float", data_types::aprx_float, data_type_groups::approximate_numeric, value_storage::real, ordered_operators, bare_literal },
+    { L"int", data_types::ext_int, data_type_groups::exact_numeric, value_storage::integer, ordered_operators, bare_literal },
+    { L"money", data_types::ext_money, data_type_groups::exact_numeric, value_storage::text, ordered_operators, bare_literal },
+    { L"nchar", data_types::uni_str_nchar, data_type_groups::unicode_character_string, value_storage::text, equality_operators, unicode_literal },
+    { L"ntext", data_types::uni_str_ntext, data_type_groups::unicode_character_string, value_storage::text, equality_operators, unicode_literal },
+    { L"numeric", data_types::ext_numeric, data_type_groups::exact_numeric, value_storage::text, ordered_operators, bare_literal },
+    { L"nvarchar", data_types::uni_str_nvarchar, data_type_groups::unicode_character_string, value_storage::text, equality_operators, unicode_literal },
+    { L"real", data_types::aprx_real, data_type_groups::approximate_numeric, value_storage::real, ordered_operators, bare_literal },
+    { L"smalldatetime", data_types::dat_smalldatetime, data_type_groups::date_and_time, value_storage::text, ordered_operators, quoted_literal },
+    { L"smallint", data_types::ext_smallint, data_type_groups::exact_numeric, value_storage::integer, ordered_operators, bare_literal },
+    { L"smallmoney", data_types::ext_smallmoney, data_type_groups::exact_numeric, value_storage::text, ordered_operators, bare_literal },
+    { L"text", data_types::str_text, data_type_groups::character_string, value_storage::text, equality_operators, quoted_literal },
+    { L"time", data_types::dat_time, data_type_groups::date_and_time, value_storage::text, ordered_operators, quoted_literal },
+    { L"tinyint", data_types::ext_tinyint, data_type_groups::exact_numeric, value_storage::integer, ordered_operators, bare_literal },
+    { L"varchar", data_types::str_varchar, data_type_groups::character_string, value_storage::text, equality_operators, quoted_literal },
+} };
+
+static_assert(std::is_sorted(type_registry.begin(), type_registry.end(), [](const data_type_info& a, const data_type_info& b) { return a.name < b.name; }),
+    "The type registry must stay sorted by name");
+
+// Nothing is known about the values of unregistered types but whether they are null
+static constexpr data_type_info unknown_type{ L"", data_types::unknown, data_type_groups::unknown, value_storage::text, operators({ is }), quoted_literal };
+
+// How every comparison_operators is written, in enumerator order
+static constexpr std::array<std::wstring_view, 7> comparison_spellings{ L"=", L"!=", L">", L"<", L">=", L"<=", L"IS" };
+
+static_assert(comparison_spellings.size() == static_cast<size_t>(is) + 1, "Every operator needs a spelling");
+
+const data_type_info& lookup_type(std::wstring_view type) {
+    auto found{ std::lower_bound(type_registry.begin(), type_registry.end(), type, [](const data_type_info& entry, std::wstring_view name) { return entry.name < name; }) };
+    return found != type_registry.end() && found->name == type ? *found : unknown_type;
+}
+
+std::wstring_view comparison_sql(comparison_operators op) {
+    return comparison_spellings[static_cast<size_t>(op)];
+}
+
+data_types type_from_string(const std::wstring_view& type) {
+    return lookup_type(type).type;
+}
+
+data_type_groups type_group_from_string(const std::wstring_view& type) {
+    return lookup_type(type).group;
+}
@@ -0,0 +1,122 @@
+#ifndef _DATA_TYPES_H
+#define _DATA_TYPES_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/* Type Definitions
+************************************************************************/
+enum struct data_types {
+    unknown,
+    ext_bit,
+    ext_tinyint,
+    ext_smallint,
+    ext_int,
+    ext_bigint,
+    ext_decimal,
+    ext_numeric,
+    ext_smallmoney,
+    ext_money,
+    aprx_float,
+    aprx_real,
+    dat_date,
+    dat_datetime,
+    dat_datetime2,
+    dat_datetimeoffset,
+    dat_smalldatetime,
+    dat_time,
+    str_char,
+    str_varchar,
+    str_text,
+    str_nchar,
+    str_nvarchar,
+    str_ntext,
+    uni_str_nchar,
+    uni_str_nvarchar,
+    uni_str_ntext
+};
+enum struct data_type_groups {
+    unknown,
+    exact_numeric,
+    approximate_numeric,
+    date_and_time,
+    character_string,
+    unicode_character_string
+};
+// How the values of a type are kept in memory
+enum struct value_storage : uint8_t {
+    text,       ///< As extracted, in the character arena of the table.
+    integer,    ///< As int64_t.
+    real        ///< As double.
+};
+enum struct comparison_operators : uint8_t {
+    equals,
+    not_equals,
+    greater,
+    less,
+    greater_equals,
+    less_equals,
+    is
+};
+
+// A set of comparison_operators, one bit per operator
+using comparison_set = uint8_t;
+
+// Writes a value of a type as a SQL literal
+using literal_formatter = std::wstring(*)(std::wstring_view value);
+
+/**
+ * @struct data_type_info
+ * @brief Everything known about a SQL Server type, resolved once per column.
+ */
+struct data_type_info {
+    std::wstring_view name{};               ///< The type name, as reported by INFORMATION_SCHEMA.COLUMNS.
+    data_types type{};
+    data_type_groups group{};
+    value_storage storage{};                ///< How values of the type are kept in memory.
+    comparison_set comparisons{};           ///< The operators filters on the type may use.
+    literal_formatter format_literal{};     ///< Writes a value of the type as a SQL literal.
+
+    /**
+     * @brief Returns whether filters on the type may use an operator.
+     */
+    constexpr bool allows(comparison_operators op) const { return comparisons & (1u << static_cast<unsigned>(op)); }
+
+    /**
+     * @brief Returns whether values of the type are numbers.
+     */
+    constexpr bool numeric() const { return group == data_type_groups::exact_numeric || group == data_type_groups::approximate_numeric; }
+};
+
+/* Function Declarations
+************************************************************************/
+
+/**
+ * @brief Returns the registry entry of a SQL Server type name.
+ *
+ * @param type : The type name, as reported by INFORMATION_SCHEMA.COLUMNS.
+ * @return The entry; that of data_types::unknown for a name that is not registered.
+ */
+const data_type_info& lookup_type(std::wstring_view type);
+
+/**
+ * @brief Returns how an operator is written in SQL, e.g. '<=' for less_equals.
+ */
+std::wstring_view comparison_sql(comparison_operators op);
+
+/**
+ * @brief Maps a SQL Server type name to its data type.
+ *
+ * @param type : The type name, as reported by INFORMATION_SCHEMA.COLUMNS.
+ */
+data_types type_from_string(const std::wstring_view& type);
+
+/**
+ * @brief Maps a SQL Server type name to the group of types it belongs to.
+ *
+ * @param type : The type name, as reported by INFORMATION_SCHEMA.COLUMNS.
+ */
+data_type_groups type_group_from_string(const std::wstring_view& type);
+
+#endif // !_DATA_TYPES_H
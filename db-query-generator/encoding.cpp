@@ -0,0 +1,130 @@
+#include "encoding.h"
+
+static constexpr char32_t replacement_char{ 0xFFFD };
+
+void append_code_point(std::string& out, char32_t cp) {
+    if (cp < 0x80) {
+        out.push_back(static_cast<char>(cp));
+    }
+    else if (cp < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+    else if (cp < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+    else {
+        out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+// Appends a single code point to a wide string
+static void append_code_point(std::wstring& out, char32_t cp) {
+    if constexpr (sizeof(wchar_t) == 2) {
+        if (cp >= 0x10000) {
+            cp -= 0x10000;
+            out.push_back(static_cast<wchar_t>(0xD800 + (cp >> 10)));
+            out.push_back(static_cast<wchar_t>(0xDC00 + (cp & 0x3FF)));
+            return;
+        }
+    }
+
+    out.push_back(static_cast<wchar_t>(cp));
+}
+
+void append_utf8(std::string& out, std::wstring_view text) {
+    for (size_t i{}; i < text.size(); i++) {
+        char32_t cp{ static_cast<char32_t>(text[i]) };
+
+        // Fast path for plain ASCII
+        if (cp < 0x80) {
+            out.push_back(static_cast<char>(cp));
+            continue;
+        }
+
+        if constexpr (sizeof(wchar_t) == 2) {
+            cp &= 0xFFFF;
+
+            if (cp >= 0xD800 && cp <= 0xDBFF) {
+                char32_t low{ i + 1 < text.size() ? static_cast<char32_t>(text[i + 1]) & 0xFFFF : 0 };
+
+                if (low >= 0xDC00 && low <= 0xDFFF) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    i++;
+                }
+                else {
+                    cp = replacement_char;
+                }
+            }
+            else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                cp = replacement_char;
+            }
+        }
+        else if (cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+            cp = replacement_char;
+        }
+
+        append_code_point(out, cp);
+    }
+}
+
+std::string wide_to_utf8(std::wstring_view text) {
+    std::string out{};
+    out.reserve(text.size());
+    append_utf8(out, text);
+    return out;
+}
+
+void append_wide(std::wstring& out, std::string_view text) {
+    for (size_t i{}; i < text.size();) {
+        unsigned char lead{ static_cast<unsigned char>(text[i]) };
+
+        if (lead < 0x80) {
+            out.push_back(static_cast<wchar_t>(lead));
+            i++;
+            continue;
+        }
+
+        size_t length{ lead >= 0xF0 ? 4u : lead >= 0xE0 ? 3u : lead >= 0xC0 ? 2u : 0u };
+        char32_t cp{ length == 4 ? lead & 0x07u : length == 3 ? lead & 0x0Fu : lead & 0x1Fu };
+
+        if (length == 0 || i + length > text.size()) {
+            append_code_point(out, replacement_char);
+            i++;
+            continue;
+        }
+
+        bool valid{ true };
+        for (size_t j{ 1 }; j < length; j++) {
+            unsigned char next{ static_cast<unsigned char>(text[i + j]) };
+
+            if ((next & 0xC0) != 0x80) {
+                valid = false;
+                break;
+            }
+
+            cp = (cp << 6) | (next & 0x3F);
+        }
+
+        if (!valid || cp > 0x10FFFF) {
+            append_code_point(out, replacement_char);
+            i++;
+            continue;
+        }
+
+        append_code_point(out, cp);
+        i += length;
+    }
+}
+
+std::wstring utf8_to_wide(std::string_view text) {
+    std::wstring out{};
+    out.reserve(text.size());
+    append_wide(out, text);
+    return out;
+}
@@ -0,0 +1,85 @@
+#ifndef _ENCODING_H
+#define _ENCODING_H
+
+#include <charconv>
+#include <string>
+#include <string_view>
+
+/**
+ * @brief Appends the UTF-8 encoding of a single code point to a byte string.
+ *
+ * @param out : The string to append to.
+ * @param cp : The code point; a Unicode scalar value, so at most 0x10FFFF and not a surrogate.
+ */
+void append_code_point(std::string& out, char32_t cp);
+
+/**
+ * @brief Appends the UTF-8 encoding of a wide string to a byte string.
+ *
+ * Wide strings are treated as UTF-16 when wchar_t is 16 bits wide and as
+ * UTF-32 otherwise; unpaired surrogates are replaced with U+FFFD.
+ *
+ * @param out : The string to append to.
+ * @param text : The text to encode.
+ */
+void append_utf8(std::string& out, std::wstring_view text);
+
+/**
+ * @brief Encodes a wide string as UTF-8.
+ *
+ * @param text : The text to encode.
+ * @return The UTF-8 encoded text.
+ */
+std::string wide_to_utf8(std::wstring_view text);
+
+/**
+ * @brief Appends UTF-8 text, decoded, to a wide string.
+ *
+ * Malformed sequences are replaced with U+FFFD.
+ *
+ * @param out : The string to append to.
+ * @param text : The UTF-8 text to decode.
+ */
+void append_wide(std::wstring& out, std::string_view text);
+
+/**
+ * @brief Decodes UTF-8 text into a wide string.
+ *
+ * Malformed sequences are replaced with U+FFFD.
+ *
+ * @param text : The UTF-8 text to decode.
+ * @return The decoded text.
+ */
+std::wstring utf8_to_wide(std::string_view text);
+
+/**
+ * @brief Parses a whole wide string as a number, by narrowing it to ASCII for std::from_chars.
+ *
+ * The text has to be the number and nothing else, so spaces, a leading '+' and
+ * anything outside ASCII make it fail, as does a value out of the range of T.
+ *
+ * @param text : The text to parse.
+ * @param number : Set to the number; left unspecified when parsing fails.
+ * @return Whether the text is a number of type T.
+ */
+template <typename T>
+bool parse_number(std::wstring_view text, T& number) {
+    char digits[64];
+
+    if (text.empty() || text.size() > sizeof(digits)) {
+        return false;
+    }
+
+    for (size_t i{}; i < text.size(); i++) {
+        if (text[i] > 0x7F) {
+            return false;
+        }
+
+        digits[i] = static_cast<char>(text[i]);
+    }
+
+    auto [end, error] { std::from_chars(digits, digits + text.size(), number) };
+    return error == std::errc{} && end == digits + text.size();
+}
+
+#endif // !_ENCODING_H
@@ -0,0 +1,35 @@
+#include "exporter.h"
+#include "columnar_output.h"
+#include "xml_output.h"
+
+#include <stdexcept>
+#include <string>
+
+export_format export_format_from_string(std::string_view name) {
+    if (name == "xml") {
+        return export_format::xml;
+    }
+    else if (name == "columnar") {
+        return export_format::columnar;
+    }
+    else {
+        throw std::invalid_argument{ "Unknown export format: " + std::string{ name } };
+    }
+}
+
+std::filesystem::path export_path(export_format format, const std::filesystem::path& stem) {
+    std::filesystem::path file_path{ stem };
+    file_path += format == export_format::columnar ? ".dbqs" : ".xml";
+    return file_path;
+}
+
+std::unique_ptr<snapshot_exporter> make_exporter(export_format format, const std::filesystem::path& stem) {
+    switch (format) {
+    case export_format::xml:
+        return std::make_unique<xml_database_writer>(export_path(format, stem));
+    case export_format::columnar:
+        return std::make_unique<columnar_writer>(export_path(format, stem));
+    }
+
+    throw std::invalid_argument{ "Unknown export format" };
+}
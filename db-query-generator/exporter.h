@@ -0,0 +1,57 @@
+#ifndef _EXPORTER_H
+#define _EXPORTER_H
+
+#include <filesystem>
+#include <memory>
+#include <string_view>
+
+#include "pipeline.h"
+
+/* Type Definitions
+************************************************************************/
+
+// Formats a database snapshot can be exported to
+enum struct export_format {
+    xml,        ///< The '<database>' XML document.
+    columnar    ///< The memory-mappable binary column store, see columnar_writer.
+};
+
+// Base class for the writers that turn the extracted rows into a snapshot file
+class snapshot_exporter : public row_sink {
+public:
+
+    /**
+     * @brief Returns the file the snapshot is written to.
+     */
+    virtual const std::filesystem::path& path() const = 0;
+};
+
+/* Function Declarations
+************************************************************************/
+
+/**
+ * @brief Parses a format name, 'xml' or 'columnar'.
+ *
+ * @param name : The name of the format.
+ * @return The format; throws std::invalid_argument for an unknown name.
+ */
+export_format export_format_from_string(std::string_view name);
+
+/**
+ * @brief Returns the file a format is written to.
+ *
+ * @param format : The format.
+ * @param stem : The output file without its extension.
+ */
+std::filesystem::path export_path(export_format format, const std::filesystem::path& stem);
+
+/**
+ * @brief Creates the exporter of a format.
+ *
+ * @param format : The format to write.
+ * @param stem : The output file without its extension; the format adds its own.
+ * @return The exporter, ready to be added to a row_pipeline.
+ */
+std::unique_ptr<snapshot_exporter> make_exporter(export_format format, const std::filesystem::path& stem);
+
+#endif // !_EXPORTER_H
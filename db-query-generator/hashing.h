@@ -0,0 +1,38 @@
+#ifndef _HASHING_H
+#define _HASHING_H
+
+#include <cstdint>
+#include <string_view>
+
+/* Function Definitions
+************************************************************************/
+
+/**
+ * @brief Scrambles a 64-bit value so nearby inputs give unrelated outputs (the splitmix64 finalizer).
+ */
+inline uint64_t mix_bits(uint64_t value) {
+    value ^= value >> 30;
+    value *= 0xBF58476D1CE4E5B9ull;
+    value ^= value >> 27;
+    value *= 0x94D049BB133111EBull;
+    value ^= value >> 31;
+    return value;
+}
+
+/**
+ * @brief Hashes the characters of a text with 64-bit FNV-1a.
+ *
+ * FNV-1a alone spreads poorly over the high bits; pass the result through
+ * mix_bits() where the bits are used directly.
+ */
+inline uint64_t hash_text(std::wstring_view text) {
+    uint64_t hash{ 14695981039346656037ull };
+
+    for (wchar_t ch : text) {
+        hash = (hash ^ static_cast<uint32_t>(ch)) * 1099511628211ull;
+    }
+
+    return hash;
+}
+
+#endif // !_HASHING_H
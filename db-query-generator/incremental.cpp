@@ -0,0 +1,270 @@
+#include "incremental.h"
+#include "encoding.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <unordered_set>
+
+static std::wstring qualified_name(const table_info& table) {
+    return table.schema + L'.' + table.name;
+}
+
+// Separates the fields of a composite key; cannot appear in the text of a key value
+static constexpr char key_separator{ '\x1f' };
+
+// --------------------
+// START OF WATERMARK STORE FUNCTIONS
+// --------------------
+
+void watermark_store::load(const std::filesystem::path& file_path) {
+    marks.clear();
+
+    std::ifstream file{ file_path, std::ios::binary };
+    if (!file.is_open()) {
+        return;
+    }
+
+    std::string line{};
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+
+        size_t first{ line.find('\t') };
+        size_t second{ first == std::string::npos ? std::string::npos : line.find('\t', first + 1) };
+
+        if (second == std::string::npos) {
+            throw std::runtime_error{ "Malformed watermark file: " + file_path.string() };
+        }
+
+        marks[utf8_to_wide(std::string_view{ line }.substr(0, first))] = entry{
+            utf8_to_wide(std::string_view{ line }.substr(first + 1, second - first - 1)),
+            utf8_to_wide(std::string_view{ line }.substr(second + 1)) };
+    }
+}
+
+void watermark_store::save(const std::filesystem::path& file_path) const {
+    std::filesystem::path temp_path{ file_path };
+    temp_path += ".tmp";
+
+    {
+        std::ofstream file{ temp_path, std::ios::binary | std::ios::trunc };
+        std::string line{};
+
+        for (const auto& [table, saved] : marks) {
+            line.clear();
+            append_utf8(line, table);
+            line.push_back('\t');
+            append_utf8(line, saved.column);
+            line.push_back('\t');
+            append_utf8(line, saved.mark);
+            line.push_back('\n');
+
+            file << line;
+        }
+
+        if (!file.flush()) {
+            throw std::runtime_error{ "Unable to write watermark file: " + temp_path.string() };
+        }
+    }
+
+    std::filesystem::rename(temp_path, file_path);
+}
+
+const std::wstring* watermark_store::find(const table_info& table, const std::wstring& column) const {
+    auto found{ marks.find(qualified_name(table)) };
+    return found == marks.end() || found->second.column != column ? nullptr : &found->second.mark;
+}
+
+void watermark_store::set(const table_info& table, const std::wstring& column, std::wstring mark) {
+    marks[qualified_name(table)] = entry{ column, std::move(mark) };
+}
+
+// --------------------
+// END OF WATERMARK STORE FUNCTIONS
+// --------------------
+// --------------------
+// START OF CHANGE TRACKER FUNCTIONS
+// --------------------
+
+change_tracker::change_tracker(std::shared_ptr<const snapshot> prior, watermark_store previous) :
+    prior(std::move(prior)), previous(std::move(previous)) {
+    if (!this->prior) {
+        return;
+    }
+
+    const auto& tables{ this->prior->tables() };
+    for (size_t i{}; i < tables.size(); i++) {
+        prior_index.emplace(utf8_to_wide(tables[i].schema) + L'.' + utf8_to_wide(tables[i].name), i);
+    }
+}
+
+std::optional<size_t> change_tracker::prior_table(const table_info& table) const {
+    auto found{ prior_index.find(qualified_name(table)) };
+    if (found == prior_index.end()) {
+        return std::nullopt;
+    }
+
+    // A changed layout means the old rows no longer fit
+    const snapshot_table& stored{ prior->tables()[found->second] };
+    if (stored.columns.size() != table.columns.size()) {
+        return std::nullopt;
+    }
+
+    for (size_t i{}; i < stored.columns.size(); i++) {
+        if (utf8_to_wide(stored.columns[i].name) != table.columns[i]->name) {
+            return std::nullopt;
+        }
+    }
+
+    return found->second;
+}
+
+void change_tracker::record(const table_info& table, const std::wstring& column, std::wstring mark) {
+    std::lock_guard lock{ mutex };
+    next.set(table, column, std::move(mark));
+}
+
+void change_tracker::add_delta(std::shared_ptr<table_info> delta) {
+    std::lock_guard lock{ mutex };
+    deltas.emplace_back(std::move(delta));
+}
+
+// --------------------
+// END OF CHANGE TRACKER FUNCTIONS
+// --------------------
+// --------------------
+// START OF INCREMENTAL SOURCE FUNCTIONS
+// --------------------
+
+size_t find_watermark_column(const table_info& table) {
+    size_t modified_date{ std::wstring::npos };
+
+    for (size_t i{}; i < table.columns.size(); i++) {
+        const column_info& column{ *table.columns[i] };
+
+        if (column.data_type == L"timestamp" || column.data_type == L"rowversion") {
+            return i;
+        }
+
+        if (column.name == L"ModifiedDate" && modified_date == std::wstring::npos) {
+            modified_date = i;
+        }
+    }
+
+    return modified_date;
+}
+
+void merge_delta(const snapshot& prior, size_t prior_table, const table_info& delta, const std::vector<size_t>& key_columns, const row_callback& on_row) {
+    std::unordered_set<std::string> changed_keys{};
+    changed_keys.reserve(delta.row_count());
+
+    std::string key{};
+    std::vector<number_buffer> digits(delta.columns.size());
+
+    for (size_t row{}; row < delta.row_count(); row++) {
+        key.clear();
+
+        for (size_t column : key_columns) {
+            append_utf8(key, delta.value(row, column, digits[column]));
+            key.push_back(key_separator);
+        }
+
+        changed_keys.insert(key);
+    }
+
+    std::vector<std::wstring> values(delta.columns.size());
+    std::vector<std::wstring_view> fields(delta.columns.size());
+
+    prior.for_each_row(prior_table, [&](const std::vector<std::string_view>& row) {
+        key.clear();
+
+        for (size_t column : key_columns) {
+            key.append(row[column]);
+            key.push_back(key_separator);
+        }
+
+        // The delta holds the current version of the row
+        if (changed_keys.count(key)) {
+            return;
+        }
+
+        for (size_t i{}; i < fields.size(); i++) {
+            values[i].clear();
+            append_wide(values[i], row[i]);
+            fields[i] = values[i];
+        }
+
+        on_row(fields);
+    });
+
+    for (size_t row{}; row < delta.row_count(); row++) {
+        for (size_t i{}; i < fields.size(); i++) {
+            fields[i] = delta.value(row, i, digits[i]);
+        }
+
+        on_row(fields);
+    }
+}
+
+incremental_source::incremental_source(std::unique_ptr<row_source> live, std::shared_ptr<change_tracker> tracker) :
+    live(std::move(live)), tracker(std::move(tracker)) {}
+
+// Only tables read in full keep their numbers; merged tables go through the text of fetch_rows()
+void incremental_source::fetch_fields(const table_info& table, const field_callback& on_row) {
+    if (find_watermark_column(table) == std::wstring::npos) {
+        live->fetch_fields(table, on_row);
+    }
+    else {
+        row_source::fetch_fields(table, on_row);
+    }
+}
+
+void incremental_source::fetch_rows(const table_info& table, const row_callback& on_row) {
+    size_t column{ find_watermark_column(table) };
+
+    if (column == std::wstring::npos) {
+        live->fetch_rows(table, on_row);
+        return;
+    }
+
+    const std::wstring& column_name{ table.columns[column]->name };
+
+    // Taken before reading, so rows changed while reading are read again next time rather than missed
+    std::wstring mark{ live->high_water_mark(table, column) };
+
+    std::vector<size_t> key_columns{};
+    for (size_t i{}; i < table.columns.size(); i++) {
+        if (table.columns[i]->primary_key) {
+            key_columns.emplace_back(i);
+        }
+    }
+
+    const std::wstring* previous{ tracker->previous_mark(table, column_name) };
+    std::optional<size_t> prior_table{ tracker->prior_table(table) };
+
+    if (previous && prior_table && !key_columns.empty() && !mark.empty()) {
+        auto delta{ std::make_shared<table_info>(table_info{ L"", L"" }) };
+        delta->copy_layout(table);
+
+        live->fetch_changed_rows(table, column, *previous, mark, [&](const std::vector<std::wstring_view>& fields) {
+            for (size_t i{}; i < fields.size(); i++) {
+                delta->add_field(i, field_value::text_or_null_field(fields[i]));
+            }
+
+            delta->finish_row();
+        });
+
+        merge_delta(*tracker->prior_snapshot(), *prior_table, *delta, key_columns, on_row);
+        tracker->add_delta(std::move(delta));
+    }
+    else {
+        live->fetch_rows(table, on_row);
+    }
+
+    tracker->record(table, column_name, std::move(mark));
+}
+
+// --------------------
+// END OF INCREMENTAL SOURCE FUNCTIONS
+// --------------------
@@ -0,0 +1,175 @@
+#ifndef _INCREMENTAL_H
+#define _INCREMENTAL_H
+
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+
+#include "row_source.h"
+
+/* Type Definitions
+************************************************************************/
+
+/**
+ * @class watermark_store
+ * @brief The high-water mark of every table, as left by the last successful run.
+ *
+ * Saved as UTF-8 text, one 'schema.table<TAB>column<TAB>mark' line per table.
+ */
+class watermark_store {
+    struct entry {
+        std::wstring column{}, mark{};
+    };
+
+    std::unordered_map<std::wstring, entry> marks{};
+
+public:
+
+    /**
+     * @brief Loads the marks saved by save(); a missing file leaves the store empty.
+     *
+     * @param file_path : The watermark file.
+     */
+    void load(const std::filesystem::path& file_path);
+
+    /**
+     * @brief Saves the marks, replacing the file only once it is completely written.
+     *
+     * @param file_path : The watermark file.
+     */
+    void save(const std::filesystem::path& file_path) const;
+
+    /**
+     * @brief Returns the mark of a table, or nullptr if it was tracked by another column or not at all.
+     *
+     * @param table : The table.
+     * @param column : The name of the watermark column.
+     */
+    const std::wstring* find(const table_info& table, const std::wstring& column) const;
+
+    /**
+     * @brief Sets the mark of a table.
+     */
+    void set(const table_info& table, const std::wstring& column, std::wstring mark);
+
+    size_t size() const { return marks.size(); }
+};
+
+/**
+ * @class change_tracker
+ * @brief The state the sources of an incremental run share.
+ *
+ * Holds the previous snapshot and watermarks, which are only read, and collects
+ * the new watermarks and the changed rows of every table as the sources find them.
+ */
+class change_tracker {
+    std::shared_ptr<const snapshot> prior{};
+    std::unordered_map<std::wstring, size_t> prior_index{};
+    watermark_store previous{};
+
+    std::mutex mutex{};
+    watermark_store next{};
+    std::vector<std::shared_ptr<table_info>> deltas{};
+
+public:
+
+    /**
+     * @param prior : The snapshot of the previous run, or nullptr if there is none.
+     * @param previous : The watermarks of the previous run.
+     */
+    change_tracker(std::shared_ptr<const snapshot> prior, watermark_store previous);
+
+    const snapshot* prior_snapshot() const { return prior.get(); }
+
+    /**
+     * @brief Returns the index of a table in the previous snapshot, if it has the same columns.
+     */
+    std::optional<size_t> prior_table(const table_info& table) const;
+
+    /**
+     * @brief Returns the mark the previous run left for a table, or nullptr.
+     */
+    const std::wstring* previous_mark(const table_info& table, const std::wstring& column) const { return previous.find(table, column); }
+
+    /**
+     * @brief Records the mark a table was read up to in this run.
+     */
+    void record(const table_info& table, const std::wstring& column, std::wstring mark);
+
+    /**
+     * @brief Keeps the rows that changed in a table since the previous run.
+     */
+    void add_delta(std::shared_ptr<table_info> delta);
+
+    /**
+     * @brief Returns the marks recorded so far; only call once the sources are done.
+     */
+    const watermark_store& marks() const { return next; }
+
+    /**
+     * @brief Returns the changed rows, one table per incrementally read table; only call once the sources are done.
+     */
+    const std::vector<std::shared_ptr<table_info>>& changed_tables() const { return deltas; }
+};
+
+/**
+ * @class incremental_source
+ * @brief Reads only the rows that changed since the previous run and merges them into the previous snapshot.
+ *
+ * A table is read incrementally when it has a watermark column and a primary key,
+ * the previous run left a mark for it, and the previous snapshot holds it with the
+ * same columns. Every other table is read in full. Deleted rows cannot be seen
+ * through a watermark, so they stay in the merged snapshot until the next full run.
+ */
+class incremental_source : public row_source {
+    std::unique_ptr<row_source> live{};
+    std::shared_ptr<change_tracker> tracker{};
+
+public:
+
+    /**
+     * @param live : The source to read changes from.
+     * @param tracker : The state shared with the other sources of the run.
+     */
+    incremental_source(std::unique_ptr<row_source> live, std::shared_ptr<change_tracker> tracker);
+
+    std::vector<std::shared_ptr<table_info>> load_catalog() override { return live->load_catalog(); }
+    std::vector<foreign_key> load_foreign_keys() override { return live->load_foreign_keys(); }
+    void estimate_rows(const std::vector<std::shared_ptr<table_info>>& tables) override { live->estimate_rows(tables); }
+    uint64_t schema_fingerprint() override { return live->schema_fingerprint(); }
+    void fetch_rows(const table_info& table, const row_callback& on_row) override;
+    void fetch_fields(const table_info& table, const field_callback& on_row) override;
+
+    // Sampling is not extraction, so it neither reads changes nor records marks
+    uint64_t sample_rows(const table_info& table, row_sampler& sample) override { return live->sample_rows(table, sample); }
+};
+
+/* Function Declarations
+************************************************************************/
+
+/**
+ * @brief Returns the column changes to a table can be tracked by.
+ *
+ * Prefers a rowversion column, which every write bumps, over a 'ModifiedDate'
+ * column, which only writers that maintain it update.
+ *
+ * @param table : The table.
+ * @return The index of the column, or std::wstring::npos if the table has none.
+ */
+size_t find_watermark_column(const table_info& table);
+
+/**
+ * @brief Streams a table of a previous snapshot with changed rows applied.
+ *
+ * Rows of the snapshot whose primary key appears in the delta are dropped, then
+ * every row of the delta is streamed, so updated rows move to the end of the table.
+ *
+ * @param prior : The previous snapshot.
+ * @param prior_table : The index of the table in the snapshot.
+ * @param delta : The changed rows, with the columns of the snapshot table.
+ * @param key_columns : The indices of the primary key columns.
+ * @param on_row : Called once per merged row; the field views are only valid during the call.
+ */
+void merge_delta(const snapshot& prior, size_t prior_table, const table_info& delta, const std::vector<size_t>& key_columns, const row_callback& on_row);
+
+#endif // !_INCREMENTAL_H
@@ -7,658 +7,518 @@
 
  /* Includes
  ************************************************************************/
-#include <xercesc/util/PlatformUtils.hpp>
-#include <xercesc/dom/DOM.hpp>
-#include <xercesc/dom/DOMDocument.hpp>
-#include <xercesc/dom/DOMDocumentType.hpp>
-#include <xercesc/dom/DOMElement.hpp>
-#include <xercesc/dom/DOMImplementation.hpp>
-#include <xercesc/dom/DOMImplementationLS.hpp>
-#include <xercesc/dom/DOMText.hpp>
-#include <xercesc/framework/LocalFileFormatTarget.hpp>
-#include <xercesc/util/XMLUni.hpp>
-
 #include <random>
 #include <algorithm>
-#include <numeric>
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <vector>
 #include <set>
+#include <filesystem>
+#include <thread>
+#include <iomanip>
 #include <SQLAPI.h>
 
-#include "sql_statement_factory.h"
-
-/* Data Structs
+#include "catalog.h"
+#include "data_types.h"
+#include "encoding.h"
+#include "exporter.h"
+#include "incremental.h"
+#include "replay.h"
+#include "sampler.h"
+#include "sharded_statement_factory.h"
+#include "statement_budget.h"
+#include "statement_generation.h"
+#include "statistics.h"
+#include "xml_output.h"
+
+/* Sinks
 ************************************************************************/
-enum struct data_types {
-    unknown,
-    ext_bit,
-    ext_tinyint,
-    ext_smallint,
-    ext_int,
-    ext_bigint,
-    ext_decimal,
-    ext_numeric,
-    ext_smallmoney,
-    ext_money,
-    aprx_float,
-    aprx_real,
-    dat_date,
-    dat_datetime,
-    dat_datetime2,
-    dat_datetimeoffset,
-    dat_smalldatetime,
-    dat_time,
-    str_char,
-    str_varchar,
-    str_text,
-    str_nchar,
-    str_nvarchar,
-    str_ntext,
-    uni_str_nchar,
-    uni_str_nvarchar,
-    uni_str_ntext
+
+// Reports the progress of the extraction
+class progress_sink : public row_sink {
+public:
+
+    void write_rows(const table_info& table, const table_info& chunk) override {}
+
+    void end_table(const table_info& table, size_t row_count) override {
+        std::wcout << L"[+] Table: " << table.schema + L'.' + table.name << L" completed.\n";
+        std::wcout << L"    Column Count: " << table.columns.size() << L'\n';
+        std::wcout << L"    Row Count: " << row_count << L"\n\n";
+    }
 };
-enum struct data_type_groups {
-    unknown,
-    exact_numeric,
-    approximate_numeric,
-    date_and_time,
-    character_string,
-    unicode_character_string
+
+/* Options
+************************************************************************/
+
+// The database extracted from and replayed against
+const std::wstring connection_string{ L"localhost,1433@AdventureWorks2022;TrustServerCertificate=yes" };
+
+struct options {
+    std::filesystem::path csv_directory{};  ///< Read from CSV files instead of the database when set.
+    std::filesystem::path snapshot_file{};  ///< Read from a previous export instead of the database when set.
+    size_t connections{ 4 };                ///< Number of tables extracted concurrently.
+    fetch_options fetching{};               ///< Rows fetched per round trip and decoded ahead on every connection.
+    size_t generation_threads{ std::max(1u, std::thread::hardware_concurrency()) };   ///< Number of threads statements are generated on.
+    std::vector<export_format> formats{};   ///< Snapshot formats to write; XML when none are given, unless reading a snapshot.
+    std::filesystem::path cache_file{ "catalog.cache" };    ///< Where the catalog is cached between runs.
+    bool offline{};                         ///< Generate statements from the catalog cache without connecting.
+    bool schema_only{};                     ///< Generate statements without extracting rows, reusing the cache while the schema is unchanged.
+    bool incremental{};                     ///< Read only the rows changed since the last run and merge them into its snapshot.
+    std::filesystem::path watermark_file{ "watermarks.txt" };   ///< Where incremental runs keep their high-water marks.
+    sampler_options sampling{ 100, std::random_device{}() };    ///< Rows column statistics are computed from; a random seed unless one is given.
+    value_sourcing values{ value_sourcing::streamed };          ///< Whether the rows statistics are computed from are sampled from the extracted rows or by the sources.
+    std::vector<double> selectivities{ 0.001, 0.01, 0.1, 0.5 }; ///< Fractions of the rows filter statements aim to select.
+    generation_budget budget{};             ///< Most statements generated per table, in all and of each kind.
+    std::filesystem::path replay_file{};    ///< Replay this statement set against the database instead of generating one when set.
+    replay_options replay{};                ///< Workers, arrival rate, warmup and duration of the replay.
+    std::chrono::microseconds simulated_latency{};              ///< Replay against an in-process stand-in with this mean latency instead of the database, when set.
 };
 
-/* Function Definitions
+/* Functions
 ************************************************************************/
-data_types type_from_string(const std::wstring_view& type) {
-    if (type == L"bit") {
-        return data_types::ext_bit;
-    }
-    else if (type == L"tinyint") {
-        return data_types::ext_tinyint;
-    }
-    else if (type == L"smallint") {
-        return data_types::ext_smallint;
-    }
-    else if (type == L"int") {
-        return data_types::ext_int;
-    }
-    else if (type == L"bigint") {
-        return data_types::ext_bigint;
-    }
-    else if (type == L"decimal") {
-        return data_types::ext_decimal;
-    }
-    else if (type == L"numeric") {
-        return data_types::ext_numeric;
-    }
-    else if (type == L"smallmoney") {
-        return data_types::ext_smallmoney;
-    }
-    else if (type == L"money") {
-        return data_types::ext_money;
-    }
-    else if (type == L"float") {
-        return data_types::aprx_float;
-    }
-    else if (type == L"real") {
-        return data_types::aprx_real;
-    }
-    else if (type == L"date") {
-        return data_types::dat_date;
-    }
-    else if (type == L"datetime") {
-        return data_types::dat_datetime;
-    }
-    else if (type == L"datetime2") {
-        return data_types::dat_datetime2;
-    }
-    else if (type == L"datetimeoffset") {
-        return data_types::dat_datetimeoffset;
-    }
-    else if (type == L"smalldatetime") {
-        return data_types::dat_smalldatetime;
-    }
-    else if (type == L"time") {
-        return data_types::dat_time;
-    }
-    else if (type == L"char") {
-        return data_types::str_char;
-    }
-    else if (type == L"varchar") {
-        return data_types::str_varchar;
-    }
-    else if (type == L"text") {
-        return data_types::str_text;
-    }
-    else if (type == L"nchar") {
-        return data_types::str_nchar;
-    }
-    else if (type == L"nvarchar") {
-        return data_types::str_nvarchar;
-    }
-    else if (type == L"ntext") {
-        return data_types::str_ntext;
-    }
-    else if (type == L"nchar") {
-        return data_types::uni_str_nchar;
-    }
-    else if (type == L"nvarchar") {
-        return data_types::uni_str_nvarchar;
-    }
-    else if (type == L"ntext") {
-        return data_types::uni_str_ntext;
+
+// Parses '--offline', '--schema-only', '--incremental', '--csv <directory>', '--snapshot <file>',
+// '--cache <file>', '--watermarks <file>', '--connections <count>', '--prefetch-rows <count>',
+// '--prefetch-block <rows>', '--generation-threads <count>',
+// '--sample-rows <count>', '--sample-seed <seed>', '--stratify <column>', '--strata <count>',
+// '--values <streamed|pushed-down>', '--table-budget <count>', '--kind-budget <count>', '--max-terms <count>', '--max-join-tables <count>', '--replay <statements file>', '--replay-workers <count>', '--replay-rate <per second>',
+// '--replay-warmup <seconds>', '--replay-duration <seconds>', '--replay-simulated <mean microseconds>',
+// '--selectivity <fraction>' and '--format <xml|columnar>', the last two of which may repeat
+options parse_options(int argc, char* argv[]) {
+    options opts{};
+    bool selectivities_given{};
+
+    for (int i{ 1 }; i < argc; i++) {
+        std::string_view arg{ argv[i] };
+
+        if (arg == "--offline") {
+            opts.offline = true;
+        }
+        else if (arg == "--schema-only") {
+            opts.schema_only = true;
+        }
+        else if (arg == "--incremental") {
+            opts.incremental = true;
+        }
+        // Every other option takes a value
+        else if (i + 1 == argc) {
+            break;
+        }
+        else if (arg == "--csv") {
+            opts.csv_directory = argv[++i];
+        }
+        else if (arg == "--snapshot") {
+            opts.snapshot_file = argv[++i];
+        }
+        else if (arg == "--cache") {
+            opts.cache_file = argv[++i];
+        }
+        else if (arg == "--watermarks") {
+            opts.watermark_file = argv[++i];
+        }
+        else if (arg == "--connections") {
+            opts.connections = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--prefetch-rows") {
+            opts.fetching.prefetch_rows = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--prefetch-block") {
+            opts.fetching.block_rows = std::max(0, std::atoi(argv[++i]));
+        }
+        else if (arg == "--generation-threads") {
+            opts.generation_threads = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--sample-rows") {
+            opts.sampling.rows = std::max(0, std::atoi(argv[++i]));
+        }
+        else if (arg == "--sample-seed") {
+            opts.sampling.seed = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--stratify") {
+            opts.sampling.stratify_column = utf8_to_wide(argv[++i]);
+        }
+        else if (arg == "--strata") {
+            opts.sampling.strata = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--values") {
+            opts.values = value_sourcing_from_string(argv[++i]);
+        }
+        else if (arg == "--table-budget") {
+            opts.budget.per_table = std::max(0, std::atoi(argv[++i]));
+        }
+        else if (arg == "--kind-budget") {
+            opts.budget.per_kind = std::max(0, std::atoi(argv[++i]));
+        }
+        else if (arg == "--max-terms") {
+            opts.budget.max_terms = std::max(2, std::atoi(argv[++i]));
+        }
+        else if (arg == "--max-join-tables") {
+            opts.budget.max_join_tables = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--replay") {
+            opts.replay_file = argv[++i];
+        }
+        else if (arg == "--replay-workers") {
+            opts.replay.workers = std::max(1, std::atoi(argv[++i]));
+        }
+        // A rate makes the replay an open loop
+        else if (arg == "--replay-rate") {
+            opts.replay.arrival = arrival_model::open;
+            opts.replay.rate = std::max(0.001, std::atof(argv[++i]));
+        }
+        else if (arg == "--replay-warmup") {
+            opts.replay.warmup = std::chrono::milliseconds{ static_cast<int64_t>(std::max(0.0, std::atof(argv[++i])) * 1000) };
+        }
+        else if (arg == "--replay-duration") {
+            opts.replay.duration = std::chrono::milliseconds{ static_cast<int64_t>(std::max(0.0, std::atof(argv[++i])) * 1000) };
+        }
+        else if (arg == "--replay-simulated") {
+            opts.simulated_latency = std::chrono::microseconds{ std::max(1, std::atoi(argv[++i])) };
+        }
+        else if (arg == "--selectivity") {
+            // The first one given replaces the defaults
+            if (!selectivities_given) {
+                opts.selectivities.clear();
+                selectivities_given = true;
+            }
+
+            opts.selectivities.emplace_back(std::clamp(std::atof(argv[++i]), 0.0, 1.0));
+        }
+        else if (arg == "--format") {
+            opts.formats.emplace_back(export_format_from_string(argv[++i]));
+        }
     }
-    else {
-        return data_types::unknown;
+
+    // Statements can be regenerated from a snapshot or the cache without exporting anything
+    if (opts.formats.empty() && opts.snapshot_file.empty() && !opts.offline && !opts.schema_only) {
+        opts.formats.emplace_back(export_format::xml);
     }
+
+    return opts;
 }
-data_type_groups type_group_from_string(const std::wstring_view& type) {
-    if (type == L"bit") {
-        return data_type_groups::exact_numeric;
-    }
-    else if (type == L"tinyint") {
-        return data_type_groups::exact_numeric;
-    }
-    else if (type == L"smallint") {
-        return data_type_groups::exact_numeric;
-    }
-    else if (type == L"int") {
-        return data_type_groups::exact_numeric;
-    }
-    else if (type == L"bigint") {
-        return data_type_groups::exact_numeric;
-    }
-    else if (type == L"decimal") {
-        return data_type_groups::exact_numeric;
-    }
-    else if (type == L"numeric") {
-        return data_type_groups::exact_numeric;
-    }
-    else if (type == L"smallmoney") {
-        return data_type_groups::exact_numeric;
-    }
-    else if (type == L"money") {
-        return data_type_groups::exact_numeric;
-    }
-    else if (type == L"float") {
-        return data_type_groups::approximate_numeric;
-    }
-    else if (type == L"real") {
-        return data_type_groups::approximate_numeric;
-    }
-    else if (type == L"date") {
-        return data_type_groups::date_and_time;
-    }
-    else if (type == L"datetime") {
-        return data_type_groups::date_and_time;
-    }
-    else if (type == L"datetime2") {
-        return data_type_groups::date_and_time;
-    }
-    else if (type == L"datetimeoffset") {
-        return data_type_groups::date_and_time;
-    }
-    else if (type == L"smalldatetime") {
-        return data_type_groups::date_and_time;
-    }
-    else if (type == L"time") {
-        return data_type_groups::date_and_time;
-    }
-    else if (type == L"char") {
-        return data_type_groups::character_string;
-    }
-    else if (type == L"varchar") {
-        return data_type_groups::character_string;
-    }
-    else if (type == L"text") {
-        return data_type_groups::character_string;
-    }
-    else if (type == L"nchar") {
-        return data_type_groups::character_string;
-    }
-    else if (type == L"nvarchar") {
-        return data_type_groups::character_string;
-    }
-    else if (type == L"ntext") {
-        return data_type_groups::character_string;
-    }
-    else if (type == L"nchar") {
-        return data_type_groups::unicode_character_string;
-    }
-    else if (type == L"nvarchar") {
-        return data_type_groups::unicode_character_string;
+
+// Opens one connection to the source selected by the options
+std::unique_ptr<row_source> open_source(const options& opts, const std::shared_ptr<const snapshot>& saved, const std::shared_ptr<change_tracker>& tracker) {
+    std::unique_ptr<row_source> source{};
+
+    if (saved) {
+        source = std::make_unique<snapshot_source>(saved);
     }
-    else if (type == L"ntext") {
-        return data_type_groups::unicode_character_string;
+    else if (!opts.csv_directory.empty()) {
+        source = std::make_unique<csv_source>(opts.csv_directory);
     }
     else {
-        return data_type_groups::unknown;
+        source = std::make_unique<sqlapi_source>(connection_string, opts.fetching);
     }
-}
 
-/* Functions
-************************************************************************/
+    // Incremental runs read changes through the source and merge them into the previous snapshot
+    if (tracker) {
+        return std::make_unique<incremental_source>(std::move(source), tracker);
+    }
 
-// Custom deleter for XMLCh*
-struct XMLChDeleter {
-    void operator()(XMLCh* p) const noexcept { xercesc::XMLString::release(&p); }
-};
+    return source;
+}
 
-using XMLChPtr = std::unique_ptr<XMLCh, XMLChDeleter>;
+// Writes the rows an incremental run found changed to '<stem>.delta', in every export format
+void write_delta(const options& opts, const change_tracker& tracker, const std::filesystem::path& stem) {
+    auto changed{ std::make_shared<const std::vector<std::shared_ptr<table_info>>>(tracker.changed_tables()) };
 
-// Function to transcode std::string to XMLCh*
-XMLChPtr transcode(const std::string& str) {
-    return XMLChPtr{ xercesc::XMLString::transcode(str.c_str()) };
-}
+    size_t row_count{};
+    for (const auto& table : *changed) {
+        row_count += table->row_count();
+    }
 
-/* Main Function
-************************************************************************/
-int main() {
-    SAConnection conn{};
-    std::vector<std::shared_ptr<table_info>> tables{};
-    // unique schema names
-    std::set<std::wstring> schema_names{};
+    memory_source deltas{ changed };
+    std::vector<std::unique_ptr<snapshot_exporter>> exporters{};
+    std::filesystem::path delta_stem{ stem };
+    delta_stem += ".delta";
 
-    try {
-        conn.Connect(L"localhost,1433@AdventureWorks2022;TrustServerCertificate=yes", L"", L"", SA_SQLServer_Client);
-        std::wcout << L"[+] Connected to database.\n[-] Parsing database...\n\n";
+    row_pipeline pipeline{};
+    for (auto format : opts.formats) {
+        exporters.emplace_back(make_exporter(format, delta_stem));
+        pipeline.add_sink(*exporters.back());
+    }
 
-        SACommand cmd{ &conn,
-            L"SELECT TABLE_NAME, TABLE_SCHEMA "
-            L"FROM INFORMATION_SCHEMA.TABLES "
-            L"WHERE TABLE_TYPE = 'BASE TABLE' AND TABLE_CATALOG='AdventureWorks2022';" };
+    pipeline.run(deltas, deltas.load_catalog());
 
-        cmd.Execute();
-        while (cmd.FetchNext()) {
-            std::wstring table_name{ cmd.Field(L"TABLE_NAME").asString().GetWideChars() };
-            std::wstring table_schema{ cmd.Field(L"TABLE_SCHEMA").asString().GetWideChars() };
-            schema_names.insert(table_schema);
+    std::wcout << L"    Delta: " << row_count << L" changed rows in " << changed->size() << L" tables\n";
+}
 
-            tables.emplace_back(std::make_shared<table_info>(table_info{ table_name, table_schema }));
+// Loads the catalog from the source and refreshes the cache; with '--schema-only' the
+// cache is used as is while its fingerprint still matches the schema of the source
+void load_catalog(catalog& db, row_source& source, const options& opts) {
+    uint64_t fingerprint{ source.schema_fingerprint() };
+
+    if (opts.schema_only && std::filesystem::exists(opts.cache_file)) {
+        try {
+            if (db.load(opts.cache_file) == fingerprint) {
+                return;
+            }
+        }
+        catch (const std::runtime_error&) {
+            // Unreadable caches are rebuilt below
         }
+    }
 
-        std::wcout << L"[+] Found " << tables.size() << L" tables.\n[-] Parsing tables...\n\n";
+    db.load(source);
+    source.estimate_rows(db.tables());
+    db.save(opts.cache_file, fingerprint);
+}
 
-        for (const auto& table : tables) {
-            SACommand cmd2{ &conn,
-                L"SELECT COLUMN_NAME, DATA_TYPE "
-                L"FROM INFORMATION_SCHEMA.COLUMNS "
-                L"WHERE TABLE_NAME = :table AND TABLE_CATALOG='AdventureWorks2022';" };
+// Replays the statement set of '--replay' and prints the latencies of every kind of statement
+int replay(const options& opts) {
+    try {
+        statement_reader reader{ opts.replay_file };
+        std::wcout << L"[+] Opened the statement set " << opts.replay_file.wstring() << L".\n";
 
-            cmd2.Param(L"table").setAsString() = table->name.c_str();
-            cmd2.Execute();
+        // The set is read from the file as it is replayed, starting over at its end
+        statement_supplier next_statement{ [&](recorded_statement& statement) {
+            if (reader.next(statement)) {
+                return true;
+            }
 
-            while (cmd2.FetchNext()) {
-                std::wstring column_name{ cmd2.Field(L"COLUMN_NAME").asString().GetWideChars() };
-                std::wstring data_type{ cmd2.Field(L"DATA_TYPE").asString().GetWideChars() };
+            reader.rewind();
+            return reader.next(statement);
+        } };
 
-                table->columns.emplace_back(std::make_shared<column_info>(column_info{ column_name, data_type }));
+        std::wcout << L"[-] Replaying on " << opts.replay.workers << L" workers ";
+        if (opts.replay.arrival == arrival_model::open) {
+            std::wcout << L"at " << opts.replay.rate << L" statements/s";
+        }
+        else {
+            std::wcout << L"in a closed loop";
+        }
+        std::wcout << L" for " << opts.replay.duration.count() / 1000.0 << L" s after a " << opts.replay.warmup.count() / 1000.0 << L" s warmup...\n";
+
+        // Every simulated connection draws its own latencies
+        std::atomic<uint64_t> next_seed{ opts.sampling.seed };
+        runner_factory open{ [&]() -> std::unique_ptr<statement_runner> {
+            if (opts.simulated_latency.count()) {
+                return std::make_unique<simulated_runner>(opts.simulated_latency, next_seed++);
             }
 
-            SACommand cmd3{ &conn, std::wstring(L"SELECT * FROM " + table->schema + L"." + table->name).c_str() };
-            cmd3.Execute();
-            while (cmd3.FetchNext()) {
-                std::shared_ptr<row_info> row{ std::make_shared<row_info>(row_info{}) };
+            return std::make_unique<sqlapi_runner>(connection_string);
+        } };
 
-                for (const auto& column : table->columns) {
-                    std::wstring value{ cmd3.Field(column->name.c_str()).asString().GetWideChars() };
+        replay_report report{ replay_statements(next_statement, open, opts.replay) };
 
-                    row->fields.emplace_back(std::make_shared<field_info>(field_info{ value, row, column }));
-                }
+        std::wcout << L"[+] Replayed for " << std::chrono::duration<double>(report.elapsed).count() << L" s.\n\n";
+        std::wcout << std::left << std::setw(18) << L"    Kind" << std::right << std::setw(10) << L"Count" << std::setw(8) << L"Errors"
+            << std::setw(14) << L"Statements/s" << std::setw(11) << L"p50 ms" << std::setw(11) << L"p99 ms" << std::setw(11) << L"p99.9 ms" << std::setw(11) << L"Max ms" << L'\n';
 
-                table->rows.emplace_back(row);
-            }
+        auto milliseconds = [](std::chrono::nanoseconds latency) { return std::chrono::duration<double, std::milli>(latency).count(); };
 
-            std::wcout << L"[+] Table: " << table->schema + L'.' + table->name << L" completed.\n";
-            std::wcout << L"    Column Count: " << table->columns.size() << L'\n';
-            std::wcout << L"    Row Count: " << table->rows.size() << L"\n\n";
+        for (const auto& kind : report.kinds) {
+            std::wcout << std::left << std::setw(18) << L"    " + kind.name << std::right << std::setw(10) << kind.count << std::setw(8) << kind.errors
+                << std::fixed << std::setprecision(1) << std::setw(14) << kind.throughput << std::setprecision(3)
+                << std::setw(11) << milliseconds(kind.p50) << std::setw(11) << milliseconds(kind.p99)
+                << std::setw(11) << milliseconds(kind.p999) << std::setw(11) << milliseconds(kind.max) << std::defaultfloat << L'\n';
         }
 
-        std::wcout << L"[+] Finished parsing the database.\n";
-
-        conn.Disconnect();
-        std::wcout << L"[+] Disconnected from database\n" << std::endl;
-
-        // factory.generate_all_sql();
+        std::wcout << std::endl;
     }
     catch (SAException& err) {
         std::wcout << err.ErrText().GetMultiByteChars() << L"\n";
+        return 1;
+    }
+    catch (const std::exception& err) {
+        std::wcout << L"[!] " << err.what() << std::endl;
+        return 1;
     }
 
-    /* Generate SQL
-    ********************************************************************/
-    sql_statement_factory factory{};
-
-    std::wcout << L"[-] Generating SQL statments...\n";
-
-    for (const auto& table : tables) {
-        factory.create_select_all_statement(table->schema + L'.' + table->name);
-
-        std::vector<std::wstring> prev_columns{};
-
-        for (const auto& column : table->columns) {
-            factory.create_select_statement(table->schema + L'.' + table->name, { column->name });
-
-            if (column == *(table->columns.end() - 1)) {
-                break;
-            }
-
-            prev_columns.emplace_back(column->name);
-
-            if (prev_columns.size() > 1) {
-                factory.create_select_statement(table->schema + L'.' + table->name, prev_columns);
-            }
-        }
+    return 0;
+}
 
-        //    int limit{ 100 };
-        //    std::vector<int> indices(table->rows.size()); // Create an array of indices
-
-        //    // Initialize the indices
-        //    std::iota(indices.begin(), indices.end(), 0);
-
-        //    // Shuffle the indices
-        //    std::random_device rd{};
-        //    std::mt19937 g(rd());
-        //    std::shuffle(indices.begin(), indices.end(), g);
-
-        //    // Use the shuffled indices to iterate over the rows
-        //    for (int i = 0; i < limit && i < indices.size(); i++) {
-        //        const auto& row = table->rows[indices[i]];
-
-        //        for (const auto& field : row->fields) {
-        //            switch (type_group_from_string(field->column->data_type)) {
-        //            case data_type_groups::unknown:
-        //                break;
-        //            case data_type_groups::exact_numeric:
-        //                factory.create_filter_statement(table->schema + L'.' + table->name, field->column->name, L"=", field->value);
-        //                factory.create_filter_statement(table->schema + L'.' + table->name, field->column->name, L"!=", field->value);
-        //                factory.create_filter_statement(table->schema + L'.' + table->name, field->column->name, L">", field->value);
-        //                factory.create_filter_statement(table->schema + L'.' + table->name, field->column->name, L"<", field->value);
-        //                factory.create_filter_statement(table->schema + L'.' + table->name, field->column->name, L">=", field->value);
-        //                factory.create_filter_statement(table->schema + L'.' + table->name, field->column->name, L"<=", field->value);
-        //                break;
-        //            case data_type_groups::approximate_numeric:
-        //                factory.create_filter_statement(table->schema + L'.' + table->name, field->column->name, L"=", field->value);
-        //                factory.create_filter_statement(table->schema + L'.' + table->name, field->column->name, L"!=", field->value);
-        //                factory.create_filter_statement(table->schema + L'.' + table->name, field->column->name, L">", field->value);
-        //                factory.create_filter_statement(table->schema + L'.' + table->name, field->column->name, L"<", field->value);
-        //                factory.create_filter_statement(table->schema + L'.' + table->name, field->column->name, L">=", field->value);
-        //                factory.create_filter_statement(table->schema + L'.' + table->name, field->column->name, L"<=", field->value);
-        //                break;
-        //            case data_type_groups::date_and_time:
-        //                factory.create_filter_statement(table->schema + L'.' + table->name, field->column->name, L"=", field->value);
-        //                factory.create_filter_statement(table->schema + L'.' + table->name, field->column->name, L"!=", field->value);
-        //                factory.create_filter_statement(table->schema + L'.' + table->name, field->column->name, L">", field->value);
-        //                factory.create_filter_statement(table->schema + L'.' + table->name, field->column->name, L"<", field->value);
-        //                factory.create_filter_statement(table->schema + L'.' + table->name, field->column->name, L">=", field->value);
-        //                factory.create_filter_statement(table->schema + L'.' + table->name, field->column->name, L"<=", field->value);
-        //                break;
-        //            case data_type_groups::character_string:
-        //                factory.create_filter_statement(table->schema + L'.' + table->name, field->column->name, L"=", field->value);
-        //                factory.create_filter_statement(table->schema + L'.' + table->name, field->column->name, L"!=", field->value);
-        //                break;
-        //            case data_type_groups::unicode_character_string:
-        //                factory.create_filter_statement(table->schema + L'.' + table->name, field->column->name, L"=", field->value);
-        //                factory.create_filter_statement(table->schema + L'.' + table->name, field->column->name, L"!=", field->value);
-        //                break;
-        //            }
-        //        }
-        //    }
-    }
-    /***********************************************************************/
+/* Main Function
+************************************************************************/
+int main(int argc, char* argv[]) {
+    std::vector<std::shared_ptr<table_info>> tables{};
+    // unique schema names
+    std::set<std::wstring> schema_names{};
 
-    std::wcout << L"[+] Finished generating SQL statments.\n\n";
+    options opts{};
 
     try {
-        xercesc::XMLPlatformUtils::Initialize();
+        opts = parse_options(argc, argv);
     }
-    catch (const xercesc::XMLException& caught) {
-        std::u16string s16{ caught.getMessage() };
-        std::wstring message{ s16.begin(), s16.end() };
-        std::wcout << L"[!] XML toolkit initialization error: " << message << std::endl;
+    catch (const std::invalid_argument& err) {
+        std::wcout << L"[!] " << err.what() << std::endl;
         return 1;
     }
 
-    try {
-        std::wcout << L"[-] Writing SQL statments to file...\n";
-
-        // Define constants for the tag names and attributes
-        XMLChPtr ATTR_count{ transcode("count") };
-        XMLChPtr ATTR_name{ transcode("name") };
-
-        XMLChPtr TAG_root{ transcode("sql_info") };
-
-        XMLChPtr TAG_schemas{ transcode("schemas") };
-        XMLChPtr TAG_schema{ transcode("schema") };
+    // Replaying a statement set is a run of its own
+    if (!opts.replay_file.empty()) {
+        return replay(opts);
+    }
 
-        XMLChPtr TAG_tables{ transcode("tables") };
-        XMLChPtr TAG_table { transcode("table") };
+    sharded_statement_factory factory{ opts.generation_threads };
 
-        XMLChPtr TAG_column{ transcode("column") };
+    try {
+        catalog db{};
+        std::shared_ptr<const snapshot> saved{};
+        std::shared_ptr<change_tracker> tracker{};
+        std::unique_ptr<source_pool> sources{};
 
-        XMLChPtr TAG_statements{ transcode("statements") };
-        XMLChPtr TAG_statement{ transcode("statement") };
-        XMLChPtr TAG_query{ transcode("query") };
-        XMLChPtr TAG_label{ transcode("label") };
+        const std::filesystem::path stem{ "advnwks2022" };
+        std::vector<std::filesystem::path> merged_files{};
 
-        xercesc::DOMImplementation* impl{ xercesc::DOMImplementationRegistry::getDOMImplementation(transcode("LS").get()) };
+        if (opts.offline) {
+            db.load(opts.cache_file);
+            std::wcout << L"[+] Loaded the catalog cache " << opts.cache_file.wstring() << L".\n\n";
+        }
+        else {
+            // Mapped once and shared by every connection
+            if (!opts.snapshot_file.empty()) {
+                saved = std::make_shared<const snapshot>(opts.snapshot_file);
+            }
 
-        xercesc::DOMDocument* doc = impl->createDocument(
-            0,              // root element namespace URI.
-            TAG_root.get(), // root element name
-            0);             // document type object (DTD).
+            // Changes are merged into the export of the first format from the previous run
+            if (opts.incremental && !opts.schema_only && !opts.formats.empty()) {
+                std::filesystem::path prior_path{ export_path(opts.formats.front(), stem) };
+                std::shared_ptr<const snapshot> prior{};
 
-        xercesc::DOMElement* root_elem{ doc->getDocumentElement() };
+                if (std::filesystem::exists(prior_path)) {
+                    prior = std::make_shared<const snapshot>(prior_path);
+                }
 
-        xercesc::DOMElement* schema_group_elem{ doc->createElement(TAG_schemas.get()) };
-        root_elem->appendChild(schema_group_elem);
+                watermark_store marks{};
+                marks.load(opts.watermark_file);
+                std::wcout << L"[+] Loaded " << marks.size() << L" watermarks" << (prior ? L"." : L"; no previous snapshot, reading every table.") << L'\n';
 
-        XMLChPtr schema_count{ transcode(std::to_string(schema_names.size())) };
-        schema_group_elem->setAttribute(ATTR_count.get(), schema_count.get());
+                tracker = std::make_shared<change_tracker>(std::move(prior), std::move(marks));
+            }
 
-        for (const auto& schema : schema_names) {
-            xercesc::DOMElement* schema_elem{ doc->createElement(TAG_schema.get()) };
-            schema_group_elem->appendChild(schema_elem);
+            sources = std::make_unique<source_pool>(opts.schema_only && opts.values != value_sourcing::pushed_down ? 1 : opts.connections, [&]() { return open_source(opts, saved, tracker); });
+            std::wcout << L"[+] Connected to database (" << sources->size() << L" connections).\n[-] Parsing database...\n\n";
 
-            std::u16string temp_schema{ schema.begin(), schema.end() };
-            schema_elem->appendChild(doc->createTextNode(temp_schema.c_str()));
+            load_catalog(db, (*sources)[0], opts);
         }
 
-        xercesc::DOMElement* table_group_elem{ doc->createElement(TAG_tables.get()) };
-        root_elem->appendChild(table_group_elem);
-
-        XMLChPtr table_count{ transcode(std::to_string(tables.size())) };
-        table_group_elem->setAttribute(ATTR_count.get(), table_count.get());
+        tables = db.tables();
 
         for (const auto& table : tables) {
-            xercesc::DOMElement* table_elem{ doc->createElement(TAG_table.get()) };
-            table_group_elem->appendChild(table_elem);
-
-            std::u16string qualified_table{ table->schema.begin(), table->schema.end() };
-            std::u16string table_name{ table->name.begin(), table->name.end() };
-            qualified_table.append(u'.' + table_name);
-            table_elem->appendChild(doc->createTextNode(qualified_table.c_str()));
+            schema_names.insert(table->schema);
         }
 
-        const auto& queries{ factory.generate_all_sql() };
-        const auto& labels{ factory.generate_all_labels() };
-
-        assert(queries.size() == labels.size());
+        std::wcout << L"[+] Found " << tables.size() << L" tables in " << db.load_time().count() / 1000.0 << L" ms.\n";
 
-        xercesc::DOMElement* statement_group_elem{ doc->createElement(TAG_statements.get()) };
-        root_elem->appendChild(statement_group_elem);
+        // Streamed statistics need the rows of a full extraction; offline runs have no source to sample
+        bool streamed{ opts.values == value_sourcing::streamed && !opts.offline && !opts.schema_only };
+        bool pushed_down{ opts.values == value_sourcing::pushed_down && sources };
 
-        XMLChPtr statement_count{ transcode(std::to_string(queries.size())) };
-        statement_group_elem->setAttribute(ATTR_count.get(), statement_count.get());
-
-        size_t idx{};
-
-        for (const auto& query : queries) {
-            const auto& label{ labels[idx] };
-
-            xercesc::DOMElement* statement_elem{ doc->createElement(TAG_statement.get()) };
-            statement_group_elem->appendChild(statement_elem);
-
-            xercesc::DOMElement* query_elem{ doc->createElement(TAG_query.get()) };
-            statement_elem->appendChild(query_elem);
-
-            std::u16string temp_query{ query.begin(), query.end() };
-            query_elem->appendChild(doc->createTextNode(temp_query.c_str()));
-
-            xercesc::DOMElement* label_elem{ doc->createElement(TAG_label.get()) };
-            statement_elem->appendChild(label_elem);
-
-            std::u16string temp_label{ label.begin(), label.end() };
-            label_elem->appendChild(doc->createTextNode(temp_label.c_str()));
-
-            idx++;
+        if (streamed || pushed_down) {
+            std::wcout << L"[-] Sampling " << opts.sampling.rows << L" rows per table with seed " << opts.sampling.seed << L".\n";
         }
 
-        xercesc::DOMLSSerializer* the_serializer = ((xercesc::DOMImplementationLS*)impl)->createLSSerializer();
-
-        if (the_serializer->getDomConfig()->canSetParameter(xercesc::XMLUni::fgDOMWRTFormatPrettyPrint, true))
-            the_serializer->getDomConfig()->setParameter(xercesc::XMLUni::fgDOMWRTFormatPrettyPrint, true);
-
-        xercesc::XMLFormatTarget* my_form_target = new xercesc::LocalFileFormatTarget("statements.xml");
-        xercesc::DOMLSOutput* the_output = ((xercesc::DOMImplementationLS*)impl)->createLSOutput();
-        the_output->setByteStream(my_form_target);
-
-        the_serializer->write(doc, the_output);
+        if (!opts.offline && !opts.schema_only) {
+            std::wcout << L"[-] Parsing tables...\n\n";
 
-        the_output->release();
-        the_serializer->release();
-        delete my_form_target;
+            // Rows stream from the source straight into the writers
+            statement_sink statements{ factory, db, opts.budget, opts.sampling, opts.selectivities };
+            progress_sink progress{};
+            std::vector<std::unique_ptr<snapshot_exporter>> exporters{};
 
-        std::wcout << L"[+] Finished writing SQL statments to file.\n\n";
-    }
-    catch (const xercesc::DOMException& caught) {
-        std::u16string s16{ caught.getMessage() };
-        std::wstring message{ s16.begin(), s16.end() };
-        std::wcout << L"[!] DOMException: " << message << std::endl;
-        return 1;
-    }
-    catch (const xercesc::XMLException& caught) {
-        std::u16string s16{ caught.getMessage() };
-        std::wstring message{ s16.begin(), s16.end() };
-        std::wcout << L"[!] XMLException: " << message << std::endl;
-        return 1;
-    }
-
-    try {
-        std::wcout << L"[-] Converting database to XML...\n";
-
-        // Define constants for the tag names and attributes
-        XMLChPtr ATTR_name{ transcode("name") };
-        XMLChPtr ATTR_type{ transcode("type") };
-
-        XMLChPtr TAG_root{ transcode("database") };
-        XMLChPtr ATTR_table_count{ transcode("number_of_tables") };
-
-        XMLChPtr TAG_table{ transcode("table") };
-        XMLChPtr ATTR_column_count{ transcode("number_of_columns") };
-        XMLChPtr ATTR_row_count{ transcode("number_of_rows") };
-
-        XMLChPtr TAG_column{ transcode("column") };
-
-        XMLChPtr TAG_row{ transcode("row") };
-
-        XMLChPtr TAG_field{ transcode("field") };
-        XMLChPtr ATTR_value{ transcode("value") };
-        XMLChPtr ATTR_parent_column{ transcode("parent_column") };
+            row_pipeline pipeline{};
+            if (streamed) {
+                pipeline.add_sink(statements);
+            }
 
-        xercesc::DOMImplementation* impl{ xercesc::DOMImplementationRegistry::getDOMImplementation(transcode("LS").get()) };
+            // Incremental runs still read the previous snapshot, so the new one is written beside it
+            std::filesystem::path export_stem{ stem };
+            if (tracker) {
+                export_stem += ".next";
+            }
 
-        xercesc::DOMDocument* doc = impl->createDocument(
-            0,              // root element namespace URI.
-            TAG_root.get(), // root element name
-            0);             // document type object (DTD).
+            for (auto format : opts.formats) {
+                exporters.emplace_back(make_exporter(format, export_stem));
+                merged_files.emplace_back(exporters.back()->path());
 
-        xercesc::DOMElement* root_elem{ doc->getDocumentElement() };
+                // Truncating the snapshot would pull the mapping out from under the reader
+                std::error_code error{};
+                if (saved && std::filesystem::equivalent(exporters.back()->path(), opts.snapshot_file, error)) {
+                    throw std::invalid_argument{ "Cannot export over the snapshot being read: " + opts.snapshot_file.string() };
+                }
 
-        XMLChPtr table_count{ transcode(std::to_string(tables.size())) };
-        root_elem->setAttribute(ATTR_table_count.get(), table_count.get());
+                pipeline.add_sink(*exporters.back());
+            }
 
-        for (const auto& table : tables) {
+            pipeline.add_sink(progress);
+            pipeline.run(*sources, tables);
 
-            xercesc::DOMElement* table_elem{ doc->createElement(TAG_table.get()) };
-            root_elem->appendChild(table_elem);
+            std::wcout << L"[+] Finished parsing the database.\n";
 
-            std::u16string table_schema{ table->schema.begin(), table->schema.end() };
-            std::u16string table_name{ table->name.begin(), table->name.end() };
-            table_schema.append(u'.' + table_name);
-            table_elem->setAttribute(ATTR_name.get(), table_schema.c_str());
+            for (const auto& exporter : exporters) {
+                std::wcout << L"    Snapshot: " << exporter->path().wstring() << L'\n';
+            }
 
-            XMLChPtr column_count{ transcode(std::to_string(table->columns.size())) };
-            table_elem->setAttribute(ATTR_column_count.get(), column_count.get());
+            std::wcout << L"    Pipeline Memory: " << pipeline.memory_usage() / 1024 << L" KiB\n";
 
-            XMLChPtr row_count{ transcode(std::to_string(table->rows.size())) };
-            table_elem->setAttribute(ATTR_row_count.get(), row_count.get());
+            if (tracker) {
+                write_delta(opts, *tracker, stem);
+            }
+        }
 
-            for (const auto& column : table->columns) {
-                xercesc::DOMElement* column_elem{ doc->createElement(TAG_column.get()) };
-                table_elem->appendChild(column_elem);
+        if (pushed_down) {
+            table_samples sampled{ sample_tables(*sources, tables, opts.sampling) };
+            std::wcout << L"[+] Sampled the tables reading " << sampled.rows_read << L" rows.\n";
 
-                std::u16string column_name{ column->name.begin(), column->name.end() };
-                column_elem->setAttribute(ATTR_name.get(), column_name.c_str());
+            // Statistics of the samples stand in for those of the tables
+            std::vector<std::unique_ptr<table_statistics>> stats{};
 
-                std::u16string column_type{ column->data_type.begin(), column->data_type.end() };
-                column_elem->setAttribute(ATTR_type.get(), column_type.c_str());
+            for (size_t i{}; i < tables.size(); i++) {
+                stats.emplace_back(std::make_unique<table_statistics>(*tables[i], opts.sampling.seed));
+                sampled.samples[i]->for_each_row([&](const std::vector<field_value>& fields) { stats.back()->add(fields); });
+                stats.back()->finish();
             }
 
-            for (const auto& row : table->rows) {
-                xercesc::DOMElement* row_elem{ doc->createElement(TAG_row.get()) };
-                table_elem->appendChild(row_elem);
-
-                for (const auto& field : row->fields) {
-                    xercesc::DOMElement* field_elem{ doc->createElement(TAG_field.get()) };
-                    row_elem->appendChild(field_elem);
-
-                    std::u16string field_value{ field->value.begin(), field->value.end() };
-                    field_elem->setAttribute(ATTR_value.get(), field_value.c_str());
+            generate_statements(factory, db, opts.budget, opts.sampling.seed, stats, opts.selectivities);
+        }
+        else if (!streamed) {
+            generate_statements(factory, db, opts.budget, opts.sampling.seed);
+        }
 
-                    std::u16string parent_column{ field->column->name.begin(), field->column->name.end() };
-                    field_elem->setAttribute(ATTR_parent_column.get(), parent_column.c_str());
-                }
-            }
+        if (sources) {
+            sources.reset();
+            std::wcout << L"[+] Disconnected from database\n" << std::endl;
         }
 
-        std::wcout << L"[+] Finished converting database to XML.\n\n[-] Writing XML to file...\n";
+        // Only replace the previous snapshot and watermarks once nothing maps them anymore
+        if (tracker) {
+            watermark_store marks{ tracker->marks() };
+            tracker.reset();
 
-        xercesc::DOMLSSerializer* the_serializer = ((xercesc::DOMImplementationLS*)impl)->createLSSerializer();
+            for (size_t i{}; i < merged_files.size(); i++) {
+                std::filesystem::rename(merged_files[i], export_path(opts.formats[i], stem));
+            }
 
-        //if (the_serializer->getDomConfig()->canSetParameter(xercesc::XMLUni::fgDOMWRTFormatPrettyPrint, true))
-        //    the_serializer->getDomConfig()->setParameter(xercesc::XMLUni::fgDOMWRTFormatPrettyPrint, true);
+            marks.save(opts.watermark_file);
+            std::wcout << L"[+] Saved " << marks.size() << L" watermarks.\n" << std::endl;
+        }
+    }
+    catch (SAException& err) {
+        std::wcout << err.ErrText().GetMultiByteChars() << L"\n";
+    }
+    catch (const std::exception& err) {
+        std::wcout << L"[!] " << err.what() << std::endl;
+        return 1;
+    }
 
-        xercesc::XMLFormatTarget* my_form_target = new xercesc::LocalFileFormatTarget("advnwks2022.xml");
-        xercesc::DOMLSOutput* the_output = ((xercesc::DOMImplementationLS*)impl)->createLSOutput();
-        the_output->setByteStream(my_form_target);
+    std::wcout << L"[+] Generated " << factory.size() << L" SQL statments (" << factory.duplicates_removed() << L" duplicates dropped).\n\n";
 
-        the_serializer->write(doc, the_output);
+    try {
+        std::wcout << L"[-] Writing SQL statments to file...\n";
 
-        std::wcout << L"[+] Finished writing XML file.\n\n[-] Finishing up...\n";
+        size_t template_count{ write_statement_set("statements.xml", schema_names, tables, factory) };
+        std::wcout << L"    Templates: " << template_count << L'\n';
 
-        the_output->release();
-        the_serializer->release();
-        delete my_form_target;
-    }
-    catch (const xercesc::DOMException& caught) {
-        std::u16string s16{ caught.getMessage() };
-        std::wstring message{ s16.begin(), s16.end() };
-        std::wcout << L"[!] DOMException: " << message << std::endl;
-        return 1;
+        std::wcout << L"[+] Finished writing SQL statments to file.\n\n";
     }
-    catch (const xercesc::XMLException& caught) {
-        std::u16string s16{ caught.getMessage() };
-        std::wstring message{ s16.begin(), s16.end() };
-        std::wcout << L"[!] XMLException: " << message << std::endl;
+    catch (const std::exception& err) {
+        std::wcout << L"[!] " << err.what() << std::endl;
         return 1;
     }
 
-    xercesc::XMLPlatformUtils::Terminate();
-
     std::wcout << L"[+] Done. Have a great day!" << std::endl;
 
     return 0;
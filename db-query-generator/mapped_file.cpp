@@ -0,0 +1,136 @@
+#include "mapped_file.h"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+mapped_file::mapped_file(const std::filesystem::path& path) {
+    HANDLE file{ CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr) };
+
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error{ "Unable to open file: " + path.string() };
+    }
+
+    file_handle = file;
+
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file, &size)) {
+        unmap();
+        throw std::runtime_error{ "Unable to read the size of file: " + path.string() };
+    }
+
+    // Empty files cannot be mapped, and need not be
+    if (size.QuadPart == 0) {
+        return;
+    }
+
+    mapping_handle = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    data = mapping_handle ? static_cast<const char*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+
+    if (!data) {
+        unmap();
+        throw std::runtime_error{ "Unable to map file: " + path.string() };
+    }
+
+    length = static_cast<size_t>(size.QuadPart);
+}
+
+void mapped_file::unmap() {
+    if (data) {
+        UnmapViewOfFile(data);
+    }
+
+    if (mapping_handle) {
+        CloseHandle(mapping_handle);
+    }
+
+    if (file_handle) {
+        CloseHandle(file_handle);
+    }
+
+    data = nullptr;
+    length = 0;
+    mapping_handle = nullptr;
+    file_handle = nullptr;
+}
+
+#else
+
+mapped_file::mapped_file(const std::filesystem::path& path) {
+    int file{ ::open(path.c_str(), O_RDONLY) };
+
+    if (file < 0) {
+        throw std::runtime_error{ "Unable to open file: " + path.string() };
+    }
+
+    struct stat info {};
+    if (::fstat(file, &info) != 0) {
+        ::close(file);
+        throw std::runtime_error{ "Unable to read the size of file: " + path.string() };
+    }
+
+    // Empty files cannot be mapped, and need not be
+    if (info.st_size > 0) {
+        void* address{ ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0) };
+
+        if (address == MAP_FAILED) {
+            ::close(file);
+            throw std::runtime_error{ "Unable to map file: " + path.string() };
+        }
+
+        // Snapshots are read front to back
+        ::madvise(address, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+
+        data = static_cast<const char*>(address);
+        length = static_cast<size_t>(info.st_size);
+    }
+
+    // The mapping keeps the file alive on its own
+    ::close(file);
+}
+
+void mapped_file::unmap() {
+    if (data) {
+        ::munmap(const_cast<char*>(data), length);
+    }
+
+    data = nullptr;
+    length = 0;
+}
+
+#endif
+
+mapped_file::~mapped_file() {
+    unmap();
+}
+
+mapped_file::mapped_file(mapped_file&& other) noexcept {
+    *this = std::move(other);
+}
+
+mapped_file& mapped_file::operator=(mapped_file&& other) noexcept {
+    if (this != &other) {
+        unmap();
+
+        data = std::exchange(other.data, nullptr);
+        length = std::exchange(other.length, 0);
+#ifdef _WIN32
+        file_handle = std::exchange(other.file_handle, nullptr);
+        mapping_handle = std::exchange(other.mapping_handle, nullptr);
+#endif
+    }
+
+    return *this;
+}
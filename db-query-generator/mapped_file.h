@@ -0,0 +1,49 @@
+#ifndef _MAPPED_FILE_H
+#define _MAPPED_FILE_H
+
+#include <filesystem>
+#include <string_view>
+
+/**
+ * @class mapped_file
+ * @brief A read-only memory mapping of a whole file.
+ *
+ * The bytes stay valid for as long as the mapping is alive; the file must not be
+ * modified while it is mapped. Failures throw std::runtime_error.
+ */
+class mapped_file {
+    const char* data{};
+    size_t length{};
+#ifdef _WIN32
+    void* file_handle{};
+    void* mapping_handle{};
+#endif
+
+public:
+
+    mapped_file() = default;
+
+    /**
+     * @brief Maps a file.
+     *
+     * @param path : The file to map.
+     */
+    explicit mapped_file(const std::filesystem::path& path);
+    ~mapped_file();
+
+    mapped_file(mapped_file&& other) noexcept;
+    mapped_file& operator=(mapped_file&& other) noexcept;
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    /**
+     * @brief Returns the content of the file.
+     */
+    std::string_view bytes() const { return { data, length }; }
+
+private:
+    void unmap();
+};
+
+#endif // !_MAPPED_FILE_H
@@ -0,0 +1,27 @@
+#include "name_pool.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+name_id name_pool::intern(std::wstring_view name) {
+    auto found{ ids.find(name) };
+    if (found != ids.end()) {
+        return found->second;
+    }
+
+    if (names.size() > UINT32_MAX) {
+        throw std::length_error{ "Too many names to intern" };
+    }
+
+    std::pmr::polymorphic_allocator<wchar_t> allocator{ resource };
+    wchar_t* characters{ allocator.allocate(std::max<size_t>(name.size(), 1)) };
+    std::copy(name.begin(), name.end(), characters);
+
+    std::wstring_view stored{ characters, name.size() };
+    name_id id{ static_cast<name_id>(names.size()) };
+
+    names.emplace_back(stored);
+    ids.emplace(stored, id);
+
+    return id;
+}
@@ -0,0 +1,57 @@
+#ifndef _NAME_POOL_H
+#define _NAME_POOL_H
+
+#include <cstdint>
+#include <memory_resource>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/* Type Definitions
+************************************************************************/
+
+// Identifies a name interned in a name_pool
+using name_id = uint32_t;
+
+/**
+ * @class name_pool
+ * @brief Stores every distinct name once and hands out small IDs for them.
+ *
+ * The characters are copied into a memory resource the pool does not own, so
+ * the names stay valid, and their views stable, as long as that resource lives.
+ */
+class name_pool {
+    std::pmr::memory_resource* resource{};
+    std::vector<std::wstring_view> names{};
+    std::unordered_map<std::wstring_view, name_id> ids{};
+
+public:
+
+    /**
+     * @param resource : The memory resource the characters are copied into; must outlive the pool.
+     */
+    explicit name_pool(std::pmr::memory_resource& resource) :
+        resource(&resource) {}
+
+    name_pool(const name_pool&) = delete;
+    name_pool& operator=(const name_pool&) = delete;
+
+    /**
+     * @brief Returns the ID of a name, adding the name if it is new.
+     *
+     * @param name : The name.
+     */
+    name_id intern(std::wstring_view name);
+
+    /**
+     * @brief Returns the name of an ID handed out by intern().
+     */
+    std::wstring_view operator[](name_id id) const { return names[id]; }
+
+    /**
+     * @brief Returns the number of distinct names.
+     */
+    size_t size() const { return names.size(); }
+};
+
+#endif // !_NAME_POOL_H
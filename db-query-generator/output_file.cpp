@@ -0,0 +1,103 @@
+#include "output_file.h"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+
+// Opens a file the same way on every platform, without the MSVC deprecation warning
+static std::FILE* open_file(const std::filesystem::path& path, const char* mode) {
+#ifdef _WIN32
+    std::FILE* file{};
+    std::wstring wide_mode{ mode, mode + std::char_traits<char>::length(mode) };
+    return _wfopen_s(&file, path.c_str(), wide_mode.c_str()) == 0 ? file : nullptr;
+#else
+    return std::fopen(path.c_str(), mode);
+#endif
+}
+
+output_file::output_file(size_t flush_threshold) :
+    flush_threshold(flush_threshold) {
+    pending.reserve(flush_threshold + flush_threshold / 4);
+}
+
+output_file::~output_file() {
+    if (file) {
+        std::fclose(file);
+    }
+}
+
+void output_file::open(const std::filesystem::path& path) {
+    close();
+
+    file = open_file(path, "wb");
+    file_path = path;
+    written = 0;
+
+    if (!file) {
+        throw std::runtime_error{ "Unable to open output file: " + path.string() };
+    }
+}
+
+void output_file::write(std::string_view bytes) {
+    pending.append(bytes);
+    commit();
+}
+
+void output_file::commit() {
+    if (pending.size() >= flush_threshold) {
+        flush();
+    }
+}
+
+void output_file::append_file(const std::filesystem::path& path) {
+    flush();
+
+    std::unique_ptr<std::FILE, int(*)(std::FILE*)> input{ open_file(path, "rb"), &std::fclose };
+
+    if (!input) {
+        throw std::runtime_error{ "Unable to read file: " + path.string() };
+    }
+
+    // Copy straight through the buffer, one threshold-sized block at a time
+    pending.resize(std::max<size_t>(flush_threshold, 4096));
+
+    size_t count{};
+    while ((count = std::fread(pending.data(), 1, pending.size(), input.get())) > 0) {
+        if (std::fwrite(pending.data(), 1, count, file) != count) {
+            pending.clear();
+            throw std::runtime_error{ "Unable to write output file: " + file_path.string() };
+        }
+
+        written += count;
+    }
+
+    pending.clear();
+}
+
+void output_file::close() {
+    if (!file) {
+        return;
+    }
+
+    flush();
+
+    int result{ std::fclose(file) };
+    file = nullptr;
+
+    if (result != 0) {
+        throw std::runtime_error{ "Unable to close output file: " + file_path.string() };
+    }
+}
+
+void output_file::flush() {
+    if (pending.empty()) {
+        return;
+    }
+
+    if (std::fwrite(pending.data(), 1, pending.size(), file) != pending.size()) {
+        throw std::runtime_error{ "Unable to write output file: " + file_path.string() };
+    }
+
+    written += pending.size();
+    pending.clear();
+}
@@ -0,0 +1,82 @@
+#ifndef _OUTPUT_FILE_H
+#define _OUTPUT_FILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+/**
+ * @class output_file
+ * @brief A write-only binary file with a large user-space buffer.
+ *
+ * Callers append into buffer() directly and call commit() once in a while,
+ * which hands the buffer to the OS whenever it grows past the flush threshold.
+ * I/O failures throw std::runtime_error.
+ */
+class output_file {
+    std::FILE* file{};
+    std::filesystem::path file_path{};
+    std::string pending{};
+    size_t flush_threshold{};
+    uint64_t written{};
+
+public:
+
+    /**
+     * @param flush_threshold : The buffered size, in bytes, that triggers a write.
+     */
+    explicit output_file(size_t flush_threshold = 1 << 20);
+    ~output_file();
+
+    output_file(const output_file&) = delete;
+    output_file& operator=(const output_file&) = delete;
+
+    /**
+     * @brief Creates or truncates the file.
+     *
+     * @param path : The file to write.
+     */
+    void open(const std::filesystem::path& path);
+
+    /**
+     * @brief Returns the buffer to append to.
+     */
+    std::string& buffer() { return pending; }
+
+    /**
+     * @brief Appends bytes to the buffer and writes it out if it is full.
+     */
+    void write(std::string_view bytes);
+
+    /**
+     * @brief Writes the buffer out if it has grown past the flush threshold.
+     */
+    void commit();
+
+    /**
+     * @brief Appends the whole content of another file.
+     *
+     * @param path : The file to copy from.
+     */
+    void append_file(const std::filesystem::path& path);
+
+    /**
+     * @brief Writes out the buffer and closes the file.
+     */
+    void close();
+
+    /**
+     * @brief Returns the number of bytes written so far, buffered bytes included.
+     */
+    uint64_t size() const { return written + pending.size(); }
+
+    bool is_open() const { return file != nullptr; }
+    const std::filesystem::path& path() const { return file_path; }
+
+private:
+    void flush();
+};
+
+#endif // !_OUTPUT_FILE_H
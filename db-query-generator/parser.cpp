@@ -1,72 +1,686 @@
 #include "parser.h"
+#include "binary_io.h"
+#include "encoding.h"
 
-parser::parser(std::string_view file_path) {
-	std::wifstream ifile(file_path.data());
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
 
-	if (!ifile.is_open()) {
+static std::runtime_error malformed(const std::string& reason) {
+	return std::runtime_error{ "Malformed snapshot: " + reason };
+}
+
+static size_t aligned(size_t offset) {
+	return (offset + 7) / 8 * 8;
+}
+
+// --------------------
+// START OF XML TOKENIZER FUNCTIONS
+// --------------------
+
+// A start, end or empty-element tag, pointing into the document
+struct xml_tag {
+	std::string_view name{}, attributes{};
+	size_t start{};
+	bool closing{}, self_closing{};
+};
+
+static bool is_space(char ch) {
+	return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+}
+
+// Moves to the next tag, skipping text, the XML declaration, comments and doctypes
+static bool next_tag(std::string_view text, size_t& pos, xml_tag& tag) {
+	while (true) {
+		size_t open{ text.find('<', pos) };
+
+		if (open == std::string_view::npos) {
+			pos = text.size();
+			return false;
+		}
+
+		if (text.compare(open, 4, "<!--") == 0) {
+			size_t close{ text.find("-->", open + 4) };
+			if (close == std::string_view::npos) {
+				throw malformed("unterminated comment");
+			}
+
+			pos = close + 3;
+			continue;
+		}
+
+		if (open + 1 < text.size() && (text[open + 1] == '?' || text[open + 1] == '!')) {
+			size_t close{ text.find('>', open) };
+			if (close == std::string_view::npos) {
+				throw malformed("unterminated declaration");
+			}
+
+			pos = close + 1;
+			continue;
+		}
+
+		tag = xml_tag{};
+		tag.start = open;
+
+		size_t name_start{ open + 1 };
+		if (name_start < text.size() && text[name_start] == '/') {
+			tag.closing = true;
+			name_start++;
+		}
+
+		size_t name_end{ name_start };
+		while (name_end < text.size() && !is_space(text[name_end]) && text[name_end] != '>' && text[name_end] != '/') {
+			name_end++;
+		}
+
+		// '>' may appear unescaped inside attribute values, so quotes have to be tracked
+		char quote{};
+		size_t close{ name_end };
+		for (; close < text.size(); close++) {
+			char ch{ text[close] };
+
+			if (quote) {
+				quote = ch == quote ? char{} : quote;
+			}
+			else if (ch == '"' || ch == '\'') {
+				quote = ch;
+			}
+			else if (ch == '>') {
+				break;
+			}
+		}
+
+		if (close == text.size()) {
+			throw malformed("unterminated tag");
+		}
+
+		tag.name = text.substr(name_start, name_end - name_start);
+		tag.self_closing = close > name_end && text[close - 1] == '/';
+		tag.attributes = text.substr(name_end, close - name_end - (tag.self_closing ? 1 : 0));
+		pos = close + 1;
+		return true;
+	}
+}
+
+// Reads the next 'name="value"' pair of a tag; the value is still escaped
+static bool next_attribute(std::string_view attributes, size_t& pos, std::string_view& name, std::string_view& value) {
+	while (pos < attributes.size() && is_space(attributes[pos])) {
+		pos++;
+	}
+
+	if (pos == attributes.size()) {
+		return false;
+	}
+
+	size_t equals{ attributes.find('=', pos) };
+	if (equals == std::string_view::npos || equals + 1 >= attributes.size()) {
+		throw malformed("attribute without a value");
+	}
+
+	size_t name_end{ equals };
+	while (name_end > pos && is_space(attributes[name_end - 1])) {
+		name_end--;
+	}
+
+	size_t open{ equals + 1 };
+	while (open < attributes.size() && is_space(attributes[open])) {
+		open++;
+	}
+
+	if (open == attributes.size() || (attributes[open] != '"' && attributes[open] != '\'')) {
+		throw malformed("unquoted attribute value");
+	}
+
+	size_t close{ attributes.find(attributes[open], open + 1) };
+	if (close == std::string_view::npos) {
+		throw malformed("unterminated attribute value");
+	}
+
+	name = attributes.substr(pos, name_end - pos);
+	value = attributes.substr(open + 1, close - open - 1);
+	pos = close + 1;
+	return true;
+}
+
+static std::string_view find_attribute(const xml_tag& tag, std::string_view wanted) {
+	size_t pos{};
+	std::string_view name{}, value{};
+
+	while (next_attribute(tag.attributes, pos, name, value)) {
+		if (name == wanted) {
+			return value;
+		}
+	}
+
+	return {};
+}
+
+// Replaces the entity and character references of escaped text
+static void decode_xml(std::string_view raw, std::string& out) {
+	out.clear();
+
+	for (size_t i{}; i < raw.size(); i++) {
+		if (raw[i] != '&') {
+			out.push_back(raw[i]);
+			continue;
+		}
+
+		size_t end{ raw.find(';', i) };
+		if (end == std::string_view::npos) {
+			throw malformed("unterminated character reference");
+		}
+
+		std::string_view entity{ raw.substr(i + 1, end - i - 1) };
+
+		if (entity == "amp") {
+			out.push_back('&');
+		}
+		else if (entity == "lt") {
+			out.push_back('<');
+		}
+		else if (entity == "gt") {
+			out.push_back('>');
+		}
+		else if (entity == "quot") {
+			out.push_back('"');
+		}
+		else if (entity == "apos") {
+			out.push_back('\'');
+		}
+		else if (entity.size() > 1 && entity[0] == '#') {
+			bool hex{ entity[1] == 'x' || entity[1] == 'X' };
+			std::string_view digits{ entity.substr(hex ? 2 : 1) };
+			uint32_t cp{};
+
+			// Surrogates are not characters, so they have no UTF-8 encoding
+			auto [last, error] { std::from_chars(digits.data(), digits.data() + digits.size(), cp, hex ? 16 : 10) };
+			if (error != std::errc{} || last != digits.data() + digits.size() || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+				throw malformed("invalid character reference");
+			}
+
+			append_code_point(out, static_cast<char32_t>(cp));
+		}
+		else {
+			throw malformed("unknown entity '" + std::string{ entity } + "'");
+		}
+
+		i = end;
+	}
+}
+
+// Returns the text itself when it holds no references, and its decoded copy in 'scratch' otherwise
+static std::string_view decoded_view(std::string_view raw, std::string& scratch) {
+	if (raw.find('&') == std::string_view::npos) {
+		return raw;
+	}
+
+	decode_xml(raw, scratch);
+	return scratch;
+}
+
+// --------------------
+// END OF XML TOKENIZER FUNCTIONS
+// --------------------
+// --------------------
+// START OF COLUMNAR READER FUNCTIONS
+// --------------------
+
+// The arrays of one column chunk, resolved against the mapping
+struct chunk_view {
+	column_kind kind{};
+	const char* validity{};
+	const char* values{};		///< Numbers, booleans or dictionary indices.
+	const char* offsets{};
+	const char* characters{};
+	uint32_t entries{};			///< Number of strings the offsets describe.
+	uint32_t character_count{};
+	size_t index_width{};		///< 0 for plain text.
+
+	static chunk_view open(std::string_view bytes, column_kind kind, chunk_encoding encoding, uint64_t offset, uint64_t size, uint32_t row_count) {
+		const char* base{ bytes.data() + offset };
+		size_t pos{ aligned((row_count + size_t{ 7 }) / 8) };
+
+		auto need = [&](size_t end) {
+			if (end > size) {
+				throw malformed("column chunk overruns its size");
+			}
+		};
+
+		chunk_view chunk{};
+		chunk.kind = kind;
+		chunk.validity = base;
+		need(pos);
+
+		switch (kind) {
+		case column_kind::int64:
+		case column_kind::float64:
+			need(pos + size_t{ 8 } * row_count);
+			chunk.values = base + pos;
+			return chunk;
+		case column_kind::boolean:
+			need(pos + (row_count + size_t{ 7 }) / 8);
+			chunk.values = base + pos;
+			return chunk;
+		case column_kind::utf8:
+			break;
+		}
+
+		chunk.entries = row_count;
+
+		if (encoding == chunk_encoding::dictionary) {
+			need(pos + 4);
+			std::memcpy(&chunk.entries, base + pos, 4);
+			pos += 4;
+		}
+
+		need(pos + size_t{ 4 } * (chunk.entries + size_t{ 1 }));
+		chunk.offsets = base + pos;
+		std::memcpy(&chunk.character_count, chunk.offsets + size_t{ 4 } * chunk.entries, 4);
+
+		// Offsets are relative to the file, so alignment is too
+		pos = aligned(offset + pos + size_t{ 4 } * (chunk.entries + size_t{ 1 })) - offset;
+		need(pos + chunk.character_count);
+		chunk.characters = base + pos;
+
+		if (encoding == chunk_encoding::dictionary) {
+			chunk.index_width = chunk.entries <= 256 ? 1 : 2;
+			pos = aligned(offset + pos + chunk.character_count) - offset;
+			need(pos + chunk.index_width * row_count);
+			chunk.values = base + pos;
+		}
+
+		return chunk;
+	}
+
+	std::string_view string_at(uint32_t index) const {
+		uint32_t begin{}, end{};
+		std::memcpy(&begin, offsets + size_t{ 4 } * index, 4);
+		std::memcpy(&end, offsets + size_t{ 4 } * (index + 1), 4);
+
+		if (begin > end || end > character_count) {
+			throw malformed("string offsets out of range");
+		}
+
+		return { characters + begin, end - begin };
+	}
+
+	std::string_view value(uint32_t row, std::array<char, 32>& buffer) const {
+		if (!((validity[row / 8] >> (row % 8)) & 1)) {
+			return {};
+		}
+
+		switch (kind) {
+		case column_kind::int64: {
+			int64_t number{};
+			std::memcpy(&number, values + size_t{ 8 } * row, 8);
+			auto [last, error] { std::to_chars(buffer.data(), buffer.data() + buffer.size(), number) };
+			return { buffer.data(), static_cast<size_t>(last - buffer.data()) };
+		}
+		case column_kind::float64: {
+			double number{};
+			std::memcpy(&number, values + size_t{ 8 } * row, 8);
+			auto [last, error] { std::to_chars(buffer.data(), buffer.data() + buffer.size(), number) };
+			return { buffer.data(), static_cast<size_t>(last - buffer.data()) };
+		}
+		case column_kind::boolean:
+			return ((values[row / 8] >> (row % 8)) & 1) ? "1" : "0";
+		case column_kind::utf8:
+			break;
+		}
+
+		if (index_width == 0) {
+			return string_at(row);
+		}
+
+		uint32_t index{ index_width == 1
+			? static_cast<uint8_t>(values[row])
+			: static_cast<uint32_t>(static_cast<uint8_t>(values[size_t{ 2 } * row]) | static_cast<uint8_t>(values[size_t{ 2 } * row + 1]) << 8) };
+
+		if (index >= entries) {
+			throw malformed("dictionary index out of range");
+		}
+
+		return string_at(index);
+	}
+};
+
+// --------------------
+// END OF COLUMNAR READER FUNCTIONS
+// --------------------
+// --------------------
+// START OF SNAPSHOT FUNCTIONS
+// --------------------
+
+snapshot::snapshot(const std::filesystem::path& file_path) :
+	file{ file_path } {
+	std::string_view bytes{ file.bytes() };
+
+	if (bytes.size() >= columnar_magic.size() && bytes.substr(0, columnar_magic.size()) == columnar_magic) {
+		format = formats::columnar;
+		load_columnar();
+	}
+	else {
+		format = formats::xml;
+		load_xml();
+	}
+}
+
+std::string_view snapshot::keep_decoded(std::string_view raw) {
+	if (raw.find('&') == std::string_view::npos) {
+		return raw;
+	}
+
+	decode_xml(raw, decoded.emplace_back());
+	return decoded.back();
+}
+
+void snapshot::load_xml() {
+	std::string_view text{ file.bytes() };
+	size_t pos{};
+	xml_tag tag{};
+
+	if (!next_tag(text, pos, tag) || tag.closing || tag.name != "database") {
+		throw malformed("expected a <database> element");
+	}
+
+	if (tag.self_closing) {
 		return;
 	}
 
-	states state{};
-	size_t scope{ 0 }, cur_table_idx{};
-	std::wstring line{}, buffer{};
-	while (std::getline(ifile, line)) {
-		bool lhs{};
+	while (next_tag(text, pos, tag)) {
+		if (tag.closing && tag.name == "database") {
+			return;
+		}
+
+		if (tag.closing || tag.name != "table") {
+			throw malformed("expected a <table> element");
+		}
+
+		snapshot_table table{};
+		table_location location{};
+
+		std::string_view qualified_name{ keep_decoded(find_attribute(tag, "name")) };
+		size_t split{ qualified_name.find('.') };
+		table.schema = split == std::string_view::npos ? std::string_view{} : qualified_name.substr(0, split);
+		table.name = split == std::string_view::npos ? qualified_name : qualified_name.substr(split + 1);
 
-		for (const auto& ltr : line) {
-			switch (state) {
-			case states::start:
-				if (isspace(ltr)) {
-					state = states::start;
-					continue;
+		std::string_view row_count{ find_attribute(tag, "number_of_rows") };
+		std::from_chars(row_count.data(), row_count.data() + row_count.size(), table.row_count);
+
+		if (!tag.self_closing) {
+			while (next_tag(text, pos, tag) && !tag.closing && tag.name == "column") {
+				table.columns.emplace_back(snapshot_column{ keep_decoded(find_attribute(tag, "name")), keep_decoded(find_attribute(tag, "type")) });
+			}
+
+			if (!tag.closing || tag.name != "table") {
+				// Attribute values escape '<', so the end tag cannot appear before the real one
+				size_t end{ text.find("</table>", tag.start) };
+				if (end == std::string_view::npos) {
+					throw malformed("unterminated <table> element");
 				}
-				if (ltr == L'{') {
-					scope++;
-					state = states::value;
-					continue;
+
+				location.body = text.substr(tag.start, end - tag.start);
+				pos = end + std::string_view{ "</table>" }.size();
+			}
+		}
+
+		table_list.emplace_back(std::move(table));
+		locations.emplace_back(std::move(location));
+	}
+
+	throw malformed("missing </database>");
+}
+
+void snapshot::load_columnar() {
+	std::string_view bytes{ file.bytes() };
+	size_t trailer_size{ sizeof(uint64_t) + columnar_magic.size() };
+
+	if (bytes.size() < columnar_magic.size() + trailer_size || bytes.substr(bytes.size() - columnar_magic.size()) != columnar_magic) {
+		throw malformed("missing columnar trailer");
+	}
+
+	uint64_t directory{};
+	std::memcpy(&directory, bytes.data() + bytes.size() - trailer_size, sizeof(directory));
+
+	std::string_view contents{ bytes.substr(0, bytes.size() - trailer_size) };
+	byte_reader reader{ contents, static_cast<size_t>(directory), "snapshot directory" };
+	uint32_t table_count{ reader.read<uint32_t>() };
+
+	for (uint32_t t{}; t < table_count; t++) {
+		snapshot_table table{};
+		table_location location{};
+
+		table.schema = reader.read_string();
+		table.name = reader.read_string();
+		table.row_count = reader.read<uint64_t>();
+
+		uint32_t column_count{ reader.read<uint32_t>() };
+
+		for (uint32_t c{}; c < column_count; c++) {
+			snapshot_column column{};
+			column.name = reader.read_string();
+			column.data_type = reader.read_string();
+
+			uint8_t kind{ reader.read<uint8_t>() };
+			if (kind > static_cast<uint8_t>(column_kind::utf8)) {
+				throw malformed("unknown column kind");
+			}
+
+			std::vector<chunk_location> chunks(reader.read<uint32_t>());
+
+			for (auto& chunk : chunks) {
+				chunk.offset = reader.read<uint64_t>();
+				chunk.size = reader.read<uint64_t>();
+				chunk.row_count = reader.read<uint32_t>();
+				chunk.encoding = reader.read<chunk_encoding>();
+
+				if (chunk.offset > directory || chunk.size > directory - chunk.offset || chunk.offset % 8 != 0) {
+					throw malformed("column chunk outside the data section");
 				}
-				if (ltr == L'"') {
-					if (lhs) {
-						state = states::key;
-						continue;
-					}
-					else {
-						state = states::value;
-						continue;
-					}
+			}
+
+			table.columns.emplace_back(column);
+			location.kinds.emplace_back(static_cast<column_kind>(kind));
+			location.chunks.emplace_back(std::move(chunks));
+		}
+
+		// Every column is cut at the same rows
+		for (const auto& chunks : location.chunks) {
+			if (chunks.size() != location.chunks.front().size()) {
+				throw malformed("columns of " + std::string{ table.name } + " have different chunk counts");
+			}
+
+			for (size_t k{}; k < chunks.size(); k++) {
+				if (chunks[k].row_count != location.chunks.front()[k].row_count) {
+					throw malformed("columns of " + std::string{ table.name } + " have different chunk sizes");
 				}
-				if (ltr == L':') {
-					lhs = false;
-					continue;
+			}
+		}
+
+		table_list.emplace_back(std::move(table));
+		locations.emplace_back(std::move(location));
+	}
+}
+
+void snapshot::for_each_row(size_t table, const snapshot_row_callback& on_row) const {
+	if (format == formats::xml) {
+		xml_rows(table, on_row);
+	}
+	else {
+		columnar_rows(table, on_row);
+	}
+}
+
+void snapshot::xml_rows(size_t table, const snapshot_row_callback& on_row) const {
+	const std::vector<snapshot_column>& columns{ table_list[table].columns };
+	std::string_view body{ locations[table].body };
+
+	std::vector<std::string_view> fields(columns.size());
+	std::vector<std::string> scratch(columns.size());
+	std::string parent_scratch{};
+
+	size_t pos{};
+	xml_tag tag{};
+
+	while (next_tag(body, pos, tag)) {
+		if (tag.closing || tag.name != "row") {
+			throw malformed("expected a <row> element");
+		}
+
+		std::fill(fields.begin(), fields.end(), std::string_view{});
+
+		if (!tag.self_closing) {
+			size_t next_column{};
+			bool closed{};
+
+			while (next_tag(body, pos, tag)) {
+				if (tag.closing && tag.name == "row") {
+					closed = true;
+					break;
 				}
-				state = states::unknown;
-				break;
-			case states::key:
-				if (isalpha(ltr) || (ltr == L'.') || (ltr == L'_')) {
-					buffer.push_back(ltr);
-					state = states::key;
-					continue;
+
+				if (tag.closing || tag.name != "field") {
+					throw malformed("expected a <field> element");
 				}
-				if (ltr == L'"') {
-					switch (scope) {
-					case 0: {
-						size_t split{ buffer.find_first_of(L'.') };
-						std::wstring table_schema{ buffer.substr(0, split) };
-						std::wstring table_name{ buffer.substr(split + 1, buffer.length() - split) };
-						tables.emplace_back(std::make_shared<table_info>(table_info{ table_name, table_schema }));
-						buffer.clear();
-						state = states::start;
+
+				size_t attribute_pos{};
+				std::string_view name{}, value{}, parent_column{}, field_value{};
+
+				while (next_attribute(tag.attributes, attribute_pos, name, value)) {
+					if (name == "parent_column") {
+						parent_column = decoded_view(value, parent_scratch);
 					}
-					default:
-						state = states::unknown;
-						break;
+					else if (name == "value") {
+						field_value = value;
 					}
-					state = states::start;
-					continue;
 				}
-				state = states::unknown;
-				break;
+
+				// Fields are written in column order, so the next column is nearly always the match
+				size_t column{ next_column };
+				if (column >= columns.size() || columns[column].name != parent_column) {
+					column = 0;
+					while (column < columns.size() && columns[column].name != parent_column) {
+						column++;
+					}
+				}
+
+				if (column < columns.size()) {
+					fields[column] = decoded_view(field_value, scratch[column]);
+					next_column = column + 1;
+				}
 			}
+
+			if (!closed) {
+				throw malformed("unterminated <row> element");
+			}
+		}
+
+		on_row(fields);
+	}
+}
+
+void snapshot::columnar_rows(size_t table, const snapshot_row_callback& on_row) const {
+	const snapshot_table& info{ table_list[table] };
+	const table_location& location{ locations[table] };
+	std::string_view bytes{ file.bytes() };
+
+	std::vector<std::string_view> fields(info.columns.size());
+
+	// A table without columns still has rows
+	if (info.columns.empty()) {
+		for (uint64_t row{}; row < info.row_count; row++) {
+			on_row(fields);
 		}
+
+		return;
 	}
-}
\ No newline at end of file
+
+	std::vector<chunk_view> chunks(info.columns.size());
+	std::vector<std::array<char, 32>> buffers(info.columns.size());
+
+	for (size_t k{}; k < location.chunks.front().size(); k++) {
+		for (size_t c{}; c < chunks.size(); c++) {
+			const chunk_location& chunk{ location.chunks[c][k] };
+			chunks[c] = chunk_view::open(bytes, location.kinds[c], chunk.encoding, chunk.offset, chunk.size, chunk.row_count);
+		}
+
+		for (uint32_t row{}; row < location.chunks.front()[k].row_count; row++) {
+			for (size_t c{}; c < chunks.size(); c++) {
+				fields[c] = chunks[c].value(row, buffers[c]);
+			}
+
+			on_row(fields);
+		}
+	}
+}
+
+// --------------------
+// END OF SNAPSHOT FUNCTIONS
+// --------------------
+// --------------------
+// START OF STATEMENT SET FUNCTIONS
+// --------------------
+
+statement_reader::statement_reader(const std::filesystem::path& file_path) :
+	file(file_path) {}
+
+void statement_reader::rewind() {
+	pos = 0;
+	current = recorded_statement{};
+}
+
+bool statement_reader::next(recorded_statement& statement) {
+	std::string_view text{ file.bytes() };
+	xml_tag tag{};
+
+	while (next_tag(text, pos, tag)) {
+		if (tag.closing) {
+			// A template stays current for its parameter sets, which only differ in their parameters
+			if (tag.name == "statement" || tag.name == "parameters") {
+				statement = current;
+				current.parameters.clear();
+				return true;
+			}
+			else if (tag.name == "template") {
+				current = recorded_statement{};
+			}
+
+			continue;
+		}
+
+		std::wstring* target{};
+
+		if (tag.name == "query") {
+			target = &current.sql;
+		}
+		else if (tag.name == "label") {
+			target = &current.label;
+		}
+		else if (tag.name == "type") {
+			target = &current.parameter_types.emplace_back();
+		}
+		else if (tag.name == "value") {
+			target = &current.parameters.emplace_back();
+		}
+
+		if (!target || tag.self_closing) {
+			continue;
+		}
+
+		// Both elements hold nothing but text
+		size_t end{ text.find('<', pos) };
+		if (end == std::string_view::npos) {
+			throw std::runtime_error{ "Malformed statement set: unterminated <" + std::string{ tag.name } + "> element" };
+		}
+
+		*target = utf8_to_wide(decoded_view(text.substr(pos, end - pos), scratch));
+		pos = end;
+	}
+
+	return false;
+}
+
+// --------------------
+// END OF STATEMENT SET FUNCTIONS
+// --------------------
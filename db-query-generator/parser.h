@@ -1,29 +1,154 @@
 #ifndef _PARSER_H
 #define _PARSER_H
 
-#include <map>
-#include <fstream>
-#include <vector>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <functional>
 #include <string>
-#include <variant>
+#include <string_view>
+#include <vector>
+
+#include "columnar_format.h"
+#include "mapped_file.h"
 
-#include "sql_statement_factory.h"
+/* Type Definitions
+************************************************************************/
 
-enum struct states {
-	start,
-	key,
-	value,
-	unknown
+// A column of a snapshot; the strings are UTF-8 and point into the mapped file
+struct snapshot_column {
+	std::string_view name{}, data_type{};
 };
 
-using value = std::variant<std::string, std::vector<std::string>>;
+// A table of a snapshot; the strings are UTF-8 and point into the mapped file
+struct snapshot_table {
+	std::string_view schema{}, name{};
+	std::vector<snapshot_column> columns{};
+	uint64_t row_count{};
+};
+
+// Receives the UTF-8 fields of a single row, in column order; the views are only valid during the call
+using snapshot_row_callback = std::function<void(const std::vector<std::string_view>& fields)>;
+
+/**
+ * @class snapshot
+ * @brief A previously exported database, read in place from a memory mapping.
+ *
+ * Reads both the XML and the columnar export; the format is detected from the
+ * content of the file. Opening a snapshot only reads its catalog: the rows of
+ * XML tables are located but not tokenized, and columnar tables are described
+ * by the directory at the end of the file. Names and values are handed out as
+ * views into the mapping; only the rare values that contain XML character
+ * references are decoded into separate storage.
+ *
+ * Reading rows does not modify the snapshot, so one snapshot can be read from
+ * several threads at once. Malformed files throw std::runtime_error.
+ */
+class snapshot {
+	// Where a chunk of a columnar column lives in the file
+	struct chunk_location {
+		uint64_t offset{}, size{};
+		uint32_t row_count{};
+		chunk_encoding encoding{};
+	};
 
-class parser {
-	std::vector<std::shared_ptr<table_info>> tables{};
+	// Where the rows of a table live in the file
+	struct table_location {
+		std::string_view body{};									///< XML: the '<row>' elements of the table.
+		std::vector<column_kind> kinds{};							///< Columnar: the storage kind of every column.
+		std::vector<std::vector<chunk_location>> chunks{};			///< Columnar: the chunks of every column.
+	};
+
+	enum struct formats {
+		xml,
+		columnar
+	};
+
+	mapped_file file{};
+	formats format{};
+	std::vector<snapshot_table> table_list{};
+	std::vector<table_location> locations{};
+	std::deque<std::string> decoded{};
 
 public:
 
-	parser(std::string_view file_path);
+	/**
+	 * @brief Maps a snapshot file and reads its catalog.
+	 *
+	 * @param file_path : The XML or columnar export to read.
+	 */
+	explicit snapshot(const std::filesystem::path& file_path);
+
+	snapshot(const snapshot&) = delete;
+	snapshot& operator=(const snapshot&) = delete;
+
+	/**
+	 * @brief Returns the tables in the order they were exported.
+	 */
+	const std::vector<snapshot_table>& tables() const { return table_list; }
+
+	/**
+	 * @brief Streams every row of a table.
+	 *
+	 * Missing values, such as NULLs in a columnar snapshot, are empty.
+	 *
+	 * @param table : The index of the table in tables().
+	 * @param on_row : Called once per row.
+	 */
+	void for_each_row(size_t table, const snapshot_row_callback& on_row) const;
+
+private:
+	void load_xml();
+	void load_columnar();
+	void xml_rows(size_t table, const snapshot_row_callback& on_row) const;
+	void columnar_rows(size_t table, const snapshot_row_callback& on_row) const;
+	std::string_view keep_decoded(std::string_view raw);
+};
+
+// A statement read back from a generated statement set
+struct recorded_statement {
+	std::wstring sql{}, label{};
+	std::vector<std::wstring> parameters{};			///< Bound to the ':1', ':2', ... markers of the SQL, if it is a template.
+	std::vector<std::wstring> parameter_types{};	///< The data type of every parameter.
+};
+
+/**
+ * @class statement_reader
+ * @brief Reads the statements of a 'statements.xml' document written by the generator, one at a time.
+ *
+ * Every '<statement>' is read as is and every parameter set in the batch of a
+ * '<template>' becomes a statement with the SQL of the template; the schemas
+ * and tables before them are skipped. The document is read in place from a
+ * memory mapping, so only the statement being read is held in memory however
+ * large the set is. Malformed files throw std::runtime_error.
+ */
+class statement_reader {
+	mapped_file file{};
+	size_t pos{};
+	recorded_statement current{};		///< A template stays current for its parameter sets.
+	std::string scratch{};
+
+public:
+
+	/**
+	 * @brief Maps a statement set and positions the reader at its first statement.
+	 *
+	 * @param file_path : The statement set to read.
+	 */
+	explicit statement_reader(const std::filesystem::path& file_path);
+
+	/**
+	 * @brief Reads the next statement, in document order.
+	 *
+	 * @param statement : Replaced with the statement; assigned to, so its strings keep their capacity.
+	 * @return Whether there was a statement left.
+	 */
+	bool next(recorded_statement& statement);
+
+	/**
+	 * @brief Starts reading over from the first statement.
+	 */
+	void rewind();
 };
 
-#endif // !_PARSER_H
\ No newline at end of file
+#endif // !_PARSER_H
@@ -0,0 +1,205 @@
+#include "pipeline.h"
+
+#include <algorithm>
+#include <numeric>
+#include <thread>
+
+#include "scheduler.h"
+
+namespace {
+    // Thrown inside the producer to unwind out of row_source::fetch_fields() after a sink failed
+    struct pipeline_cancelled {};
+}
+
+row_pipeline::row_pipeline(size_t chunk_rows, size_t chunk_count) :
+    chunk_rows(chunk_rows ? chunk_rows : 1), chunk_count(chunk_count ? chunk_count : 1) {}
+
+void row_pipeline::add_sink(row_sink& sink) {
+    sinks.push_back(&sink);
+}
+
+void row_pipeline::run(row_source& source, const std::vector<std::shared_ptr<table_info>>& tables) {
+    run_workers(1, tables, [&](size_t worker, size_t t) { produce(source, *tables[t], t); });
+}
+
+void row_pipeline::run(source_pool& sources, const std::vector<std::shared_ptr<table_info>>& tables) {
+    run_workers(sources.size(), tables, [&](size_t worker, size_t t) { produce(sources[worker], *tables[t], t); });
+}
+
+void row_pipeline::run_workers(size_t worker_count, const std::vector<std::shared_ptr<table_info>>& tables, const std::function<void(size_t worker, size_t table)>& task) {
+    chunks.clear();
+    free_chunks.clear();
+    messages.clear();
+    cancelled = false;
+
+    // Every worker holds a chunk while it fills it, so keep at least one spare
+    for (size_t i{}; i < std::max(chunk_count, worker_count + 1); i++) {
+        chunks.emplace_back(std::make_unique<table_info>(table_info{ L"", L"" }));
+        free_chunks.push_back(chunks.back().get());
+    }
+
+    // Biggest tables first so a huge table does not end up running alone at the end
+    std::vector<size_t> order(tables.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+        return tables[lhs]->row_estimate > tables[rhs]->row_estimate;
+    });
+
+    for (const auto& sink : sinks) {
+        sink->begin_database(tables);
+    }
+
+    std::exception_ptr producer_error{};
+    std::thread producer{ [&]() {
+        try {
+            work_stealing_scheduler{ worker_count }.run(order, task);
+        }
+        catch (const pipeline_cancelled&) {
+            // The consumer already holds the error
+        }
+        catch (...) {
+            producer_error = std::current_exception();
+        }
+
+        push(message{ message::kinds::done });
+    } };
+
+    try {
+        for (message msg{ pop() }; msg.kind != message::kinds::done; msg = pop()) {
+            const table_info& table{ *tables[msg.table] };
+
+            switch (msg.kind) {
+            case message::kinds::begin_table:
+                for (const auto& sink : sinks) {
+                    sink->begin_table(table);
+                }
+                break;
+            case message::kinds::rows:
+                for (const auto& sink : sinks) {
+                    sink->write_rows(table, *msg.chunk);
+                }
+                release(msg.chunk);
+                break;
+            case message::kinds::end_table:
+                for (const auto& sink : sinks) {
+                    sink->end_table(table, msg.row_count);
+                }
+                break;
+            case message::kinds::done:
+                break;
+            }
+        }
+    }
+    catch (...) {
+        {
+            std::lock_guard lock{ mutex };
+            cancelled = true;
+        }
+        changed.notify_all();
+        producer.join();
+        throw;
+    }
+
+    producer.join();
+
+    if (producer_error) {
+        std::rethrow_exception(producer_error);
+    }
+
+    for (const auto& sink : sinks) {
+        sink->end_database();
+    }
+}
+
+size_t row_pipeline::memory_usage() const {
+    size_t bytes{};
+
+    for (const auto& chunk : chunks) {
+        bytes += chunk->memory_usage();
+    }
+
+    return bytes;
+}
+
+// Runs on a worker thread: fetches one table and cuts its rows into chunks
+void row_pipeline::produce(row_source& source, table_info& table, size_t t) {
+    size_t row_count{};
+
+    push(message{ message::kinds::begin_table, t });
+
+    table_info* chunk{ acquire(table) };
+
+    source.fetch_fields(table, [&](const std::vector<field_value>& fields) {
+        for (size_t i{}; i < fields.size(); i++) {
+            chunk->add_field(i, fields[i]);
+        }
+
+        chunk->finish_row();
+        row_count++;
+
+        if (chunk->row_count() >= chunk_rows) {
+            push(message{ message::kinds::rows, t, chunk });
+            chunk = acquire(table);
+        }
+    });
+
+    if (chunk->row_count()) {
+        push(message{ message::kinds::rows, t, chunk });
+    }
+    else {
+        release(chunk);
+    }
+
+    push(message{ message::kinds::end_table, t, nullptr, row_count });
+}
+
+void row_pipeline::push(message msg) {
+    {
+        std::lock_guard lock{ mutex };
+        messages.push_back(msg);
+    }
+    changed.notify_all();
+}
+
+row_pipeline::message row_pipeline::pop() {
+    std::unique_lock lock{ mutex };
+    changed.wait(lock, [&]() { return !messages.empty(); });
+
+    message msg{ messages.front() };
+    messages.pop_front();
+    return msg;
+}
+
+// Blocks until a chunk is free, which is what bounds the memory of the pipeline
+table_info* row_pipeline::acquire(const table_info& table) {
+    table_info* chunk{};
+
+    {
+        std::unique_lock lock{ mutex };
+        changed.wait(lock, [&]() { return cancelled || !free_chunks.empty(); });
+
+        if (cancelled) {
+            throw pipeline_cancelled{};
+        }
+
+        chunk = free_chunks.back();
+        free_chunks.pop_back();
+    }
+
+    if (chunk->name != table.name || chunk->schema != table.schema || chunk->columns.size() != table.columns.size()) {
+        chunk->copy_layout(table);
+    }
+    else {
+        chunk->clear_rows();
+    }
+
+    return chunk;
+}
+
+void row_pipeline::release(table_info* chunk) {
+    {
+        std::lock_guard lock{ mutex };
+        free_chunks.push_back(chunk);
+    }
+    changed.notify_all();
+}
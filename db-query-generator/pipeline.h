@@ -0,0 +1,134 @@
+#ifndef _PIPELINE_H
+#define _PIPELINE_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+
+#include "row_source.h"
+
+/* Type Definitions
+************************************************************************/
+
+// Base class for anything extracted rows are written to
+class row_sink {
+public:
+    virtual ~row_sink() = default;
+
+    /**
+     * @brief Called once before any table is extracted.
+     *
+     * @param tables : Every table that will be extracted, in output order.
+     */
+    virtual void begin_database(const std::vector<std::shared_ptr<table_info>>& tables) {}
+
+    /**
+     * @brief Called before the first rows of a table.
+     *
+     * Tables are extracted concurrently, so calls for different tables may interleave.
+     *
+     * @param table : The table.
+     */
+    virtual void begin_table(const table_info& table) {}
+
+    /**
+     * @brief Called with each chunk of rows, in fetch order.
+     *
+     * @param table : The table the rows belong to.
+     * @param chunk : The rows; only valid during the call.
+     */
+    virtual void write_rows(const table_info& table, const table_info& chunk) = 0;
+
+    /**
+     * @brief Called after the last rows of a table.
+     *
+     * @param table : The table.
+     * @param row_count : The total number of rows extracted from the table.
+     */
+    virtual void end_table(const table_info& table, size_t row_count) {}
+
+    /**
+     * @brief Called once after every table has been extracted.
+     */
+    virtual void end_database() {}
+};
+
+/**
+ * @class row_pipeline
+ * @brief Streams rows from a row_source to a set of row_sinks through a bounded buffer.
+ *
+ * Tables are read on background threads, one per source of the pool, which fill
+ * fixed-size chunks of rows; the sinks are only ever called from the calling thread,
+ * so they need no locking even though chunks of different tables arrive interleaved.
+ * At most 'chunk_count' chunks exist at any time, so memory use does not depend on
+ * the size of the tables.
+ */
+class row_pipeline {
+    struct message {
+        enum struct kinds { begin_table, rows, end_table, done } kind{};
+        size_t table{};
+        table_info* chunk{};
+        size_t row_count{};
+    };
+
+    size_t chunk_rows{}, chunk_count{};
+    std::vector<row_sink*> sinks{};
+
+    std::vector<std::unique_ptr<table_info>> chunks{};
+    std::vector<table_info*> free_chunks{};
+    std::deque<message> messages{};
+    std::mutex mutex{};
+    std::condition_variable changed{};
+    bool cancelled{};
+
+public:
+
+    /**
+     * @brief Creates a pipeline.
+     *
+     * @param chunk_rows : The number of rows buffered per chunk.
+     * @param chunk_count : The number of chunks that may be in flight at once.
+     */
+    row_pipeline(size_t chunk_rows = 4096, size_t chunk_count = 4);
+
+    /**
+     * @brief Adds a sink; sinks are called in the order they were added.
+     */
+    void add_sink(row_sink& sink);
+
+    /**
+     * @brief Extracts every table from the source into the sinks.
+     *
+     * Exceptions thrown by the source or a sink stop the pipeline and are rethrown.
+     *
+     * @param source : The source to read from.
+     * @param tables : The tables to extract.
+     */
+    void run(row_source& source, const std::vector<std::shared_ptr<table_info>>& tables);
+
+    /**
+     * @brief Extracts the tables concurrently, one table per source at a time.
+     *
+     * The largest tables, by table_info::row_estimate, are started first.
+     *
+     * @param sources : The sources to read from; one worker thread is used per source.
+     * @param tables : The tables to extract.
+     */
+    void run(source_pool& sources, const std::vector<std::shared_ptr<table_info>>& tables);
+
+    /**
+     * @brief Returns the number of bytes held by the chunk buffers.
+     */
+    size_t memory_usage() const;
+
+private:
+    void run_workers(size_t worker_count, const std::vector<std::shared_ptr<table_info>>& tables, const std::function<void(size_t worker, size_t table)>& task);
+    void produce(row_source& source, table_info& table, size_t t);
+    void push(message msg);
+    message pop();
+    table_info* acquire(const table_info& table);
+    void release(table_info* chunk);
+};
+
+#endif // !_PIPELINE_H
@@ -0,0 +1,299 @@
+#include "replay.h"
+#include "data_types.h"
+#include "hashing.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+using namespace std::literals;
+
+using replay_clock = std::chrono::steady_clock;
+
+// The kinds of generated statements, in report order; 'select_all_' has to be matched before 'select_'
+static constexpr std::wstring_view statement_kinds[]{
+    L"select_all_", L"select_", L"filter_statement", L"conjunction_statement", L"range_statement", L"in_list_statement", L"top_statement", L"join_statement" };
+
+// --------------------
+// START OF LATENCY HISTOGRAM FUNCTIONS
+// --------------------
+
+// The lowest values get a bucket each; above them the top sub_bucket_bits bits of a value pick its bucket
+size_t latency_histogram::bucket_of(uint64_t nanoseconds) {
+    uint64_t value{ std::min(nanoseconds, (uint64_t{ 1 } << highest_bit) - 1) };
+    unsigned shift{ std::max(static_cast<unsigned>(std::bit_width(value)), sub_bucket_bits) - sub_bucket_bits };
+    return (size_t{ shift } << (sub_bucket_bits - 1)) + static_cast<size_t>(value >> shift);
+}
+
+uint64_t latency_histogram::highest_in(size_t bucket) {
+    size_t half{ size_t{ 1 } << (sub_bucket_bits - 1) };
+    unsigned shift{ bucket < 2 * half ? 0u : static_cast<unsigned>(bucket / half - 1) };
+    return ((static_cast<uint64_t>(bucket - shift * half) + 1) << shift) - 1;
+}
+
+void latency_histogram::record(uint64_t nanoseconds) {
+    counts[bucket_of(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t seen{ highest.load(std::memory_order_relaxed) };
+    while (nanoseconds > seen && !highest.compare_exchange_weak(seen, nanoseconds, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t latency_histogram::percentile(double fraction) const {
+    uint64_t recorded{ count() };
+    if (!recorded) {
+        return 0;
+    }
+
+    // The rank of the value, counting from 1
+    uint64_t rank{ std::clamp(static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(recorded))), uint64_t{ 1 }, recorded) };
+    uint64_t seen{};
+
+    for (size_t i{}; i < bucket_count; i++) {
+        seen += counts[i].load(std::memory_order_relaxed);
+
+        if (seen >= rank) {
+            return std::min(highest_in(i), max());
+        }
+    }
+
+    return max();
+}
+
+// --------------------
+// END OF LATENCY HISTOGRAM FUNCTIONS
+// --------------------
+// --------------------
+// START OF RUNNER FUNCTIONS
+// --------------------
+
+sqlapi_runner::sqlapi_runner(const std::wstring& connection_string) {
+    conn.Connect(connection_string.c_str(), L"", L"", SA_SQLServer_Client);
+}
+
+sqlapi_runner::~sqlapi_runner() {
+    try {
+        prepared.clear();
+        conn.Disconnect();
+    }
+    catch (SAException&) {
+        // Nothing sensible to do while tearing down
+    }
+}
+
+// Binds a parameter as the storage of its type, so the server compares it without converting the column
+static void bind(SAParam& param, const std::wstring& value, std::wstring_view type) {
+    switch (lookup_type(type).storage) {
+    case value_storage::integer:
+        param.setAsInt64() = std::wcstoll(value.c_str(), nullptr, 10);
+        break;
+    case value_storage::real:
+        param.setAsDouble() = std::wcstod(value.c_str(), nullptr);
+        break;
+    default:
+        param.setAsString() = value.c_str();
+        break;
+    }
+}
+
+// The rows are read and dropped, so the time includes transferring them
+void sqlapi_runner::run(const recorded_statement& statement) {
+    try {
+        if (statement.parameters.empty()) {
+            SACommand cmd{ &conn, statement.sql.c_str() };
+            cmd.Execute();
+
+            while (cmd.isResultSet() && cmd.FetchNext()) {
+            }
+
+            return;
+        }
+
+        std::unique_ptr<SACommand>& cmd{ prepared[statement.sql] };
+        if (!cmd) {
+            cmd = std::make_unique<SACommand>(&conn, statement.sql.c_str());
+            cmd->Prepare();
+        }
+
+        for (size_t i{}; i < statement.parameters.size(); i++) {
+            bind(cmd->Param(static_cast<int>(i + 1)), statement.parameters[i], i < statement.parameter_types.size() ? statement.parameter_types[i] : std::wstring_view{});
+        }
+
+        cmd->Execute();
+
+        while (cmd->isResultSet() && cmd->FetchNext()) {
+        }
+    }
+    catch (SAException& err) {
+        throw std::runtime_error{ err.ErrText().GetMultiByteChars() };
+    }
+}
+
+simulated_runner::simulated_runner(std::chrono::nanoseconds mean_latency, uint64_t seed) :
+    mean_latency(mean_latency), state(seed) {
+}
+
+void simulated_runner::run(const recorded_statement& statement) {
+    std::wstring_view sql{ statement.sql };
+
+    // A uniform draw in [0, 1) turned into an exponential one
+    state += 0x9E3779B97F4A7C15ull;
+    double uniform{ static_cast<double>(mix_bits(state) >> 11) * 0x1p-53 };
+    double scale{ sql.starts_with(L"SELECT * "sv) && sql.find(L" WHERE "sv) == std::wstring_view::npos ? 2.0 : 1.0 };
+
+    std::this_thread::sleep_for(std::chrono::nanoseconds{ static_cast<int64_t>(-std::log1p(-uniform) * scale * static_cast<double>(mean_latency.count())) });
+}
+
+// --------------------
+// END OF RUNNER FUNCTIONS
+// --------------------
+// --------------------
+// START OF REPLAY FUNCTIONS
+// --------------------
+
+std::wstring_view label_kind(std::wstring_view label) {
+    for (std::wstring_view kind : statement_kinds) {
+        if (label.starts_with(kind)) {
+            return kind;
+        }
+    }
+
+    return statement_kinds[2];
+}
+
+static latency_summary summarize(std::wstring_view name, const latency_histogram& latencies, uint64_t errors, std::chrono::nanoseconds elapsed) {
+    double seconds{ std::chrono::duration<double>(elapsed).count() };
+
+    return latency_summary{
+        std::wstring{ name }, latencies.count(), errors,
+        seconds > 0.0 ? static_cast<double>(latencies.count()) / seconds : 0.0,
+        std::chrono::nanoseconds{ latencies.percentile(0.5) },
+        std::chrono::nanoseconds{ latencies.percentile(0.99) },
+        std::chrono::nanoseconds{ latencies.percentile(0.999) },
+        std::chrono::nanoseconds{ latencies.max() } };
+}
+
+// The index of the kind of statement a label names, in statement_kinds
+static size_t kind_index(std::wstring_view label) {
+    return static_cast<size_t>(std::find(std::begin(statement_kinds), std::end(statement_kinds), label_kind(label)) - std::begin(statement_kinds));
+}
+
+// The latencies of the statements of one kind, shared by the workers
+struct kind_latencies {
+    latency_histogram latencies{};
+    std::atomic<uint64_t> errors{};
+};
+
+replay_report replay_statements(const statement_supplier& next_statement, const runner_factory& open, const replay_options& options) {
+    // One entry per kind, however many distinct labels the set holds
+    std::mutex drawing{};
+    kind_latencies kinds[std::size(statement_kinds)]{};
+    std::atomic<bool> empty{};
+
+    // Connecting is mostly waiting on the server, so open every runner at once
+    std::vector<std::future<std::unique_ptr<statement_runner>>> pending{};
+    for (size_t i{}; i < std::max<size_t>(options.workers, 1); i++) {
+        pending.emplace_back(std::async(std::launch::async, open));
+    }
+
+    std::vector<std::unique_ptr<statement_runner>> runners{};
+    for (auto& runner : pending) {
+        runners.emplace_back(runner.get());
+    }
+
+    const auto started{ replay_clock::now() };
+    const auto recording{ started + options.warmup };
+    const auto stopping{ recording + options.duration };
+    const auto interval{ std::chrono::duration_cast<replay_clock::duration>(std::chrono::duration<double>{ 1.0 / std::max(options.rate, 1e-3) }) };
+
+    std::atomic<uint64_t> next_ticket{};
+    std::vector<replay_clock::time_point> finished(runners.size(), recording);
+    std::vector<std::thread> workers{};
+
+    for (size_t worker{}; worker < runners.size(); worker++) {
+        workers.emplace_back([&, worker]() {
+            recorded_statement statement{};
+
+            while (true) {
+                uint64_t ticket{ next_ticket.fetch_add(1, std::memory_order_relaxed) };
+                replay_clock::time_point due{};
+
+                if (options.arrival == arrival_model::open) {
+                    due = started + interval * static_cast<int64_t>(ticket);
+                    if (due >= stopping) {
+                        break;
+                    }
+
+                    std::this_thread::sleep_until(due);
+                }
+                else {
+                    due = replay_clock::now();
+                    if (due >= stopping) {
+                        break;
+                    }
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock{ drawing };
+
+                    if (!next_statement(statement)) {
+                        empty = true;
+                        break;
+                    }
+                }
+
+                kind_latencies& kind{ kinds[kind_index(statement.label)] };
+
+                bool failed{};
+
+                try {
+                    runners[worker]->run(statement);
+                }
+                catch (const std::exception&) {
+                    failed = true;
+                }
+
+                auto done{ replay_clock::now() };
+                if (due < recording) {
+                    continue;
+                }
+
+                if (failed) {
+                    kind.errors.fetch_add(1, std::memory_order_relaxed);
+                }
+                else {
+                    kind.latencies.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(done - due).count()));
+                }
+
+                finished[worker] = done;
+            }
+        });
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    if (empty) {
+        throw std::invalid_argument{ "There are no statements to replay" };
+    }
+
+    // Statements started before the end are waited for, so the time runs until the last one finished
+    replay_report report{};
+    report.elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(*std::max_element(finished.begin(), finished.end()) - recording);
+
+    for (size_t kind{}; kind < std::size(statement_kinds); kind++) {
+        report.kinds.emplace_back(summarize(statement_kinds[kind], kinds[kind].latencies, kinds[kind].errors.load(), report.elapsed));
+    }
+
+    return report;
+}
+
+// --------------------
+// END OF REPLAY FUNCTIONS
+// --------------------
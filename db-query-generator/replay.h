@@ -0,0 +1,191 @@
+#ifndef _REPLAY_H
+#define _REPLAY_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <SQLAPI.h>
+
+#include "parser.h"
+
+/* Type Definitions
+************************************************************************/
+
+/**
+ * @class latency_histogram
+ * @brief Counts latencies in log-linear buckets, the way HDR histograms do.
+ *
+ * Every power of two is split into 64 buckets, so a recorded value is reported
+ * within 1/64 of what it was, from a nanosecond up to about 18 minutes. Values
+ * are recorded with relaxed atomics, so any number of threads can record into
+ * one histogram at once.
+ */
+class latency_histogram {
+    static constexpr unsigned sub_bucket_bits{ 7 };     ///< Values below 2^7 get a bucket each; every power of two above gets 2^6.
+    static constexpr unsigned highest_bit{ 40 };        ///< Values from 2^40 ns up land in the last bucket.
+    static constexpr size_t bucket_count{ (highest_bit - sub_bucket_bits + 2) << (sub_bucket_bits - 1) };
+
+    std::unique_ptr<std::atomic<uint64_t>[]> counts{ new std::atomic<uint64_t>[bucket_count]{} };
+    std::atomic<uint64_t> total{};
+    std::atomic<uint64_t> highest{};
+
+public:
+
+    /**
+     * @brief Counts a latency.
+     *
+     * @param nanoseconds : The latency.
+     */
+    void record(uint64_t nanoseconds);
+
+    /**
+     * @brief Returns the number of latencies recorded.
+     */
+    uint64_t count() const { return total.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Returns the largest latency recorded, exactly.
+     */
+    uint64_t max() const { return highest.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Returns the latency that the given fraction of the recorded ones do not exceed.
+     *
+     * @param fraction : The fraction, such as 0.99 for the 99th percentile.
+     * @return The highest latency of its bucket, at most max(); 0 if nothing was recorded.
+     */
+    uint64_t percentile(double fraction) const;
+
+private:
+    static size_t bucket_of(uint64_t nanoseconds);
+    static uint64_t highest_in(size_t bucket);
+};
+
+/**
+ * @class statement_runner
+ * @brief Runs statements on a single connection for the replay.
+ *
+ * Runners are used by one worker each and never shared between threads.
+ */
+class statement_runner {
+public:
+    virtual ~statement_runner() = default;
+
+    /**
+     * @brief Runs a statement and reads every row it returns.
+     *
+     * Failures throw std::runtime_error; the replay counts them and moves on.
+     *
+     * @param statement : The statement to run, with its parameters if it is a template.
+     */
+    virtual void run(const recorded_statement& statement) = 0;
+};
+
+// Opens a new, independent runner (and connection)
+using runner_factory = std::function<std::unique_ptr<statement_runner>()>;
+
+// Replaces its argument with the next statement to replay, starting over once the set runs out; returns false only if the set is empty
+using statement_supplier = std::function<bool(recorded_statement& statement)>;
+
+// Runs statements against a SQL Server database through SQLAPI++; templates are prepared once per connection
+class sqlapi_runner : public statement_runner {
+    SAConnection conn{};
+    std::unordered_map<std::wstring, std::unique_ptr<SACommand>> prepared{};
+
+public:
+
+    /**
+     * @brief Connects to the database.
+     *
+     * @param connection_string : The SQLAPI++ connection string of the server and database.
+     */
+    explicit sqlapi_runner(const std::wstring& connection_string);
+    ~sqlapi_runner() override;
+
+    void run(const recorded_statement& statement) override;
+};
+
+/**
+ * @class simulated_runner
+ * @brief An in-process stand-in for a database, to exercise the replay without one.
+ *
+ * Every statement waits for an exponentially distributed time, so the latencies
+ * have a tail to measure; statements reading a whole table wait twice as long.
+ */
+class simulated_runner : public statement_runner {
+    std::chrono::nanoseconds mean_latency{};
+    uint64_t state{};
+
+public:
+
+    /**
+     * @param mean_latency : The mean time a filter or column select waits.
+     * @param seed : Seeds the waits.
+     */
+    simulated_runner(std::chrono::nanoseconds mean_latency, uint64_t seed);
+
+    void run(const recorded_statement& statement) override;
+};
+
+// When the replay starts the next statement
+enum struct arrival_model {
+    closed, ///< Every worker starts its next statement as soon as the last one finished.
+    open    ///< Statements start at a fixed rate, whether or not the earlier ones finished.
+};
+
+// How a statement set is replayed
+struct replay_options {
+    size_t workers{ 4 };                                ///< Statements run concurrently, each worker on its own connection.
+    arrival_model arrival{ arrival_model::closed };
+    double rate{ 100.0 };                               ///< Open loop: statements started per second, over all workers.
+    std::chrono::milliseconds warmup{ 5000 };           ///< Statements started this early are run but not recorded.
+    std::chrono::milliseconds duration{ 30000 };        ///< How long statements are recorded for, after the warmup.
+};
+
+// The latencies of the statements of one kind
+struct latency_summary {
+    std::wstring name{};
+    uint64_t count{}, errors{};
+    double throughput{};                                ///< Statements finished per second.
+    std::chrono::nanoseconds p50{}, p99{}, p999{}, max{};
+};
+
+// What a replay measured
+struct replay_report {
+    std::vector<latency_summary> kinds{};               ///< One per kind of statement, in the order label_kind() lists them.
+    std::chrono::nanoseconds elapsed{};                 ///< The recorded time, without the warmup.
+};
+
+/**
+ * @brief Returns the kind of statement a label names.
+ *
+ * @param label : The label of a generated statement.
+ * @return 'select_all_', 'select_', 'filter_statement', 'conjunction_statement', 'range_statement', 'in_list_statement', 'top_statement' or 'join_statement'.
+ */
+std::wstring_view label_kind(std::wstring_view label);
+
+/**
+ * @brief Replays a statement set against the runners and measures the latencies.
+ *
+ * Workers pull the statements from the supplier in turn, each into a statement of
+ * its own, until the warmup and duration have passed, so the set is never held in
+ * memory as a whole. Latencies are counted per kind of statement rather than per
+ * label, so memory does not grow with the number of distinct labels either. In the
+ * open model a statement is timed from when it was due to start rather than from
+ * when a worker got to it, so a backlog shows up in the latencies instead of hiding
+ * behind them. Throws std::invalid_argument if the set is empty.
+ *
+ * @param next_statement : Supplies the statements to run; only called by one worker at a time.
+ * @param open : Opens the runner of one worker.
+ * @param options : The workers, arrival model, warmup and duration.
+ * @return The latencies per kind.
+ */
+replay_report replay_statements(const statement_supplier& next_statement, const runner_factory& open, const replay_options& options);
+
+#endif // !_REPLAY_H
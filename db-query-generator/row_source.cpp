@@ -0,0 +1,1038 @@
+#include "row_source.h"
+#include "encoding.h"
+#include "hashing.h"
+#include "scheduler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <future>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+
+// --------------------
+// START OF ROW SOURCE FUNCTIONS
+// --------------------
+
+static constexpr uint64_t fnv_offset_basis{ 14695981039346656037ull };
+static constexpr uint64_t fnv_prime{ 1099511628211ull };
+
+static void fnv_append(uint64_t& hash, std::wstring_view text) {
+    for (wchar_t ch : text) {
+        for (size_t byte{}; byte < sizeof(wchar_t); byte++) {
+            hash = (hash ^ ((static_cast<uint32_t>(ch) >> (8 * byte)) & 0xFF)) * fnv_prime;
+        }
+    }
+
+    // Separates 'ab'+'c' from 'a'+'bc'
+    hash = (hash ^ 0xFF) * fnv_prime;
+}
+
+uint64_t fingerprint_tables(const std::vector<std::shared_ptr<table_info>>& tables, const std::vector<foreign_key>& keys) {
+    uint64_t hash{ fnv_offset_basis };
+
+    for (const auto& table : tables) {
+        fnv_append(hash, table->schema);
+        fnv_append(hash, table->name);
+
+        for (const auto& column : table->columns) {
+            fnv_append(hash, column->name);
+            fnv_append(hash, column->data_type);
+            hash = (hash ^ (column->primary_key ? 0x01 : 0x00)) * fnv_prime;
+        }
+
+        // Ends the column list, so a column cannot pass for the next table
+        hash = (hash ^ 0xFE) * fnv_prime;
+    }
+
+    for (const auto& key : keys) {
+        fnv_append(hash, key.schema);
+        fnv_append(hash, key.table);
+        fnv_append(hash, key.referenced_schema);
+        fnv_append(hash, key.referenced_table);
+
+        for (size_t i{}; i < key.columns.size(); i++) {
+            fnv_append(hash, key.columns[i]);
+            fnv_append(hash, key.referenced_columns[i]);
+        }
+
+        hash = (hash ^ 0xFE) * fnv_prime;
+    }
+
+    return hash;
+}
+
+uint64_t row_source::schema_fingerprint() {
+    return fingerprint_tables(load_catalog(), load_foreign_keys());
+}
+
+static bool is_number(std::wstring_view text) {
+    return !text.empty() && std::all_of(text.begin(), text.end(), [](wchar_t ch) { return ch >= L'0' && ch <= L'9'; });
+}
+
+int compare_watermarks(std::wstring_view lhs, std::wstring_view rhs) {
+    // Without leading zeros the longer number is the larger one
+    if (is_number(lhs) && is_number(rhs)) {
+        lhs.remove_prefix(std::min(lhs.find_first_not_of(L'0'), lhs.size() - 1));
+        rhs.remove_prefix(std::min(rhs.find_first_not_of(L'0'), rhs.size() - 1));
+
+        if (lhs.size() != rhs.size()) {
+            return lhs.size() < rhs.size() ? -1 : 1;
+        }
+    }
+
+    return lhs.compare(rhs);
+}
+
+// Only text is known here, so empty fields are NULL; sources that can tell them apart override this
+void row_source::fetch_fields(const table_info& table, const field_callback& on_row) {
+    std::vector<field_value> fields(table.columns.size());
+
+    fetch_rows(table, [&](const std::vector<std::wstring_view>& text) {
+        for (size_t i{}; i < fields.size(); i++) {
+            fields[i] = field_value::text_or_null_field(text[i]);
+        }
+
+        on_row(fields);
+    });
+}
+
+std::wstring row_source::high_water_mark(const table_info& table, size_t column) {
+    std::wstring mark{};
+
+    fetch_rows(table, [&](const std::vector<std::wstring_view>& fields) {
+        if (!fields[column].empty() && (mark.empty() || compare_watermarks(fields[column], mark) > 0)) {
+            mark = fields[column];
+        }
+    });
+
+    return mark;
+}
+
+void row_source::fetch_changed_rows(const table_info& table, size_t column, const std::wstring& after, const std::wstring& up_to, const row_callback& on_row) {
+    fetch_rows(table, [&](const std::vector<std::wstring_view>& fields) {
+        std::wstring_view mark{ fields[column] };
+
+        if ((after.empty() || compare_watermarks(mark, after) > 0) && compare_watermarks(mark, up_to) <= 0) {
+            on_row(fields);
+        }
+    });
+}
+
+uint64_t row_source::sample_rows(const table_info& table, row_sampler& sample) {
+    uint64_t read{};
+
+    fetch_fields(table, [&](const std::vector<field_value>& fields) {
+        sample.offer(fields);
+        read++;
+    });
+
+    return read;
+}
+
+// Fractions aim at this many times the rows to keep, as whole pages are sampled at once
+static constexpr double sample_oversampling{ 4.0 };
+
+// Past this fraction, reading the whole table costs about the same
+static constexpr double sample_fraction_limit{ 25.0 };
+
+uint64_t row_source::sample_fraction(const table_info& table, row_sampler& sample, const fraction_fetcher& fetch_fraction) {
+    const sampler_options& settings{ sample.settings() };
+    double percent{ table.row_estimate ? 100.0 * sample_oversampling * static_cast<double>(settings.rows) / static_cast<double>(table.row_estimate) : 100.0 };
+
+    if (sample.stratified() || percent >= sample_fraction_limit) {
+        return row_source::sample_rows(table, sample);
+    }
+
+    uint64_t read{};
+
+    fetch_fraction(percent, sample.table_seed(), [&](const std::vector<field_value>& fields) {
+        sample.offer(fields);
+        read++;
+    });
+
+    // The number of rows on the sampled pages varies, and outdated estimates make it vary more
+    if (sample.size() < settings.rows) {
+        sample = row_sampler{ table, settings };
+        read += row_source::sample_rows(table, sample);
+    }
+
+    return read;
+}
+
+// --------------------
+// END OF ROW SOURCE FUNCTIONS
+// --------------------
+// --------------------
+// START OF ROW READER FUNCTIONS
+// --------------------
+
+void row_reader::read_rows(const row_callback& on_row) {
+    std::vector<std::wstring_view> fields(column_count);
+
+    while (next()) {
+        for (size_t i{}; i < column_count; i++) {
+            fields[i] = text(i);
+        }
+
+        on_row(fields);
+    }
+}
+
+void row_reader::read_fields(const field_callback& on_row) {
+    std::vector<field_value> fields(column_count);
+
+    while (next()) {
+        for (size_t i{}; i < column_count; i++) {
+            fields[i] = field(i);
+        }
+
+        on_row(fields);
+    }
+}
+
+prefetching_reader::prefetching_reader(row_reader& source, const table_info& table, size_t block_rows) :
+    row_reader(table.columns.size()), source(source), block_rows(std::max<size_t>(block_rows, 1)), digits(table.columns.size()) {
+    reading = std::make_unique<table_info>(table_info{ L"", L"" });
+    reading->copy_layout(table);
+    filling = std::make_unique<table_info>(table_info{ L"", L"" });
+    filling->copy_layout(table);
+    reading->reserve(this->block_rows, 0);
+    filling->reserve(this->block_rows, 0);
+
+    worker = std::thread{ [this]() { fill(); } };
+}
+
+prefetching_reader::~prefetching_reader() {
+    {
+        std::lock_guard lock{ mutex };
+        stopping = true;
+    }
+
+    changed.notify_all();
+    worker.join();
+}
+
+// Runs on the worker: fills a block, hands it over, and waits for the block the caller is done with
+void prefetching_reader::fill() {
+    for (;;) {
+        bool more{ true };
+
+        try {
+            filling->clear_rows();
+
+            while (filling->row_count() < block_rows && !stopping && (more = source.next())) {
+                for (size_t i{}; i < column_count; i++) {
+                    filling->add_field(i, source.field(i));
+                }
+
+                filling->finish_row();
+            }
+        }
+        catch (...) {
+            error = std::current_exception();
+            more = false;
+        }
+
+        std::unique_lock lock{ mutex };
+        filled = true;
+        done = !more;
+        changed.notify_all();
+
+        if (done) {
+            return;
+        }
+
+        changed.wait(lock, [&]() { return !filled || stopping; });
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+bool prefetching_reader::next() {
+    if (row + 1 < reading->row_count()) {
+        row++;
+        return true;
+    }
+
+    if (last_block) {
+        return false;
+    }
+
+    {
+        std::unique_lock lock{ mutex };
+        changed.wait(lock, [&]() { return filled; });
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+
+        std::swap(reading, filling);
+        last_block = done;
+        filled = false;
+    }
+
+    changed.notify_all();
+
+    // The worker's blocks are only short once the rows run out
+    row = 0;
+    return reading->row_count() > 0;
+}
+
+// --------------------
+// END OF ROW READER FUNCTIONS
+// --------------------
+// --------------------
+// START OF SQLAPI SOURCE FUNCTIONS
+// --------------------
+
+sqlapi_source::sqlapi_source(const std::wstring& connection_string, fetch_options fetching) :
+    fetching(fetching) {
+    conn.Connect(connection_string.c_str(), L"", L"", SA_SQLServer_Client);
+}
+
+sqlapi_source::~sqlapi_source() {
+    try {
+        conn.Disconnect();
+    }
+    catch (SAException&) {
+        // Nothing sensible to do while tearing down
+    }
+}
+
+// One round trip for the whole catalog; joining on the schema keeps same-named tables apart
+std::vector<std::shared_ptr<table_info>> sqlapi_source::load_catalog() {
+    std::vector<std::shared_ptr<table_info>> tables{};
+
+    SACommand cmd{ &conn,
+        L"SELECT t.TABLE_SCHEMA, t.TABLE_NAME, c.COLUMN_NAME, c.DATA_TYPE, c.ORDINAL_POSITION, "
+        L"CASE WHEN k.COLUMN_NAME IS NULL THEN 0 ELSE 1 END AS IS_PRIMARY_KEY "
+        L"FROM INFORMATION_SCHEMA.TABLES t "
+        L"LEFT JOIN INFORMATION_SCHEMA.COLUMNS c "
+        L"ON c.TABLE_CATALOG = t.TABLE_CATALOG AND c.TABLE_SCHEMA = t.TABLE_SCHEMA AND c.TABLE_NAME = t.TABLE_NAME "
+        L"LEFT JOIN INFORMATION_SCHEMA.TABLE_CONSTRAINTS p "
+        L"ON p.TABLE_SCHEMA = t.TABLE_SCHEMA AND p.TABLE_NAME = t.TABLE_NAME AND p.CONSTRAINT_TYPE = 'PRIMARY KEY' "
+        L"LEFT JOIN INFORMATION_SCHEMA.KEY_COLUMN_USAGE k "
+        L"ON k.CONSTRAINT_SCHEMA = p.CONSTRAINT_SCHEMA AND k.CONSTRAINT_NAME = p.CONSTRAINT_NAME AND k.COLUMN_NAME = c.COLUMN_NAME "
+        L"WHERE t.TABLE_TYPE = 'BASE TABLE' AND t.TABLE_CATALOG='AdventureWorks2022' "
+        L"ORDER BY t.TABLE_SCHEMA, t.TABLE_NAME, c.ORDINAL_POSITION;" };
+
+    cmd.Execute();
+    while (cmd.FetchNext()) {
+        std::wstring table_schema{ cmd.Field(L"TABLE_SCHEMA").asString().GetWideChars() };
+        std::wstring table_name{ cmd.Field(L"TABLE_NAME").asString().GetWideChars() };
+
+        // Rows arrive grouped by table, so a new table starts whenever the name changes
+        if (tables.empty() || tables.back()->schema != table_schema || tables.back()->name != table_name) {
+            tables.emplace_back(std::make_shared<table_info>(table_info{ table_name, table_schema }));
+        }
+
+        // Tables without columns come back once with NULL columns
+        if (cmd.Field(L"COLUMN_NAME").isNull()) {
+            continue;
+        }
+
+        std::wstring column_name{ cmd.Field(L"COLUMN_NAME").asString().GetWideChars() };
+        std::wstring data_type{ cmd.Field(L"DATA_TYPE").asString().GetWideChars() };
+
+        tables.back()->columns.emplace_back(std::make_shared<column_info>(column_info{ column_name, data_type }));
+        tables.back()->columns.back()->ordinal = static_cast<int>(cmd.Field(L"ORDINAL_POSITION").asLong());
+        tables.back()->columns.back()->primary_key = cmd.Field(L"IS_PRIMARY_KEY").asLong() != 0;
+    }
+
+    return tables;
+}
+
+// Pairs the columns of every key with those of the constraint it references by position; keys
+// referencing a unique index rather than a constraint have no key columns listed and are left out
+std::vector<foreign_key> sqlapi_source::load_foreign_keys() {
+    std::vector<foreign_key> keys{};
+
+    SACommand cmd{ &conn,
+        L"SELECT rc.CONSTRAINT_SCHEMA, rc.CONSTRAINT_NAME, f.TABLE_SCHEMA, f.TABLE_NAME, f.COLUMN_NAME, "
+        L"r.TABLE_SCHEMA AS REFERENCED_SCHEMA, r.TABLE_NAME AS REFERENCED_TABLE, r.COLUMN_NAME AS REFERENCED_COLUMN "
+        L"FROM INFORMATION_SCHEMA.REFERENTIAL_CONSTRAINTS rc "
+        L"JOIN INFORMATION_SCHEMA.KEY_COLUMN_USAGE f "
+        L"ON f.CONSTRAINT_SCHEMA = rc.CONSTRAINT_SCHEMA AND f.CONSTRAINT_NAME = rc.CONSTRAINT_NAME "
+        L"JOIN INFORMATION_SCHEMA.KEY_COLUMN_USAGE r "
+        L"ON r.CONSTRAINT_SCHEMA = rc.UNIQUE_CONSTRAINT_SCHEMA AND r.CONSTRAINT_NAME = rc.UNIQUE_CONSTRAINT_NAME AND r.ORDINAL_POSITION = f.ORDINAL_POSITION "
+        L"WHERE rc.CONSTRAINT_CATALOG='AdventureWorks2022' "
+        L"ORDER BY rc.CONSTRAINT_SCHEMA, rc.CONSTRAINT_NAME, f.ORDINAL_POSITION;" };
+
+    std::wstring key_schema{};
+
+    cmd.Execute();
+    while (cmd.FetchNext()) {
+        std::wstring constraint_schema{ cmd.Field(L"CONSTRAINT_SCHEMA").asString().GetWideChars() };
+        std::wstring constraint_name{ cmd.Field(L"CONSTRAINT_NAME").asString().GetWideChars() };
+
+        // Rows arrive grouped by constraint, so a new key starts whenever the name changes
+        if (keys.empty() || key_schema != constraint_schema || keys.back().name != constraint_name) {
+            key_schema = constraint_schema;
+            keys.emplace_back(foreign_key{ constraint_name,
+                cmd.Field(L"TABLE_SCHEMA").asString().GetWideChars(), cmd.Field(L"TABLE_NAME").asString().GetWideChars(),
+                cmd.Field(L"REFERENCED_SCHEMA").asString().GetWideChars(), cmd.Field(L"REFERENCED_TABLE").asString().GetWideChars() });
+        }
+
+        keys.back().columns.emplace_back(cmd.Field(L"COLUMN_NAME").asString().GetWideChars());
+        keys.back().referenced_columns.emplace_back(cmd.Field(L"REFERENCED_COLUMN").asString().GetWideChars());
+    }
+
+    return keys;
+}
+
+void sqlapi_source::estimate_rows(const std::vector<std::shared_ptr<table_info>>& tables) {
+    std::unordered_map<std::wstring, std::shared_ptr<table_info>> index{};
+
+    for (const auto& table : tables) {
+        index.emplace(table->schema + L'.' + table->name, table);
+    }
+
+    // Partition metadata is maintained by the server, so this is one cheap query for every table
+    SACommand cmd{ &conn,
+        L"SELECT s.name AS TABLE_SCHEMA, t.name AS TABLE_NAME, SUM(p.rows) AS ROW_ESTIMATE "
+        L"FROM sys.tables t "
+        L"JOIN sys.schemas s ON s.schema_id = t.schema_id "
+        L"JOIN sys.partitions p ON p.object_id = t.object_id AND p.index_id IN (0, 1) "
+        L"GROUP BY s.name, t.name;" };
+
+    cmd.Execute();
+    while (cmd.FetchNext()) {
+        std::wstring table_schema{ cmd.Field(L"TABLE_SCHEMA").asString().GetWideChars() };
+        std::wstring table_name{ cmd.Field(L"TABLE_NAME").asString().GetWideChars() };
+
+        auto found{ index.find(table_schema + L'.' + table_name) };
+
+        if (found != index.end()) {
+            found->second->row_estimate = static_cast<size_t>(cmd.Field(L"ROW_ESTIMATE").asInt64());
+        }
+    }
+}
+
+// A single aggregate row instead of the whole catalog; changes with any table, column, type or position,
+// and with any primary key or foreign key, which incremental merges and the join graph depend on
+uint64_t sqlapi_source::schema_fingerprint() {
+    SACommand cmd{ &conn,
+        L"SELECT COUNT_BIG(*) AS COLUMN_COUNT, "
+        L"CHECKSUM_AGG(CHECKSUM(t.TABLE_SCHEMA, t.TABLE_NAME, c.COLUMN_NAME, c.DATA_TYPE, c.ORDINAL_POSITION)) AS SCHEMA_CHECKSUM, "
+        L"(SELECT CHECKSUM_AGG(CHECKSUM(i.object_id, i.name, ic.key_ordinal, ic.column_id)) "
+        L"FROM sys.indexes i "
+        L"JOIN sys.tables pt ON pt.object_id = i.object_id "
+        L"JOIN sys.index_columns ic ON ic.object_id = i.object_id AND ic.index_id = i.index_id "
+        L"WHERE i.is_primary_key = 1) AS PRIMARY_KEY_CHECKSUM, "
+        L"(SELECT CHECKSUM_AGG(CHECKSUM(fk.constraint_object_id, fk.constraint_column_id, fk.parent_object_id, fk.parent_column_id, fk.referenced_object_id, fk.referenced_column_id)) "
+        L"FROM sys.foreign_key_columns fk) AS FOREIGN_KEY_CHECKSUM "
+        L"FROM INFORMATION_SCHEMA.TABLES t "
+        L"LEFT JOIN INFORMATION_SCHEMA.COLUMNS c "
+        L"ON c.TABLE_CATALOG = t.TABLE_CATALOG AND c.TABLE_SCHEMA = t.TABLE_SCHEMA AND c.TABLE_NAME = t.TABLE_NAME "
+        L"WHERE t.TABLE_TYPE = 'BASE TABLE' AND t.TABLE_CATALOG='AdventureWorks2022';" };
+
+    cmd.Execute();
+    if (!cmd.FetchNext()) {
+        return 0;
+    }
+
+    auto checksum = [&](const wchar_t* name) {
+        return cmd.Field(name).isNull() ? 0u : static_cast<uint32_t>(cmd.Field(name).asLong());
+    };
+
+    uint64_t column_count{ static_cast<uint64_t>(cmd.Field(L"COLUMN_COUNT").asInt64()) };
+    uint64_t keys{ uint64_t{ checksum(L"PRIMARY_KEY_CHECKSUM") } << 32 | checksum(L"FOREIGN_KEY_CHECKSUM") };
+
+    // The key checksums are mixed in, so a change to them cannot cancel out one to the columns
+    return (column_count << 32 | checksum(L"SCHEMA_CHECKSUM")) ^ mix_bits(keys);
+}
+
+// Reads the result of an executed query through the ordinals of the table's columns, resolved once
+class sqlapi_reader : public row_reader {
+    SACommand& cmd;
+    const table_info& table;
+    std::vector<int> ordinals{};    ///< The 1-based position in the result set of every column of the table.
+    std::vector<SAString> values{}; ///< The text of the current row, per column.
+
+public:
+
+    sqlapi_reader(SACommand& cmd, const table_info& table) :
+        row_reader(table.columns.size()), cmd(cmd), table(table), ordinals(table.columns.size()), values(table.columns.size()) {
+        std::unordered_map<std::wstring, int> positions{};
+
+        for (int i{ 1 }; i <= cmd.FieldCount(); i++) {
+            positions.emplace(cmd.Field(i).Name().GetWideChars(), i);
+        }
+
+        for (size_t i{}; i < table.columns.size(); i++) {
+            auto found{ positions.find(table.columns[i]->name) };
+            if (found == positions.end()) {
+                throw std::runtime_error{ "Column " + wide_to_utf8(table.columns[i]->name) + " is missing from the rows of "
+                    + wide_to_utf8(table.schema + L'.' + table.name) };
+            }
+
+            ordinals[i] = found->second;
+        }
+    }
+
+    bool next() override { return cmd.FetchNext(); }
+
+    // Numbers are read as numbers, so only text goes through asString()
+    //
+    // 'real' is single precision, so its double has more digits than the text the driver
+    // gives, and 'bit' is a boolean to the driver; both are read as text, which the store
+    // keeps as a number when formatting the number gives the same text back.
+    field_value field(size_t column) override {
+        const data_type_info& type{ *table.columns[column]->type };
+        SAField& field{ cmd.Field(ordinals[column]) };
+
+        if (field.isNull()) {
+            return field_value::null_field();
+        }
+
+        if (type.type == data_types::aprx_real || type.type == data_types::ext_bit) {
+            return field_value::text_field(text(column));
+        }
+
+        switch (type.storage) {
+        case value_storage::integer:
+            return field_value::integer_field(field.asInt64());
+        case value_storage::real:
+            return field_value::real_field(field.asDouble());
+        default:
+            return field_value::text_field(text(column));
+        }
+    }
+
+    std::wstring_view text(size_t column) override {
+        values[column] = cmd.Field(ordinals[column]).asString();
+        return values[column].GetWideChars();
+    }
+};
+
+// Runs a query returning rows of a table, with the driver fetching them an array at a time
+void sqlapi_source::execute(SACommand& cmd) {
+    cmd.setOption(L"PreFetchRows") = std::to_wstring(std::max<size_t>(fetching.prefetch_rows, 1)).c_str();
+    cmd.Execute();
+}
+
+// Hands the rows of an executed query to 'consume', decoded a block ahead unless that is turned off
+void sqlapi_source::read(SACommand& cmd, const table_info& table, const std::function<void(row_reader& reader)>& consume) {
+    sqlapi_reader reader{ cmd, table };
+
+    if (!fetching.block_rows) {
+        consume(reader);
+        return;
+    }
+
+    prefetching_reader ahead{ reader, table, fetching.block_rows };
+    consume(ahead);
+}
+
+void sqlapi_source::fetch_rows(const table_info& table, const row_callback& on_row) {
+    SACommand cmd{ &conn, std::wstring(L"SELECT * FROM " + table.schema + L"." + table.name).c_str() };
+    execute(cmd);
+
+    read(cmd, table, [&](row_reader& reader) { reader.read_rows(on_row); });
+}
+
+void sqlapi_source::fetch_fields(const table_info& table, const field_callback& on_row) {
+    SACommand cmd{ &conn, std::wstring(L"SELECT * FROM " + table.schema + L"." + table.name).c_str() };
+    execute(cmd);
+
+    read(cmd, table, [&](row_reader& reader) { reader.read_fields(on_row); });
+}
+
+// rowversion columns are reported as 'timestamp' and compared as BIGINT; dates go through ISO 8601 text
+static bool is_rowversion(const column_info& column) {
+    return column.data_type == L"timestamp" || column.data_type == L"rowversion";
+}
+
+std::wstring sqlapi_source::high_water_mark(const table_info& table, size_t column) {
+    const column_info& mark_column{ *table.columns[column] };
+    std::wstring expression{ is_rowversion(mark_column)
+        ? L"CONVERT(NVARCHAR(20), CONVERT(BIGINT, MAX(" + mark_column.name + L")))"
+        : L"CONVERT(NVARCHAR(33), MAX(" + mark_column.name + L"), 126)" };
+
+    SACommand cmd{ &conn, std::wstring(L"SELECT " + expression + L" AS HIGH_WATER_MARK FROM " + table.schema + L"." + table.name + L";").c_str() };
+    cmd.Execute();
+
+    if (!cmd.FetchNext() || cmd.Field(L"HIGH_WATER_MARK").isNull()) {
+        return {};
+    }
+
+    return cmd.Field(L"HIGH_WATER_MARK").asString().GetWideChars();
+}
+
+// Turns a mark bound as text back into a value of the column's type
+static std::wstring mark_parameter(const column_info& column, const std::wstring& parameter) {
+    return is_rowversion(column)
+        ? L"CONVERT(BINARY(8), CONVERT(BIGINT, " + parameter + L"))"
+        : L"CONVERT(DATETIME2, " + parameter + L", 126)";
+}
+
+// Filtered on the server, so only changed rows cross the network
+void sqlapi_source::fetch_changed_rows(const table_info& table, size_t column, const std::wstring& after, const std::wstring& up_to, const row_callback& on_row) {
+    const column_info& mark_column{ *table.columns[column] };
+
+    std::wstring query{ L"SELECT * FROM " + table.schema + L"." + table.name + L" WHERE " + mark_column.name + L" <= " + mark_parameter(mark_column, L":1") };
+    if (!after.empty()) {
+        query += L" AND " + mark_column.name + L" > " + mark_parameter(mark_column, L":2");
+    }
+
+    SACommand cmd{ &conn, query.c_str() };
+    cmd.Param(1).setAsString() = up_to.c_str();
+    if (!after.empty()) {
+        cmd.Param(2).setAsString() = after.c_str();
+    }
+
+    execute(cmd);
+
+    read(cmd, table, [&](row_reader& reader) { reader.read_rows(on_row); });
+}
+
+// Sampled on the server, so only the rows of the sampled pages cross the network
+uint64_t sqlapi_source::sample_rows(const table_info& table, row_sampler& sample) {
+    return sample_fraction(table, sample, [&](double percent, uint64_t seed, const field_callback& on_row) {
+        std::wstring query{ L"SELECT * FROM " + table.schema + L"." + table.name
+            + L" TABLESAMPLE (" + std::to_wstring(percent) + L" PERCENT) REPEATABLE (" + std::to_wstring(seed & INT64_MAX) + L");" };
+
+        SACommand cmd{ &conn, query.c_str() };
+        execute(cmd);
+
+        read(cmd, table, [&](row_reader& reader) { reader.read_fields(on_row); });
+    });
+}
+
+// --------------------
+// END OF SQLAPI SOURCE FUNCTIONS
+// --------------------
+// --------------------
+// START OF CSV SOURCE FUNCTIONS
+// --------------------
+
+// Reads one RFC 4180 record; returns false once the stream is exhausted
+static bool read_record(std::istream& in, std::vector<std::string>& record) {
+    record.clear();
+
+    std::string field{};
+    bool quoted{}, any{};
+    int ch{};
+
+    while ((ch = in.get()) != std::char_traits<char>::eof()) {
+        any = true;
+
+        if (quoted) {
+            if (ch == '"') {
+                if (in.peek() == '"') {
+                    field.push_back('"');
+                    in.get();
+                }
+                else {
+                    quoted = false;
+                }
+            }
+            else {
+                field.push_back(static_cast<char>(ch));
+            }
+            continue;
+        }
+
+        if (ch == '"') {
+            quoted = true;
+        }
+        else if (ch == ',') {
+            record.emplace_back(std::move(field));
+            field.clear();
+        }
+        else if (ch == '\n') {
+            break;
+        }
+        else if (ch != '\r') {
+            field.push_back(static_cast<char>(ch));
+        }
+    }
+
+    if (!any) {
+        return false;
+    }
+
+    record.emplace_back(std::move(field));
+    return true;
+}
+
+csv_source::csv_source(std::filesystem::path directory) :
+    directory(std::move(directory)) {
+    if (!std::filesystem::is_directory(this->directory)) {
+        throw std::runtime_error{ "CSV source is not a directory: " + this->directory.string() };
+    }
+}
+
+std::filesystem::path csv_source::table_path(const table_info& table) const {
+    return directory / (table.schema + L'.' + table.name + L".csv");
+}
+
+std::vector<std::string> csv_source::read_header(const table_info& table) const {
+    std::ifstream file{ table_path(table), std::ios::binary };
+    std::vector<std::string> header{};
+
+    if (!file.is_open() || !read_record(file, header)) {
+        throw std::runtime_error{ "Unable to read CSV header: " + table_path(table).string() };
+    }
+
+    return header;
+}
+
+// Splits the ':ref=<schema>.<table>.<column>' suffix off a header cell, returning the reference or an empty view
+static std::string_view split_reference(std::string_view& cell) {
+    size_t split{ cell.find(":ref=") };
+    if (split == std::string_view::npos) {
+        return {};
+    }
+
+    std::string_view reference{ cell.substr(split + 5) };
+    cell = cell.substr(0, split);
+    return reference;
+}
+
+std::vector<std::shared_ptr<table_info>> csv_source::load_catalog() {
+    std::vector<std::shared_ptr<table_info>> tables{};
+
+    for (const auto& entry : std::filesystem::directory_iterator{ directory }) {
+        if (!entry.is_regular_file() || entry.path().extension() != L".csv") {
+            continue;
+        }
+
+        std::wstring stem{ entry.path().stem().wstring() };
+        size_t split{ stem.find(L'.') };
+
+        if (split == std::wstring::npos) {
+            continue;
+        }
+
+        tables.emplace_back(std::make_shared<table_info>(table_info{ stem.substr(split + 1), stem.substr(0, split) }));
+    }
+
+    // Directory order is unspecified; keep runs reproducible
+    std::sort(tables.begin(), tables.end(), [](const auto& lhs, const auto& rhs) {
+        return std::tie(lhs->schema, lhs->name) < std::tie(rhs->schema, rhs->name);
+    });
+
+    for (const auto& table : tables) {
+        for (std::string_view cell : read_header(*table)) {
+            split_reference(cell);
+
+            bool primary_key{ cell.size() > 3 && cell.substr(cell.size() - 3) == ":pk" };
+            if (primary_key) {
+                cell.remove_suffix(3);
+            }
+
+            size_t split{ cell.rfind(':') };
+            std::wstring column_name{ utf8_to_wide(cell.substr(0, split)) };
+            std::wstring data_type{ split == std::string::npos ? L"nvarchar" : utf8_to_wide(cell.substr(split + 1)) };
+
+            table->columns.emplace_back(std::make_shared<column_info>(column_info{ column_name, data_type }));
+            table->columns.back()->ordinal = static_cast<int>(table->columns.size());
+            table->columns.back()->primary_key = primary_key;
+        }
+    }
+
+    return tables;
+}
+
+// Every referencing column is a key of its own, named after its table and column
+std::vector<foreign_key> csv_source::load_foreign_keys() {
+    std::vector<foreign_key> keys{};
+
+    for (const auto& table : load_catalog()) {
+        std::vector<std::string> header{ read_header(*table) };
+
+        for (size_t i{}; i < header.size(); i++) {
+            std::string_view cell{ header[i] };
+            std::string_view reference{ split_reference(cell) };
+
+            size_t column_split{ reference.rfind('.') };
+            size_t table_split{ column_split == std::string_view::npos ? std::string_view::npos : reference.rfind('.', column_split - 1) };
+
+            if (table_split == std::string_view::npos || table_split == 0) {
+                continue;
+            }
+
+            const std::wstring& column{ table->columns[i]->name };
+
+            keys.emplace_back(foreign_key{ L"FK_" + table->name + L'_' + column, table->schema, table->name,
+                utf8_to_wide(reference.substr(0, table_split)), utf8_to_wide(reference.substr(table_split + 1, column_split - table_split - 1)),
+                { column }, { utf8_to_wide(reference.substr(column_split + 1)) } });
+        }
+    }
+
+    return keys;
+}
+
+// Without an index the file size is the cheapest stand-in for the row count
+void csv_source::estimate_rows(const std::vector<std::shared_ptr<table_info>>& tables) {
+    for (const auto& table : tables) {
+        std::error_code error{};
+        uintmax_t bytes{ std::filesystem::file_size(table_path(*table), error) };
+
+        table->row_estimate = error ? 0 : static_cast<size_t>(bytes);
+    }
+}
+
+void csv_source::fetch_rows(const table_info& table, const row_callback& on_row) {
+    std::ifstream file{ table_path(table), std::ios::binary };
+    std::vector<std::string> record{};
+
+    // Skip the header
+    if (!file.is_open() || !read_record(file, record)) {
+        throw std::runtime_error{ "Unable to read CSV file: " + table_path(table).string() };
+    }
+
+    std::vector<std::wstring> values(table.columns.size());
+    std::vector<std::wstring_view> fields(table.columns.size());
+
+    while (read_record(file, record)) {
+        // Short records are padded with empty fields, extra fields are ignored
+        for (size_t i{}; i < table.columns.size(); i++) {
+            values[i] = i < record.size() ? utf8_to_wide(record[i]) : std::wstring{};
+            fields[i] = values[i];
+        }
+
+        on_row(fields);
+    }
+}
+
+// --------------------
+// END OF CSV SOURCE FUNCTIONS
+// --------------------
+// --------------------
+// START OF SNAPSHOT SOURCE FUNCTIONS
+// --------------------
+
+snapshot_source::snapshot_source(std::shared_ptr<const snapshot> data) :
+    data(std::move(data)) {
+    const auto& tables{ this->data->tables() };
+    index.reserve(tables.size());
+
+    for (size_t i{}; i < tables.size(); i++) {
+        index.emplace(utf8_to_wide(tables[i].schema) + L'.' + utf8_to_wide(tables[i].name), i);
+    }
+}
+
+size_t snapshot_source::find(const table_info& table) const {
+    auto found{ index.find(table.schema + L'.' + table.name) };
+
+    if (found == index.end()) {
+        throw std::runtime_error{ "Unknown table: " + wide_to_utf8(table.schema + L'.' + table.name) };
+    }
+
+    return found->second;
+}
+
+std::vector<std::shared_ptr<table_info>> snapshot_source::load_catalog() {
+    std::vector<std::shared_ptr<table_info>> tables{};
+
+    for (const auto& stored : data->tables()) {
+        tables.emplace_back(std::make_shared<table_info>(table_info{ utf8_to_wide(stored.name), utf8_to_wide(stored.schema) }));
+
+        for (const auto& column : stored.columns) {
+            tables.back()->columns.emplace_back(std::make_shared<column_info>(column_info{ utf8_to_wide(column.name), utf8_to_wide(column.data_type) }));
+            tables.back()->columns.back()->ordinal = static_cast<int>(tables.back()->columns.size());
+        }
+    }
+
+    return tables;
+}
+
+// Snapshots record the exact row counts
+void snapshot_source::estimate_rows(const std::vector<std::shared_ptr<table_info>>& tables) {
+    for (const auto& table : tables) {
+        table->row_estimate = static_cast<size_t>(data->tables()[find(*table)].row_count);
+    }
+}
+
+void snapshot_source::fetch_rows(const table_info& table, const row_callback& on_row) {
+    std::vector<std::wstring> values(table.columns.size());
+    std::vector<std::wstring_view> fields(table.columns.size());
+
+    data->for_each_row(find(table), [&](const std::vector<std::string_view>& row) {
+        for (size_t i{}; i < fields.size(); i++) {
+            values[i].clear();
+
+            if (i < row.size()) {
+                append_wide(values[i], row[i]);
+            }
+
+            fields[i] = values[i];
+        }
+
+        on_row(fields);
+    });
+}
+
+// --------------------
+// END OF SNAPSHOT SOURCE FUNCTIONS
+// --------------------
+// --------------------
+// START OF MEMORY SOURCE FUNCTIONS
+// --------------------
+
+memory_source::memory_source(std::shared_ptr<const std::vector<std::shared_ptr<table_info>>> tables, std::chrono::microseconds latency) :
+    tables(std::move(tables)), latency(latency) {}
+
+const table_info& memory_source::find(const table_info& table) const {
+    for (const auto& candidate : *tables) {
+        if (candidate->schema == table.schema && candidate->name == table.name) {
+            return *candidate;
+        }
+    }
+
+    throw std::runtime_error{ "Unknown table: " + wide_to_utf8(table.schema + L'.' + table.name) };
+}
+
+void memory_source::round_trip() const {
+    if (latency.count() > 0) {
+        std::this_thread::sleep_for(latency);
+    }
+}
+
+std::vector<std::shared_ptr<table_info>> memory_source::load_catalog() {
+    round_trip();
+
+    std::vector<std::shared_ptr<table_info>> result{};
+
+    for (const auto& table : *tables) {
+        result.emplace_back(std::make_shared<table_info>(table_info{ L"", L"" }));
+        result.back()->copy_layout(*table);
+    }
+
+    return result;
+}
+
+void memory_source::estimate_rows(const std::vector<std::shared_ptr<table_info>>& tables) {
+    round_trip();
+
+    for (const auto& table : tables) {
+        table->row_estimate = find(*table).row_count();
+    }
+}
+
+// Reads the rows of a stored table, matching its columns to those of the requested table by name once, as a database reader would
+class stored_table_reader : public row_reader {
+    const table_info& stored;
+    std::vector<size_t> ordinals{};             ///< The index in the stored table of every requested column.
+    std::vector<number_buffer> digits{};
+    size_t row{ SIZE_MAX };
+
+public:
+
+    stored_table_reader(const table_info& stored, const table_info& table) :
+        row_reader(table.columns.size()), stored(stored), ordinals(table.columns.size()), digits(table.columns.size()) {
+        for (size_t i{}; i < table.columns.size(); i++) {
+            auto found{ std::find_if(stored.columns.begin(), stored.columns.end(), [&](const auto& column) { return column->name == table.columns[i]->name; }) };
+            if (found == stored.columns.end()) {
+                throw std::runtime_error{ "Column " + wide_to_utf8(table.columns[i]->name) + " is missing from the rows of "
+                    + wide_to_utf8(table.schema + L'.' + table.name) };
+            }
+
+            ordinals[i] = static_cast<size_t>(found - stored.columns.begin());
+        }
+    }
+
+    // Moves before a row, so that next() reads it; wraps to SIZE_MAX for the first row
+    void seek(size_t first) { row = first - 1; }
+
+    bool next() override { return ++row < stored.row_count(); }
+    field_value field(size_t column) override { return stored.field(row, ordinals[column]); }
+    std::wstring_view text(size_t column) override { return stored.value(row, ordinals[column], digits[column]); }
+};
+
+void memory_source::fetch_rows(const table_info& table, const row_callback& on_row) {
+    round_trip();
+
+    stored_table_reader{ find(table), table }.read_rows(on_row);
+}
+
+void memory_source::fetch_fields(const table_info& table, const field_callback& on_row) {
+    round_trip();
+
+    stored_table_reader{ find(table), table }.read_fields(on_row);
+}
+
+// The rows sampled together, like the rows of a data page
+static constexpr size_t emulated_page_rows{ 64 };
+
+// Keeps or skips whole pages, as TABLESAMPLE does
+uint64_t memory_source::sample_rows(const table_info& table, row_sampler& sample) {
+    return sample_fraction(table, sample, [&](double percent, uint64_t seed, const field_callback& on_row) {
+        round_trip();
+
+        // Fields follow the columns of the requested table, like those of every other read
+        const table_info& stored{ find(table) };
+        stored_table_reader reader{ stored, table };
+        std::mt19937_64 random{ seed };
+        std::vector<field_value> fields(table.columns.size());
+
+        for (size_t first{}; first < stored.row_count(); first += emulated_page_rows) {
+            if (static_cast<double>(random() >> 11) * 0x1p-53 * 100.0 >= percent) {
+                continue;
+            }
+
+            reader.seek(first);
+
+            for (size_t row{ first }; row < first + emulated_page_rows && reader.next(); row++) {
+                for (size_t i{}; i < fields.size(); i++) {
+                    fields[i] = reader.field(i);
+                }
+
+                on_row(fields);
+            }
+        }
+    });
+}
+
+// --------------------
+// END OF MEMORY SOURCE FUNCTIONS
+// --------------------
+// --------------------
+// START OF SOURCE POOL FUNCTIONS
+// --------------------
+
+source_pool::source_pool(size_t size, const source_factory& open) {
+    std::vector<std::future<std::unique_ptr<row_source>>> pending{};
+
+    // Connecting is mostly waiting on the server, so open every connection at once
+    for (size_t i{}; i < (size ? size : 1); i++) {
+        pending.emplace_back(std::async(std::launch::async, open));
+    }
+
+    for (auto& source : pending) {
+        sources.emplace_back(source.get());
+    }
+}
+
+table_samples sample_tables(source_pool& sources, const std::vector<std::shared_ptr<table_info>>& tables, const sampler_options& options) {
+    table_samples result{};
+
+    for (const auto& table : tables) {
+        result.samples.emplace_back(std::make_unique<row_sampler>(*table, options));
+    }
+
+    // The largest tables first, so they do not start last and hold up the end
+    std::vector<size_t> order(tables.size());
+    std::iota(order.begin(), order.end(), size_t{});
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return tables[a]->row_estimate > tables[b]->row_estimate; });
+
+    std::vector<uint64_t> read(sources.size());
+
+    work_stealing_scheduler{ sources.size() }.run(order, [&](size_t worker, size_t table) {
+        read[worker] += sources[worker].sample_rows(*tables[table], *result.samples[table]);
+    });
+
+    result.rows_read = std::accumulate(read.begin(), read.end(), uint64_t{});
+    return result;
+}
+
+// --------------------
+// END OF SOURCE POOL FUNCTIONS
+// --------------------
@@ -0,0 +1,414 @@
+#ifndef _ROW_SOURCE_H
+#define _ROW_SOURCE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <SQLAPI.h>
+
+#include "parser.h"
+#include "sampler.h"
+#include "table_store.h"
+
+/* Type Definitions
+************************************************************************/
+
+// Receives the fields of a single row, in the order of table_info::columns
+using row_callback = std::function<void(const std::vector<std::wstring_view>& fields)>;
+
+// Receives the fields of a single row as the source holds them, numbers as numbers
+using field_callback = std::function<void(const std::vector<field_value>& fields)>;
+
+/**
+ * @class row_reader
+ * @brief Reads a result set row by row, addressing fields by the index of their column in the table.
+ *
+ * Implementations match the columns of the table to the result set once, when they
+ * are created, so reading a field is an index rather than a lookup by name.
+ */
+class row_reader {
+protected:
+    size_t column_count{};
+
+public:
+
+    /**
+     * @param column_count : The number of columns of the table being read.
+     */
+    explicit row_reader(size_t column_count) : column_count(column_count) {}
+    virtual ~row_reader() = default;
+
+    /**
+     * @brief Moves to the next row.
+     *
+     * @return False once every row was read.
+     */
+    virtual bool next() = 0;
+
+    /**
+     * @brief Returns a field of the current row without turning numbers into text.
+     *
+     * @param column : The index of the column in the table.
+     * @return The field; its text is valid until the next call for the same column or next().
+     */
+    virtual field_value field(size_t column) = 0;
+
+    /**
+     * @brief Returns a field of the current row as text.
+     *
+     * @param column : The index of the column in the table.
+     * @return The text, valid until the next call for the same column or next().
+     */
+    virtual std::wstring_view text(size_t column) = 0;
+
+    /**
+     * @brief Streams every remaining row as text.
+     *
+     * @param on_row : Called once per row; the field views are only valid during the call.
+     */
+    void read_rows(const row_callback& on_row);
+
+    /**
+     * @brief Streams every remaining row with numbers as numbers.
+     *
+     * @param on_row : Called once per row; the fields are only valid during the call.
+     */
+    void read_fields(const field_callback& on_row);
+};
+
+/**
+ * @class prefetching_reader
+ * @brief Reads another reader a block of rows ahead on a thread of its own, so fetching overlaps decoding.
+ *
+ * The thread fills one block while the caller reads the other, then they swap. The
+ * other reader is only used by that thread until this reader is destroyed, and an
+ * exception it throws is rethrown by next().
+ */
+class prefetching_reader : public row_reader {
+    row_reader& source;
+    size_t block_rows{};
+    std::unique_ptr<table_info> reading{}, filling{};
+    std::vector<number_buffer> digits{};
+    size_t row{};
+    bool last_block{};                  ///< Whether 'reading' is the last block.
+
+    std::mutex mutex{};
+    std::condition_variable changed{};
+    bool filled{};                      ///< Whether 'filling' is ready to be swapped in.
+    bool done{};                        ///< Whether 'filling' is the last block.
+    std::atomic<bool> stopping{};
+    std::exception_ptr error{};
+    std::thread worker{};               ///< Declared last, so it starts once everything it uses exists.
+
+    void fill();
+
+public:
+
+    /**
+     * @param source : The reader to read ahead; not used by the caller until this reader is destroyed.
+     * @param table : The table being read, for the layout of the blocks.
+     * @param block_rows : The number of rows per block.
+     */
+    prefetching_reader(row_reader& source, const table_info& table, size_t block_rows);
+    ~prefetching_reader() override;
+
+    prefetching_reader(const prefetching_reader&) = delete;
+    prefetching_reader& operator=(const prefetching_reader&) = delete;
+
+    bool next() override;
+    field_value field(size_t column) override { return reading->field(row, column); }
+    std::wstring_view text(size_t column) override { return reading->value(row, column, digits[column]); }
+};
+
+// How the SQLAPI++ source fetches the rows of a table
+struct fetch_options {
+    size_t prefetch_rows{ 1000 };   ///< Rows the driver fetches per round trip; 1 fetches row by row.
+    size_t block_rows{ 4096 };      ///< Rows decoded a block ahead on a thread of their own; 0 decodes on the calling thread.
+};
+
+// Base class for anything rows can be extracted from
+class row_source {
+public:
+    virtual ~row_source() = default;
+
+    /**
+     * @brief Lists the base tables of the database together with their columns.
+     *
+     * @return The tables, with columns in ordinal order and without rows.
+     */
+    virtual std::vector<std::shared_ptr<table_info>> load_catalog() = 0;
+
+    /**
+     * @brief Lists the foreign keys between the base tables of the database.
+     *
+     * @return The keys, with their columns in key order; none unless the source knows of any.
+     */
+    virtual std::vector<foreign_key> load_foreign_keys() { return {}; }
+
+    /**
+     * @brief Fills in table_info::row_estimate for every table.
+     *
+     * The estimates only need to be good enough to order the tables by size.
+     *
+     * @param tables : The tables to estimate.
+     */
+    virtual void estimate_rows(const std::vector<std::shared_ptr<table_info>>& tables) {}
+
+    /**
+     * @brief Returns a fingerprint of the schema that changes whenever a table, column, primary key or foreign key does.
+     *
+     * Hashes load_catalog() and load_foreign_keys() unless the source can summarize its schema more cheaply.
+     * Fingerprints are only comparable between sources of the same kind.
+     */
+    virtual uint64_t schema_fingerprint();
+
+    /**
+     * @brief Streams every row of a table, one at a time.
+     *
+     * @param table : The table to read, as returned by load_catalog().
+     * @param on_row : Called once per row; the field views are only valid during the call.
+     */
+    virtual void fetch_rows(const table_info& table, const row_callback& on_row) = 0;
+
+    /**
+     * @brief Streams every row of a table, one at a time, without turning numbers into text.
+     *
+     * Wraps the text of fetch_rows() unless the source can read values natively.
+     *
+     * @param table : The table to read, as returned by load_catalog().
+     * @param on_row : Called once per row; the fields are only valid during the call.
+     */
+    virtual void fetch_fields(const table_info& table, const field_callback& on_row);
+
+    /**
+     * @brief Returns the highest value a column currently holds, as text.
+     *
+     * Scans the table with fetch_rows() unless the source can ask for the maximum directly.
+     *
+     * @param table : The table to read.
+     * @param column : The index of the watermark column.
+     * @return The mark, or an empty string when the table has no rows.
+     */
+    virtual std::wstring high_water_mark(const table_info& table, size_t column);
+
+    /**
+     * @brief Streams the rows whose watermark column lies above one mark and at or below another.
+     *
+     * Filters fetch_rows() with compare_watermarks() unless the source can filter itself.
+     *
+     * @param table : The table to read.
+     * @param column : The index of the watermark column.
+     * @param after : The mark of the previous run; empty to start from the first row.
+     * @param up_to : The mark taken at the start of this run.
+     * @param on_row : Called once per changed row; the field views are only valid during the call.
+     */
+    virtual void fetch_changed_rows(const table_info& table, size_t column, const std::wstring& after, const std::wstring& up_to, const row_callback& on_row);
+
+    /**
+     * @brief Samples the rows of a table, for the values of filter statements.
+     *
+     * Streams every row through the sampler unless the source can sample on its
+     * side and send only a fraction of the rows.
+     *
+     * @param table : The table to sample.
+     * @param sample : Receives the rows; its settings say how many to keep and how.
+     * @return The number of rows read from the source.
+     */
+    virtual uint64_t sample_rows(const table_info& table, row_sampler& sample);
+
+protected:
+
+    // Streams about 'percent' percent of the rows of a table, picking the same rows for the same seed
+    using fraction_fetcher = std::function<void(double percent, uint64_t seed, const field_callback& on_row)>;
+
+    /**
+     * @brief Samples a table through a fetch of a random fraction of its rows.
+     *
+     * The fraction aims at several times the rows to keep, as sources sample whole
+     * pages. Stratified samples, which could miss rare values, tables small enough
+     * that the fraction would be most of them, and fractions that come back with
+     * too few rows read every row instead.
+     *
+     * @param table : The table to sample.
+     * @param sample : Receives the rows.
+     * @param fetch_fraction : Fetches the fraction.
+     * @return The number of rows read from the source.
+     */
+    uint64_t sample_fraction(const table_info& table, row_sampler& sample, const fraction_fetcher& fetch_fraction);
+};
+
+// Reads tables from a SQL Server database through SQLAPI++
+class sqlapi_source : public row_source {
+    SAConnection conn{};
+    fetch_options fetching{};
+
+    void execute(SACommand& cmd);
+    void read(SACommand& cmd, const table_info& table, const std::function<void(row_reader& reader)>& consume);
+
+public:
+
+    /**
+     * @brief Connects to the database.
+     *
+     * @param connection_string : The SQLAPI++ connection string of the server and database.
+     * @param fetching : How many rows are fetched per round trip and decoded ahead.
+     */
+    sqlapi_source(const std::wstring& connection_string, fetch_options fetching = {});
+    ~sqlapi_source() override;
+
+    std::vector<std::shared_ptr<table_info>> load_catalog() override;
+    std::vector<foreign_key> load_foreign_keys() override;
+    void estimate_rows(const std::vector<std::shared_ptr<table_info>>& tables) override;
+    uint64_t schema_fingerprint() override;
+    void fetch_rows(const table_info& table, const row_callback& on_row) override;
+    void fetch_fields(const table_info& table, const field_callback& on_row) override;
+    std::wstring high_water_mark(const table_info& table, size_t column) override;
+    void fetch_changed_rows(const table_info& table, size_t column, const std::wstring& after, const std::wstring& up_to, const row_callback& on_row) override;
+    uint64_t sample_rows(const table_info& table, row_sampler& sample) override;
+};
+
+/**
+ * @class csv_source
+ * @brief Reads tables from a directory of CSV files, as a local stand-in for a database.
+ *
+ * Every '<schema>.<table>.csv' file in the directory is one table. The first record
+ * holds the column headers, written as 'name:data_type' ('nvarchar' when the type
+ * is omitted), suffixed with ':pk' on primary key columns and then with
+ * ':ref=<schema>.<table>.<column>' on columns referencing another table; every
+ * following record is a row. Files are UTF-8 and fields follow RFC 4180 quoting.
+ */
+class csv_source : public row_source {
+    std::filesystem::path directory{};
+
+public:
+
+    csv_source(std::filesystem::path directory);
+
+    std::vector<std::shared_ptr<table_info>> load_catalog() override;
+    std::vector<foreign_key> load_foreign_keys() override;
+    void estimate_rows(const std::vector<std::shared_ptr<table_info>>& tables) override;
+    void fetch_rows(const table_info& table, const row_callback& on_row) override;
+
+private:
+    std::filesystem::path table_path(const table_info& table) const;
+    std::vector<std::string> read_header(const table_info& table) const;
+};
+
+/**
+ * @class snapshot_source
+ * @brief Reads tables from a previously exported snapshot instead of the database.
+ *
+ * Sources may share one snapshot, which is only ever read.
+ */
+class snapshot_source : public row_source {
+    std::shared_ptr<const snapshot> data{};
+    std::unordered_map<std::wstring, size_t> index{};
+
+public:
+
+    /**
+     * @param data : The snapshot to read.
+     */
+    snapshot_source(std::shared_ptr<const snapshot> data);
+
+    std::vector<std::shared_ptr<table_info>> load_catalog() override;
+    void estimate_rows(const std::vector<std::shared_ptr<table_info>>& tables) override;
+    void fetch_rows(const table_info& table, const row_callback& on_row) override;
+
+private:
+    size_t find(const table_info& table) const;
+};
+
+/**
+ * @class memory_source
+ * @brief Serves tables held in memory, as an in-process stand-in for a database.
+ *
+ * Every call can be delayed by a fixed latency to mimic the round trips of a
+ * remote server, and sampling picks whole pages of rows like TABLESAMPLE does, so
+ * the ways of sampling can be compared without a server. Instances may share the
+ * same tables, which are never modified.
+ */
+class memory_source : public row_source {
+    std::shared_ptr<const std::vector<std::shared_ptr<table_info>>> tables{};
+    std::chrono::microseconds latency{};
+
+public:
+
+    /**
+     * @param tables : The tables to serve, with their columns and rows.
+     * @param latency : The delay added to every call, simulating a round trip.
+     */
+    memory_source(std::shared_ptr<const std::vector<std::shared_ptr<table_info>>> tables, std::chrono::microseconds latency = {});
+
+    std::vector<std::shared_ptr<table_info>> load_catalog() override;
+    void estimate_rows(const std::vector<std::shared_ptr<table_info>>& tables) override;
+    void fetch_rows(const table_info& table, const row_callback& on_row) override;
+    void fetch_fields(const table_info& table, const field_callback& on_row) override;
+    uint64_t sample_rows(const table_info& table, row_sampler& sample) override;
+
+private:
+    const table_info& find(const table_info& table) const;
+    void round_trip() const;
+};
+
+/**
+ * @brief Orders two watermarks; digit-only marks compare as numbers, anything else as text.
+ *
+ * @return A negative number, zero or a positive number, like std::wstring::compare().
+ */
+int compare_watermarks(std::wstring_view lhs, std::wstring_view rhs);
+
+/**
+ * @brief Hashes the names, types, order and primary keys of the tables and columns, and the foreign keys, with 64-bit FNV-1a.
+ *
+ * @param tables : The tables to hash.
+ * @param keys : The foreign keys between them.
+ */
+uint64_t fingerprint_tables(const std::vector<std::shared_ptr<table_info>>& tables, const std::vector<foreign_key>& keys);
+
+// Creates a new, independent source (and connection)
+using source_factory = std::function<std::unique_ptr<row_source>()>;
+
+/**
+ * @class source_pool
+ * @brief A fixed pool of sources, each with its own connection.
+ */
+class source_pool {
+    std::vector<std::unique_ptr<row_source>> sources{};
+
+public:
+
+    /**
+     * @brief Opens the sources concurrently.
+     *
+     * @param size : The number of sources to open.
+     * @param open : Opens a single source.
+     */
+    source_pool(size_t size, const source_factory& open);
+
+    size_t size() const { return sources.size(); }
+    row_source& operator[](size_t index) { return *sources[index]; }
+};
+
+// The samples of every table
+struct table_samples {
+    std::vector<std::unique_ptr<row_sampler>> samples{};    ///< One per table, in table order.
+    uint64_t rows_read{};                                   ///< Rows read from the sources to take them.
+};
+
+/**
+ * @brief Samples every table through row_source::sample_rows(), one table per source at a time.
+ *
+ * @param sources : The sources to sample with.
+ * @param tables : The tables to sample.
+ * @param options : How many rows to keep per table and how.
+ */
+table_samples sample_tables(source_pool& sources, const std::vector<std::shared_ptr<table_info>>& tables, const sampler_options& options);
+
+#endif // !_ROW_SOURCE_H
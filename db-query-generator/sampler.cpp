@@ -0,0 +1,222 @@
+#include "sampler.h"
+#include "hashing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// --------------------
+// START OF RESERVOIR FUNCTIONS
+// --------------------
+
+reservoir::reservoir(size_t column_count, size_t capacity, uint64_t seed) :
+    capacity(capacity), column_count(column_count), random(seed) {
+    if (!capacity) {
+        next_pick = UINT64_MAX;
+        return;
+    }
+
+    weight = std::exp(std::log(uniform()) / static_cast<double>(capacity));
+    next_pick = capacity - 1;
+    skip();
+}
+
+// Returns a number in (0, 1); computed by hand so the same seed gives the same numbers on every platform
+double reservoir::uniform() {
+    return (static_cast<double>(random() >> 11) + 0.5) * 0x1p-53;
+}
+
+// Moves next_pick past the rows the current weight skips
+void reservoir::skip() {
+    double gap{ std::floor(std::log(uniform()) / std::log1p(-weight)) };
+
+    // The weight only grows towards 1, after which no row would ever be picked again
+    if (!(gap < 1e18)) {
+        next_pick = UINT64_MAX;
+        return;
+    }
+
+    next_pick += static_cast<uint64_t>(gap) + 1;
+}
+
+// Keeps or skips the next row; 'field(column)' returns its fields and is only called for kept rows
+template <typename field_getter>
+void reservoir::offer_row(const field_getter& field) {
+    uint64_t index{ seen++ };
+    number_buffer digits{};
+
+    if (index < capacity) {
+        for (size_t column{}; column < column_count; column++) {
+            field_value value{ field(column) };
+            fields.emplace_back(format_field(value, digits));
+            nulls.push_back(value.null);
+        }
+
+        return;
+    }
+
+    if (index != next_pick) {
+        return;
+    }
+
+    size_t slot{ static_cast<size_t>(random() % capacity) };
+    for (size_t column{}; column < column_count; column++) {
+        field_value value{ field(column) };
+        fields[slot * column_count + column].assign(format_field(value, digits));
+        nulls[slot * column_count + column] = value.null;
+    }
+
+    weight *= std::exp(std::log(uniform()) / static_cast<double>(capacity));
+    skip();
+}
+
+void reservoir::offer(const table_info& chunk, size_t row) {
+    offer_row([&](size_t column) { return chunk.field(row, column); });
+}
+
+void reservoir::offer(const std::vector<field_value>& fields) {
+    offer_row([&](size_t column) { return fields[column]; });
+}
+
+void reservoir::offer(std::wstring_view value) {
+    offer_row([&](size_t) { return field_value::text_field(value); });
+}
+
+// --------------------
+// END OF RESERVOIR FUNCTIONS
+// --------------------
+// --------------------
+// START OF ROW SAMPLER FUNCTIONS
+// --------------------
+
+row_sampler::row_sampler(const table_info& table, const sampler_options& options) :
+    options(options), column_count(table.columns.size()), seed(mix_bits(options.seed ^ hash_text(table.schema + L'.' + table.name))) {
+    this->options.strata = std::max<size_t>(this->options.strata, 1);
+
+    if (!options.stratify_column.empty()) {
+        for (size_t i{}; i < table.columns.size(); i++) {
+            if (table.columns[i]->name == options.stratify_column) {
+                stratify_column = i;
+                break;
+            }
+        }
+    }
+
+    if (stratify_column == std::wstring::npos) {
+        all.emplace_back(column_count, options.rows, seed);
+    }
+}
+
+// Orders the distinct values of a stratified table; the kept values are those with the lowest rank
+uint64_t row_sampler::rank(std::wstring_view value) const {
+    return mix_bits(seed ^ hash_text(value));
+}
+
+// Returns the reservoir rows with a value of the stratification column go to, or nullptr if the value is not kept
+reservoir* row_sampler::reservoir_for(std::wstring_view value) {
+    auto found{ strata.find(value) };
+    if (found != strata.end()) {
+        return &found->second.rows;
+    }
+
+    uint64_t value_rank{ rank(value) };
+
+    if (strata.size() == options.strata) {
+        if (value_rank >= highest_rank) {
+            return nullptr;
+        }
+
+        strata.erase(std::find_if(strata.begin(), strata.end(), [&](const auto& kept) { return kept.second.rank == highest_rank; }));
+    }
+
+    size_t share{ std::max<size_t>(options.rows / options.strata, 1) };
+    auto added{ strata.emplace(std::wstring{ value }, stratum{ value_rank, reservoir{ column_count, share, seed ^ value_rank } }).first };
+
+    highest_rank = 0;
+    for (const auto& [kept_value, kept] : strata) {
+        highest_rank = std::max(highest_rank, kept.rank);
+    }
+
+    return &added->second.rows;
+}
+
+void row_sampler::offer(const table_info& chunk) {
+    number_buffer digits{};
+
+    for (size_t row{}; row < chunk.row_count(); row++) {
+        if (reservoir* rows{ all.empty() ? reservoir_for(chunk.value(row, stratify_column, digits)) : &all.front() }) {
+            rows->offer(chunk, row);
+        }
+    }
+}
+
+// NULLs of the stratification column share the stratum of empty strings
+void row_sampler::offer(const std::vector<field_value>& fields) {
+    number_buffer digits{};
+
+    if (reservoir* rows{ all.empty() ? reservoir_for(format_field(fields[stratify_column], digits)) : &all.front() }) {
+        rows->offer(fields);
+    }
+}
+
+size_t row_sampler::size() const {
+    size_t count{};
+
+    for (const auto& rows : all) {
+        count += rows.size();
+    }
+
+    for (const auto& [value, kept] : strata) {
+        count += kept.rows.size();
+    }
+
+    return count;
+}
+
+void row_sampler::for_each_row(const sample_callback& on_row) const {
+    std::vector<const reservoir*> ordered{};
+
+    for (const auto& rows : all) {
+        ordered.emplace_back(&rows);
+    }
+
+    // By rank rather than in hash map order, so the same seed lists the same rows in the same order
+    std::vector<const stratum*> ranked{};
+    for (const auto& [value, kept] : strata) {
+        ranked.emplace_back(&kept);
+    }
+
+    std::sort(ranked.begin(), ranked.end(), [](const stratum* a, const stratum* b) { return a->rank < b->rank; });
+
+    for (const stratum* kept : ranked) {
+        ordered.emplace_back(&kept->rows);
+    }
+
+    std::vector<field_value> fields(column_count);
+
+    for (const reservoir* rows : ordered) {
+        for (size_t row{}; row < rows->size(); row++) {
+            for (size_t column{}; column < column_count; column++) {
+                fields[column] = rows->field(row, column);
+            }
+
+            on_row(fields);
+        }
+    }
+}
+
+// --------------------
+// END OF ROW SAMPLER FUNCTIONS
+// --------------------
+
+value_sourcing value_sourcing_from_string(std::string_view name) {
+    if (name == "streamed") {
+        return value_sourcing::streamed;
+    }
+    else if (name == "pushed-down") {
+        return value_sourcing::pushed_down;
+    }
+    else {
+        throw std::invalid_argument{ "Unknown value sourcing: " + std::string{ name } };
+    }
+}
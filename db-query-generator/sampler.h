@@ -0,0 +1,205 @@
+#ifndef _SAMPLER_H
+#define _SAMPLER_H
+
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "table_store.h"
+
+/* Type Definitions
+************************************************************************/
+
+// How many rows of every table are sampled and how
+struct sampler_options {
+    size_t rows{ 100 };                 ///< Rows kept per table.
+    uint64_t seed{};                    ///< Seed of every random choice; the same seed picks the same rows.
+    std::wstring stratify_column{};     ///< Tables with a column of this name are sampled by its distinct values.
+    size_t strata{ 10 };                ///< Distinct values kept per stratified table; 'rows' is shared between them.
+};
+
+// Where the rows that filter values are taken from get sampled
+enum struct value_sourcing {
+    streamed,       ///< The rows extracted for the snapshot, sampled on the client as they stream past.
+    pushed_down     ///< Samples the sources take on their side, reading only a fraction of every table.
+};
+
+/**
+ * @class reservoir
+ * @brief Keeps a uniform random sample of a stream of rows in a single pass.
+ *
+ * Uses Algorithm L: once the reservoir is full, the number of rows to skip before
+ * the next replacement is drawn directly, so the cost per skipped row is a single
+ * comparison and the memory used is that of the kept rows only.
+ */
+class reservoir {
+    size_t capacity{}, column_count{};
+    std::mt19937_64 random;
+    std::vector<std::wstring> fields{};     ///< The kept rows, row after row.
+    std::vector<uint8_t> nulls{};           ///< Whether every kept field is NULL, in the order of 'fields'.
+    uint64_t seen{};                        ///< Rows offered so far.
+    uint64_t next_pick{};                   ///< The next offered row that replaces a kept one.
+    double weight{};
+
+    double uniform();
+    void skip();
+
+    template <typename field_getter>
+    void offer_row(const field_getter& field);
+
+public:
+
+    /**
+     * @param column_count : The number of fields of every row.
+     * @param capacity : The number of rows to keep.
+     * @param seed : The seed of the random choices.
+     */
+    reservoir(size_t column_count, size_t capacity, uint64_t seed);
+
+    /**
+     * @brief Offers the next row of the stream.
+     *
+     * @param chunk : The rows being streamed.
+     * @param row : The index of the row inside the chunk.
+     */
+    void offer(const table_info& chunk, size_t row);
+
+    /**
+     * @brief Offers the next row of the stream.
+     *
+     * @param fields : The fields of the row, in column order.
+     */
+    void offer(const std::vector<field_value>& fields);
+
+    /**
+     * @brief Offers the next row of a stream of single non-null values.
+     *
+     * @param value : The value; the reservoir must have been created with a single column.
+     */
+    void offer(std::wstring_view value);
+
+    /**
+     * @brief Returns the number of kept rows.
+     */
+    size_t size() const { return fields.size() / (column_count ? column_count : 1); }
+
+    /**
+     * @brief Returns a field of a kept row as text; empty for NULL.
+     */
+    std::wstring_view value(size_t row, size_t column) const { return fields[row * column_count + column]; }
+
+    /**
+     * @brief Returns a field of a kept row, as text or NULL.
+     */
+    field_value field(size_t row, size_t column) const {
+        size_t index{ row * column_count + column };
+        return nulls[index] ? field_value::null_field() : field_value::text_field(fields[index]);
+    }
+};
+
+// Called with the fields of a sampled row, as text or NULL; the views are only valid during the call
+using sample_callback = std::function<void(const std::vector<field_value>& fields)>;
+
+/**
+ * @class row_sampler
+ * @brief Picks a fixed number of rows of a table as they stream past, using memory for those rows only.
+ *
+ * Tables without the stratification column are sampled uniformly. Otherwise rows are
+ * grouped by the value of that column and every kept value gets an equal share of the
+ * rows, so rare values are represented as well as common ones. When a table has more
+ * distinct values than strata, the kept values are those with the lowest seeded hash,
+ * a uniform random choice of the distinct values made without counting them.
+ *
+ * Random choices are seeded from the options and the name of the table, so they do
+ * not depend on the order tables are extracted in.
+ */
+class row_sampler {
+    // Hashes the std::wstring keys through std::wstring_view, so looking a field up needs no copy
+    struct text_hash {
+        using is_transparent = void;
+        size_t operator()(std::wstring_view text) const { return std::hash<std::wstring_view>{}(text); }
+    };
+
+    struct stratum {
+        uint64_t rank{};
+        reservoir rows;
+    };
+
+    sampler_options options{};
+    size_t column_count{};
+    uint64_t seed{};
+    size_t stratify_column{ std::wstring::npos };
+
+    std::vector<reservoir> all{};                           ///< The single reservoir of an unstratified table.
+    std::unordered_map<std::wstring, stratum, text_hash, std::equal_to<>> strata{};     ///< The reservoir of every kept value of a stratified table.
+    uint64_t highest_rank{};                                ///< The highest rank among the kept values.
+
+    uint64_t rank(std::wstring_view value) const;
+    reservoir* reservoir_for(std::wstring_view value);
+
+public:
+
+    /**
+     * @param table : The table the rows come from.
+     * @param options : The number of rows to keep, the seed and the stratification.
+     */
+    row_sampler(const table_info& table, const sampler_options& options);
+
+    /**
+     * @brief Offers every row of a chunk, in order.
+     *
+     * @param chunk : The rows.
+     */
+    void offer(const table_info& chunk);
+
+    /**
+     * @brief Offers a single row.
+     *
+     * @param fields : The fields of the row, in column order.
+     */
+    void offer(const std::vector<field_value>& fields);
+
+    /**
+     * @brief Returns the number of rows to keep, the seed and the stratification.
+     */
+    const sampler_options& settings() const { return options; }
+
+    /**
+     * @brief Returns the seed of this table, for sources that sample on their side.
+     */
+    uint64_t table_seed() const { return seed; }
+
+    /**
+     * @brief Returns whether rows are sampled by the distinct values of a column.
+     */
+    bool stratified() const { return all.empty(); }
+
+    /**
+     * @brief Returns the number of sampled rows.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Calls on_row once per sampled row; stratified samples are listed value by value.
+     *
+     * @param on_row : The callback.
+     */
+    void for_each_row(const sample_callback& on_row) const;
+};
+
+/* Function Declarations
+************************************************************************/
+
+/**
+ * @brief Parses a value sourcing name, 'streamed' or 'pushed-down'.
+ *
+ * @param name : The name of the strategy.
+ * @return The strategy; throws std::invalid_argument for an unknown name.
+ */
+value_sourcing value_sourcing_from_string(std::string_view name);
+
+#endif // !_SAMPLER_H
@@ -0,0 +1,83 @@
+#include "scheduler.h"
+
+#include <atomic>
+#include <exception>
+#include <optional>
+#include <thread>
+
+work_stealing_scheduler::work_stealing_scheduler(size_t worker_count) :
+    worker_count(worker_count ? worker_count : 1) {}
+
+void work_stealing_scheduler::run(const std::vector<size_t>& order, const std::function<void(size_t worker, size_t task)>& task) {
+    std::vector<std::unique_ptr<worker_queue>> queues{};
+
+    for (size_t i{}; i < worker_count; i++) {
+        queues.emplace_back(std::make_unique<worker_queue>());
+    }
+
+    // Deal the tasks so every worker starts with one of the first ones
+    for (size_t i{}; i < order.size(); i++) {
+        queues[i % worker_count]->tasks.push_back(order[i]);
+    }
+
+    std::atomic<bool> stopped{};
+    std::exception_ptr error{};
+    std::mutex error_mutex{};
+
+    // Takes from the front of a queue: the owner and thieves both want the next task in order
+    auto take = [&](size_t queue) -> std::optional<size_t> {
+        std::lock_guard lock{ queues[queue]->mutex };
+
+        if (queues[queue]->tasks.empty()) {
+            return std::nullopt;
+        }
+
+        size_t next{ queues[queue]->tasks.front() };
+        queues[queue]->tasks.pop_front();
+        return next;
+    };
+
+    auto work = [&](size_t worker) {
+        while (!stopped) {
+            std::optional<size_t> next{ take(worker) };
+
+            for (size_t i{ 1 }; !next && i < worker_count; i++) {
+                next = take((worker + i) % worker_count);
+            }
+
+            // Tasks are never added while running, so empty queues everywhere means done
+            if (!next) {
+                return;
+            }
+
+            try {
+                task(worker, *next);
+            }
+            catch (...) {
+                std::lock_guard lock{ error_mutex };
+
+                if (!error) {
+                    error = std::current_exception();
+                }
+
+                stopped = true;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads{};
+
+    for (size_t i{ 1 }; i < worker_count; i++) {
+        threads.emplace_back(work, i);
+    }
+
+    work(0);
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef _SCHEDULER_H
+#define _SCHEDULER_H
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * @class work_stealing_scheduler
+ * @brief Runs a fixed set of tasks on a pool of worker threads.
+ *
+ * Tasks are dealt round-robin to per-worker queues in the order given, so the
+ * first tasks in the order start first. A worker runs its own queue front to back
+ * and, once it runs dry, steals the next pending task from the other workers.
+ */
+class work_stealing_scheduler {
+    struct worker_queue {
+        std::mutex mutex{};
+        std::deque<size_t> tasks{};
+    };
+
+    size_t worker_count{};
+
+public:
+
+    /**
+     * @param worker_count : The number of worker threads.
+     */
+    explicit work_stealing_scheduler(size_t worker_count);
+
+    /**
+     * @brief Returns the number of worker threads.
+     */
+    size_t size() const { return worker_count; }
+
+    /**
+     * @brief Runs every task and waits for all of them to finish.
+     *
+     * If a task throws, no further tasks are started and the first exception
+     * is rethrown once the running tasks have finished.
+     *
+     * @param order : The tasks to run, in the order they should start.
+     * @param task : Called as task(worker, task_index) for every entry of 'order'.
+     */
+    void run(const std::vector<size_t>& order, const std::function<void(size_t worker, size_t task)>& task);
+};
+
+#endif // !_SCHEDULER_H
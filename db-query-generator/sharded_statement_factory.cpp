@@ -0,0 +1,91 @@
+#include "sharded_statement_factory.h"
+#include "scheduler.h"
+
+#include <numeric>
+
+sharded_statement_factory::sharded_statement_factory(size_t thread_count) :
+    thread_count(thread_count ? thread_count : 1) {}
+
+void sharded_statement_factory::generate(size_t table_count, const std::function<void(sql_statement_factory& shard, size_t table)>& generate) {
+    shards.clear();
+    for (size_t i{}; i < thread_count; i++) {
+        shards.emplace_back(std::make_unique<sql_statement_factory>());
+    }
+
+    tables.assign(table_count, table_statements{});
+
+    std::vector<size_t> order(table_count);
+    std::iota(order.begin(), order.end(), size_t{});
+
+    // Every worker only touches its own shard and the entries of the tables it takes
+    work_stealing_scheduler{ thread_count }.run(order, [&](size_t worker, size_t table) {
+        sql_statement_factory& shard{ *shards[worker] };
+        size_t first{ shard.size() };
+
+        generate(shard, table);
+
+        tables[table] = table_statements{ worker, first, shard.size() - first };
+    });
+}
+
+size_t sharded_statement_factory::size() const {
+    size_t count{};
+
+    for (const auto& shard : shards) {
+        count += shard->size();
+    }
+
+    return count;
+}
+
+size_t sharded_statement_factory::duplicates_removed() const {
+    size_t count{};
+
+    for (const auto& shard : shards) {
+        count += shard->duplicates_removed();
+    }
+
+    return count;
+}
+
+size_t sharded_statement_factory::templated_count() const {
+    size_t count{};
+
+    for (const auto& shard : shards) {
+        count += shard->templated_count();
+    }
+
+    return count;
+}
+
+rendered_statement sharded_statement_factory::render(size_t table, size_t statement, std::wstring& buffer) const {
+    rendered_statement rendered{ shards[tables[table].shard]->render(tables[table].first + statement, buffer) };
+    rendered.table = table;
+    return rendered;
+}
+
+statement_stream sharded_statement_factory::stream() const {
+    return statement_stream{ *this };
+}
+
+statement_stream::statement_stream(const sharded_statement_factory& factory) :
+    factory(&factory) {
+    render_current();
+}
+
+void statement_stream::advance() {
+    statement++;
+    render_current();
+}
+
+// Skips the tables that have no statements left, then renders the statement the stream is at
+void statement_stream::render_current() {
+    while (!done() && statement >= factory->statement_count(table)) {
+        table++;
+        statement = 0;
+    }
+
+    if (!done()) {
+        current = factory->render(table, statement, buffer);
+    }
+}
@@ -0,0 +1,142 @@
+#ifndef _SHARDED_STATEMENT_FACTORY_H
+#define _SHARDED_STATEMENT_FACTORY_H
+
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include "sql_statement_factory.h"
+
+class statement_stream;
+
+/**
+ * @class sharded_statement_factory
+ * @brief Generates the statements of many tables on a pool of threads.
+ *
+ * Every worker thread owns a sql_statement_factory shard, so generating needs no
+ * locks. A table is generated entirely on one shard, and the statements are listed
+ * table by table in the order of the tables, then in the order they were created,
+ * which is the order a single sql_statement_factory generating the tables one
+ * after the other would list them in, whatever the number of threads.
+ */
+class sharded_statement_factory {
+    // Where the statements of a table were created
+    struct table_statements {
+        size_t shard{}, first{}, count{};
+    };
+
+    size_t thread_count{};
+    std::vector<std::unique_ptr<sql_statement_factory>> shards{};
+    std::vector<table_statements> tables{};
+
+public:
+
+    /**
+     * @param thread_count : The number of threads, and shards, to generate with.
+     */
+    explicit sharded_statement_factory(size_t thread_count);
+
+    /**
+     * @brief Generates the statements of every table, each table on one of the threads.
+     *
+     * @param table_count : The number of tables, replacing those of a previous call.
+     * @param generate : Called as generate(shard, table) once per table; creates the statements of the table on the shard.
+     */
+    void generate(size_t table_count, const std::function<void(sql_statement_factory& shard, size_t table)>& generate);
+
+    /**
+     * @brief Returns the number of created SQL statements.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Returns the number of duplicate statements dropped on every shard.
+     */
+    size_t duplicates_removed() const;
+
+    /**
+     * @brief Returns the number of created SQL statements that have a template.
+     */
+    size_t templated_count() const;
+
+    /**
+     * @brief Returns the number of tables of the last generate().
+     */
+    size_t table_count() const { return tables.size(); }
+
+    /**
+     * @brief Returns the number of statements created for a table.
+     */
+    size_t statement_count(size_t table) const { return tables[table].count; }
+
+    /**
+     * @brief Renders one statement of a table into a buffer.
+     *
+     * @param table : The index of the table.
+     * @param statement : The position of the statement among those of the table.
+     * @param buffer : Replaced with the text; the views point into it, so it must outlive them and not be modified.
+     * @return The rendered statement.
+     */
+    rendered_statement render(size_t table, size_t statement, std::wstring& buffer) const;
+
+    /**
+     * @brief Returns a stream rendering the statements one at a time, table by table in table order.
+     */
+    statement_stream stream() const;
+};
+
+/**
+ * @class statement_stream
+ * @brief Renders the statements of a sharded_statement_factory one at a time, in table order.
+ *
+ * Only the statement at the front of the stream is rendered, into a buffer the
+ * stream reuses, so walking every statement takes the memory of the longest one
+ * rather than that of all of them. The stream is an input range that can be walked
+ * once: the statement an iterator points at is valid until the iterator is advanced.
+ */
+class statement_stream {
+    const sharded_statement_factory* factory{};
+    size_t table{}, statement{};
+    std::wstring buffer{};
+    rendered_statement current{};
+
+public:
+
+    class iterator {
+        statement_stream* stream{};
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = rendered_statement;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+        explicit iterator(statement_stream* stream) : stream(stream) {}
+
+        const rendered_statement& operator*() const { return stream->current; }
+        const rendered_statement* operator->() const { return &stream->current; }
+        iterator& operator++() { stream->advance(); return *this; }
+        void operator++(int) { stream->advance(); }
+        bool operator==(std::default_sentinel_t) const { return stream->done(); }
+    };
+
+    /**
+     * @param factory : The factory to render the statements of; must outlive the stream and not generate meanwhile.
+     */
+    explicit statement_stream(const sharded_statement_factory& factory);
+
+    // The views of the current statement point into the buffer, which moving could relocate
+    statement_stream(const statement_stream&) = delete;
+    statement_stream& operator=(const statement_stream&) = delete;
+
+    iterator begin() { return iterator{ this }; }
+    std::default_sentinel_t end() const { return {}; }
+
+private:
+    void advance();
+    void render_current();
+    bool done() const { return table >= factory->table_count(); }
+};
+
+#endif // !_SHARDED_STATEMENT_FACTORY_H
@@ -1,63 +1,339 @@
 #include "sql_statement_factory.h"
+#include "hashing.h"
+
+#include <algorithm>
 #include <iostream>
+#include <type_traits>
+
+// The arena is released without running destructors
+static_assert(std::is_trivially_destructible_v<select_statement>);
+static_assert(std::is_trivially_destructible_v<select_all_statement>);
+static_assert(std::is_trivially_destructible_v<filter_statement>);
+static_assert(std::is_trivially_destructible_v<conjunction_statement>);
+static_assert(std::is_trivially_destructible_v<range_statement>);
+static_assert(std::is_trivially_destructible_v<in_list_statement>);
+static_assert(std::is_trivially_destructible_v<top_statement>);
+static_assert(std::is_trivially_destructible_v<join_statement>);
+
+// Separates the values of a key
+static constexpr wchar_t key_separator{ L'\x1F' };
+
+// Copies text into the arena
+std::wstring_view sql_statement_factory::store(std::wstring_view text) {
+    std::pmr::polymorphic_allocator<wchar_t> allocator{ &arena };
+    wchar_t* characters{ allocator.allocate(std::max<size_t>(text.size(), 1)) };
+    std::copy(text.begin(), text.end(), characters);
+    return { characters, text.size() };
+}
+
+sql_statement_factory::statement_key sql_statement_factory::keep(statement_key key) {
+    std::pmr::polymorphic_allocator<> allocator{ &arena };
+
+    name_id* columns{ allocator.allocate_object<name_id>(std::max<size_t>(key.columns.size(), 1)) };
+    std::copy(key.columns.begin(), key.columns.end(), columns);
+
+    key.columns = { columns, key.columns.size() };
+    key.value = store(key.value);
+    return key;
+}
+
+std::pair<std::wstring_view, statement_parameter> sql_statement_factory::store_value(const data_type_info& type, std::wstring_view value) {
+    return { store(type.format_literal(value)), statement_parameter{ store(value), &type } };
+}
+
+bool sql_statement_factory::statement_key::operator==(const statement_key& other) const {
+    return kind == other.kind && table == other.table && std::equal(columns.begin(), columns.end(), other.columns.begin(), other.columns.end())
+        && op == other.op && value == other.value;
+}
+
+size_t sql_statement_factory::statement_key_hash::operator()(const statement_key& key) const {
+    uint64_t hash{ mix_bits((uint64_t{ key.table } << 8) | static_cast<uint8_t>(key.kind)) };
+
+    for (name_id column : key.columns) {
+        hash = mix_bits(hash ^ column);
+    }
+
+    hash = mix_bits(hash ^ static_cast<uint8_t>(key.op));
+    return static_cast<size_t>(mix_bits(hash ^ hash_text(key.value)));
+}
+
+// Returns the statement created with a key, counting the duplicate, or nullptr if there is none
+const sql_statement* sql_statement_factory::find_duplicate(const statement_key& key) {
+    auto found{ created.find(key) };
+    if (found == created.end()) {
+        return nullptr;
+    }
+
+    duplicates++;
+    return found->second;
+}
 
 // Creates a select statement and adds it to the list of statements
-std::shared_ptr<sql_statement> sql_statement_factory::create_select_statement(const std::wstring& table, const std::vector<std::wstring>& columns) {
-    auto stmt{ std::make_shared<select_statement>() }; // Create a new select_statement
+const sql_statement& sql_statement_factory::create_select_statement(name_id table, std::span<const name_id> columns) {
+    sorted_columns.assign(columns.begin(), columns.end());
+    std::sort(sorted_columns.begin(), sorted_columns.end());
+
+    statement_key key{ statement_kind::select, table, sorted_columns };
+    if (const sql_statement* existing{ find_duplicate(key) }) {
+        return *existing;
+    }
+
+    std::pmr::polymorphic_allocator<> allocator{ &arena };
+
+    // The columns in the order given, then sorted for the key
+    name_id* stored_columns{ allocator.allocate_object<name_id>(std::max<size_t>(columns.size(), 1) * 2) };
+    std::copy(columns.begin(), columns.end(), stored_columns);
+    std::copy(sorted_columns.begin(), sorted_columns.end(), stored_columns + columns.size());
+    key.columns = { stored_columns + columns.size(), columns.size() };
+
+    auto stmt{ allocator.new_object<select_statement>() }; // Create a new select_statement
     stmt->set_table(table); // Set the table name
-    stmt->add_columns(columns); // Add the columns
+    stmt->set_columns({ stored_columns, columns.size() }); // Set the columns
     statements.push_back(stmt); // Add the statement to the list
-    return stmt; // Return the created statement
+    created.emplace(key, stmt);
+    return *stmt; // Return the created statement
 }
 
 // Creates a select all statement and adds it to the list of statements
-std::shared_ptr<sql_statement> sql_statement_factory::create_select_all_statement(const std::wstring& table) {
-    auto stmt{ std::make_shared<select_all_statement>() }; // Create a new select_all_statement
+const sql_statement& sql_statement_factory::create_select_all_statement(name_id table) {
+    statement_key key{ statement_kind::select_all, table };
+    if (const sql_statement* existing{ find_duplicate(key) }) {
+        return *existing;
+    }
+
+    std::pmr::polymorphic_allocator<> allocator{ &arena };
+
+    auto stmt{ allocator.new_object<select_all_statement>() }; // Create a new select_all_statement
     stmt->set_table(table); // Set the table name
     statements.push_back(stmt); // Add the statement to the list
-    return stmt; // Return the created statement
+    created.emplace(key, stmt);
+    return *stmt; // Return the created statement
 }
 
-std::shared_ptr<sql_statement> sql_statement_factory::create_filter_statement(const std::wstring& table, const std::wstring& column, const std::wstring& operation, const std::wstring& value) {
-    auto stmt{ std::make_shared<filter_statement>() }; // Create a new filter_statement
+// The key holds the unquoted value, which the type and operator determine the literal from
+const sql_statement& sql_statement_factory::create_filter_statement(name_id table, name_id column, const data_type_info& type, comparison_operators operation, std::wstring_view value) {
+    statement_key key{ statement_kind::filter, table, { &column, 1 }, operation, value };
+    if (const sql_statement* existing{ find_duplicate(key) }) {
+        return *existing;
+    }
+
+    std::pmr::polymorphic_allocator<> allocator{ &arena };
+
+    // The key keeps pointing at the column
+    name_id* stored_column{ allocator.new_object<name_id>(column) };
+    key.columns = { stored_column, 1 };
+    key.value = store(value);
+
+    bool parameterized{ operation != comparison_operators::is };
+
+    auto stmt{ allocator.new_object<filter_statement>() }; // Create a new filter_statement
     stmt->set_table(table); // Set the table name
     stmt->set_column(column);
-    stmt->set_operation(operation);
-    stmt->set_value(value);
+    stmt->set_operation(key.op);
+    stmt->set_value(parameterized ? store(type.format_literal(value)) : key.value);
+
+    if (parameterized) {
+        stmt->set_parameter(statement_parameter{ key.value, &type });
+    }
+
     statements.push_back(stmt); // Add the statement to the list
-    return stmt; // Return the created statement
+    created.emplace(key, stmt);
+    return *stmt; // Return the created statement
+}
+
+// Terms are keyed sorted by column, as '<op><value><separator>' each
+const sql_statement& sql_statement_factory::create_conjunction_statement(name_id table, std::span<const filter_term> terms) {
+    sorted_terms.assign(terms.begin(), terms.end());
+    std::sort(sorted_terms.begin(), sorted_terms.end(), [](const filter_term& a, const filter_term& b) { return a.column < b.column; });
+
+    sorted_columns.clear();
+    canonical.clear();
+
+    for (const filter_term& term : sorted_terms) {
+        sorted_columns.push_back(term.column);
+        canonical += static_cast<wchar_t>(L'0' + static_cast<uint8_t>(term.op));
+        canonical += term.value;
+        canonical += key_separator;
+    }
+
+    statement_key key{ statement_kind::conjunction, table, sorted_columns, comparison_operators::equals, canonical };
+    if (const sql_statement* existing{ find_duplicate(key) }) {
+        return *existing;
+    }
+
+    std::pmr::polymorphic_allocator<> allocator{ &arena };
+
+    column_predicate* predicates{ allocator.allocate_object<column_predicate>(std::max<size_t>(terms.size(), 1)) };
+    statement_parameter* parameters{ allocator.allocate_object<statement_parameter>(std::max<size_t>(terms.size(), 1)) };
+    size_t parameter_count{};
+
+    for (size_t i{}; i < terms.size(); i++) {
+        const filter_term& term{ terms[i] };
+
+        if (term.op == comparison_operators::is) {
+            predicates[i] = column_predicate{ term.column, term.op, store(term.value) };
+            continue;
+        }
+
+        auto [literal, parameter] { store_value(*term.type, term.value) };
+        predicates[i] = column_predicate{ term.column, term.op, literal };
+        parameters[parameter_count++] = parameter;
+    }
+
+    auto stmt{ allocator.new_object<conjunction_statement>() };
+    stmt->set_table(table);
+    stmt->set_predicates({ predicates, terms.size() });
+    stmt->set_parameters({ parameters, parameter_count });
+    statements.push_back(stmt);
+    created.emplace(keep(key), stmt);
+    return *stmt;
 }
 
-// Generates all SQL statements and Labels
-std::vector<std::wstring>  sql_statement_factory::generate_all() {
-    std::vector<std::wstring> sql{};
+const sql_statement& sql_statement_factory::create_range_statement(name_id table, name_id column, const data_type_info& type, std::wstring_view low, std::wstring_view high) {
+    canonical.assign(low);
+    canonical += key_separator;
+    canonical += high;
 
-    for (const auto& stmt : statements) {
-        sql.emplace_back(stmt->generate_sql());
-        sql.emplace_back(stmt->generate_label());
+    statement_key key{ statement_kind::range, table, { &column, 1 }, comparison_operators::equals, canonical };
+    if (const sql_statement* existing{ find_duplicate(key) }) {
+        return *existing;
     }
 
-    return sql;
+    std::pmr::polymorphic_allocator<> allocator{ &arena };
+
+    auto [low_literal, low_parameter] { store_value(type, low) };
+    auto [high_literal, high_parameter] { store_value(type, high) };
+
+    statement_parameter* parameters{ allocator.allocate_object<statement_parameter>(2) };
+    parameters[0] = low_parameter;
+    parameters[1] = high_parameter;
+
+    auto stmt{ allocator.new_object<range_statement>() };
+    stmt->set_table(table);
+    stmt->set_column(column);
+    stmt->set_bounds(low_literal, high_literal, { parameters, 2 });
+    statements.push_back(stmt);
+    created.emplace(keep(key), stmt);
+    return *stmt;
 }
 
-// Generates all SQL statements
-std::vector<std::wstring>  sql_statement_factory::generate_all_sql() {
-    std::vector<std::wstring> sql{};
+const sql_statement& sql_statement_factory::create_in_list_statement(name_id table, name_id column, const data_type_info& type, std::span<const std::wstring_view> values) {
+    sorted_values.assign(values.begin(), values.end());
+    std::sort(sorted_values.begin(), sorted_values.end());
+    sorted_values.erase(std::unique(sorted_values.begin(), sorted_values.end()), sorted_values.end());
+
+    canonical.clear();
+    for (std::wstring_view value : sorted_values) {
+        canonical += value;
+        canonical += key_separator;
+    }
 
-    for (const auto& stmt : statements) {
-        sql.emplace_back(stmt->generate_sql());
+    statement_key key{ statement_kind::in_list, table, { &column, 1 }, comparison_operators::equals, canonical };
+    if (const sql_statement* existing{ find_duplicate(key) }) {
+        return *existing;
     }
 
-    return sql;
+    std::pmr::polymorphic_allocator<> allocator{ &arena };
+
+    std::wstring_view* literals{ allocator.allocate_object<std::wstring_view>(std::max<size_t>(sorted_values.size(), 1)) };
+    statement_parameter* parameters{ allocator.allocate_object<statement_parameter>(std::max<size_t>(sorted_values.size(), 1)) };
+
+    for (size_t i{}; i < sorted_values.size(); i++) {
+        std::tie(literals[i], parameters[i]) = store_value(type, sorted_values[i]);
+    }
+
+    auto stmt{ allocator.new_object<in_list_statement>() };
+    stmt->set_table(table);
+    stmt->set_column(column);
+    stmt->set_values({ literals, sorted_values.size() }, { parameters, sorted_values.size() });
+    statements.push_back(stmt);
+    created.emplace(keep(key), stmt);
+    return *stmt;
 }
 
-// Generates all labels
-std::vector<std::wstring> sql_statement_factory::generate_all_labels() {
-    std::vector<std::wstring> sql{};
+// Keyed by the row count and direction, as '<rows>A' or '<rows>D'
+const sql_statement& sql_statement_factory::create_top_statement(name_id table, name_id column, uint32_t rows, bool descending) {
+    canonical = std::to_wstring(rows);
+    canonical += descending ? L'D' : L'A';
 
-    for (const auto& stmt : statements) {
-        sql.emplace_back(stmt->generate_label());
+    statement_key key{ statement_kind::top, table, { &column, 1 }, comparison_operators::equals, canonical };
+    if (const sql_statement* existing{ find_duplicate(key) }) {
+        return *existing;
     }
 
-    return sql;
-}
\ No newline at end of file
+    std::pmr::polymorphic_allocator<> allocator{ &arena };
+
+    auto stmt{ allocator.new_object<top_statement>() };
+    stmt->set_table(table);
+    stmt->set_order(column, descending);
+    stmt->set_rows(rows);
+    statements.push_back(stmt);
+    created.emplace(keep(key), stmt);
+    return *stmt;
+}
+
+// Keyed by the sorted tables and by the equalities as '<table>.<column>=<table>.<column>' by name ID,
+// the lower side first and sorted, so positions in the join do not matter
+const sql_statement& sql_statement_factory::create_join_statement(std::span<const name_id> tables, std::span<const join_condition> conditions) {
+    sorted_columns.assign(tables.begin(), tables.end());
+    std::sort(sorted_columns.begin(), sorted_columns.end());
+
+    sorted_equalities.clear();
+    for (const join_condition& condition : conditions) {
+        std::array<name_id, 4> equality{ tables[condition.table], condition.column, tables[condition.other], condition.other_column };
+
+        if (std::pair{ equality[2], equality[3] } < std::pair{ equality[0], equality[1] }) {
+            equality = { equality[2], equality[3], equality[0], equality[1] };
+        }
+
+        sorted_equalities.push_back(equality);
+    }
+
+    std::sort(sorted_equalities.begin(), sorted_equalities.end());
+
+    canonical.clear();
+    for (const auto& equality : sorted_equalities) {
+        canonical += std::to_wstring(equality[0]) + L'.' + std::to_wstring(equality[1]) + L'=' + std::to_wstring(equality[2]) + L'.' + std::to_wstring(equality[3]);
+        canonical += key_separator;
+    }
+
+    statement_key key{ statement_kind::join, sorted_columns.empty() ? name_id{} : sorted_columns.front(), sorted_columns, comparison_operators::equals, canonical };
+    if (const sql_statement* existing{ find_duplicate(key) }) {
+        return *existing;
+    }
+
+    std::pmr::polymorphic_allocator<> allocator{ &arena };
+
+    name_id* joined{ allocator.allocate_object<name_id>(std::max<size_t>(tables.size(), 1)) };
+    std::copy(tables.begin(), tables.end(), joined);
+
+    join_condition* equalities{ allocator.allocate_object<join_condition>(std::max<size_t>(conditions.size(), 1)) };
+    std::copy(conditions.begin(), conditions.end(), equalities);
+
+    auto stmt{ allocator.new_object<join_statement>() };
+    stmt->set_tables({ joined, tables.size() });
+    stmt->set_conditions({ equalities, conditions.size() });
+    statements.push_back(stmt);
+    created.emplace(keep(key), stmt);
+    return *stmt;
+}
+
+size_t sql_statement_factory::templated_count() const {
+    return static_cast<size_t>(std::count_if(statements.begin(), statements.end(), [](const sql_statement* stmt) { return !stmt->parameters().empty(); }));
+}
+
+// The views are taken once the text is complete, so growing the buffer cannot leave them dangling
+rendered_statement sql_statement_factory::render(size_t statement, std::wstring& buffer) const {
+    const sql_statement& stmt{ *statements[statement] };
+
+    buffer.clear();
+    buffer.reserve(stmt.sql_length(names) + stmt.label_length(names) + stmt.template_length(names));
+    stmt.append_sql(buffer, names);
+    size_t label_start{ buffer.size() };
+    stmt.append_label(buffer, names);
+    size_t template_start{ buffer.size() };
+    stmt.append_template(buffer, names);
+
+    std::wstring_view text{ buffer };
+    return rendered_statement{ text.substr(0, label_start), text.substr(label_start, template_start - label_start), text.substr(template_start), stmt.parameters() };
+}
@@ -1,110 +1,228 @@
 #ifndef _SQL_STATEMENT_FACTORY_H
 #define _SQL_STATEMENT_FACTORY_H
 
-#include "sql_statements.h"
+#include <array>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
-/* Type Definitions
-************************************************************************/
-struct row_info;
-struct column_info;
-
-/**
- * @struct field_info
- * @brief A struct that contains information about a database field.
- *
- * @var field_info::value
- * Member 'value' is a wstring that represents the value of a field in the database.
- *
- * @var field_info::row
- * Member 'row' is a shared_ptr to a row_info struct, representing information about the row that this field belongs to.
- *
- * @var field_info::column
- * Member 'column' is a shared_ptr to a column_info struct, representing information about the column that this field belongs to.
- */
-struct field_info {
-    /**
-    * @brief Construct a new field info object.
-    *
-    * @param value The value of the field in the database.
-    * @param row Shared pointer to the row_info struct this field belongs to.
-    * @param column Shared pointer to the column_info struct this field belongs to.
-    */
-    field_info(std::wstring value, std::shared_ptr<row_info> row, std::shared_ptr<column_info> column) :
-        value(value), row(row), column(column) {}
-
-    std::wstring value{};                     ///< Represents the value of a field in the database.
-    std::shared_ptr<row_info> row{};          ///< Shared pointer to the row_info struct this field belongs to.
-    std::shared_ptr<column_info> column{};    ///< Shared pointer to the column_info struct this field belongs to.
+#include "sql_statements.h"
+#include "table_store.h"
+
+// The SQL and label of a statement, as views into the buffer they were rendered to
+struct rendered_statement {
+    std::wstring_view sql{};
+    std::wstring_view label{};
+    std::wstring_view template_sql{};       ///< The SQL with its values replaced by ':1', ':2', ...; empty when it has no parameters.
+    std::span<const statement_parameter> parameters{};  ///< The values bound to the markers, pointing into the factory.
+    size_t table{};                         ///< The table the statement was generated for, when rendered by a sharded_statement_factory.
 };
 
-struct row_info {
-    std::vector<std::shared_ptr<field_info>> fields{};
+// One comparison of a conjunction, before its literal is written
+struct filter_term {
+    name_id column{};
+    const data_type_info* type{};       ///< The type of the column.
+    comparison_operators op{};
+    std::wstring_view value{};          ///< The value to compare against, unquoted; 'IS' compares against it verbatim.
 };
 
-struct column_info {
-
-    column_info(std::wstring name, std::wstring data_type) :
-        name(name), data_type(data_type) {}
+// Defines a class responsible for creating and managing SQL statements
+//
+// Statements, and everything they refer to, are allocated from an arena owned by
+// the factory and released together with it; table and column names are interned
+// once and shared by every statement that uses them.
+//
+// Creating a statement that was already created returns the existing one instead:
+// statements are looked up by a canonical key of their table, sorted columns,
+// operator and value, so duplicates cost a hash lookup and are never rendered.
+class sql_statement_factory {
+    // The canonical form of a statement; its views point into the arena once stored
+    struct statement_key {
+        statement_kind kind{};
+        name_id table{};
+        std::span<const name_id> columns{};     ///< Sorted, so the same columns in another order are the same statement.
+        comparison_operators op{};
+        std::wstring_view value{};
 
-    std::wstring name{}, data_type{};
-};
+        bool operator==(const statement_key& other) const;
+    };
 
-struct table_info {
+    struct statement_key_hash {
+        size_t operator()(const statement_key& key) const;
+    };
 
-    table_info(std::wstring name, std::wstring schema) :
-        name(name), schema(schema) {}
+    // Holds every statement and the memory they refer to; declared first so it is released last
+    std::pmr::monotonic_buffer_resource arena{ 64 * 1024 };
 
-    std::wstring name{}, schema{};
-    std::vector<std::shared_ptr<column_info>> columns{};
-    std::vector<std::shared_ptr<row_info>> rows{};
-};
+    // Holds the table and column names the statements refer to
+    name_pool names{ arena };
 
-// Defines a class responsible for creating and managing SQL statements
-class sql_statement_factory {
     // Holds a list of created SQL statements
-    std::vector<std::shared_ptr<sql_statement>> statements{};
+    std::vector<const sql_statement*> statements{};
+
+    // Maps the canonical form of every created statement to it
+    std::unordered_map<statement_key, const sql_statement*, statement_key_hash> created{};
+    std::vector<name_id> sorted_columns{};  ///< Scratch space for the key of a select statement.
+    std::vector<filter_term> sorted_terms{};    ///< Scratch space for the key of a conjunction.
+    std::vector<std::wstring_view> sorted_values{}; ///< Scratch space for the key of an IN list.
+    std::vector<std::array<name_id, 4>> sorted_equalities{};   ///< Scratch space for the key of a join.
+    std::wstring canonical{};               ///< Scratch space for the values of a key.
+    size_t duplicates{};
+
+    // Copies text into the arena
+    std::wstring_view store(std::wstring_view text);
+
+    // Copies the columns and value of a key into the arena, so it can outlive the scratch space it was built in
+    statement_key keep(statement_key key);
+
+    // Returns the literal of a value and the parameter bound in its place, both copied into the arena
+    std::pair<std::wstring_view, statement_parameter> store_value(const data_type_info& type, std::wstring_view value);
+
+    // Returns the statement created with a key, counting the duplicate, or nullptr if there is none
+    const sql_statement* find_duplicate(const statement_key& key);
 
 public:
 
+    sql_statement_factory() = default;
+    sql_statement_factory(const sql_statement_factory&) = delete;
+    sql_statement_factory& operator=(const sql_statement_factory&) = delete;
+
+    /**
+     * @brief Interns a table or column name.
+     *
+     * @param name : The name, e.g. a schema qualified table name.
+     * @return The ID to create statements with.
+     */
+    name_id intern(std::wstring_view name) { return names.intern(name); }
+
+    /**
+     * @brief Returns the names the statements refer to.
+     */
+    const name_pool& interned_names() const { return names; }
+
     /**
      * @brief Creates a SELECT SQL statement for specified columns from a table.
      *
-     * @param table : The name of the table to select from.
-     * @param columns : The names of the columns to select.
-     * @return A shared pointer to the created SQL statement.
+     * Columns are compared as a set, so selecting the same columns in another order
+     * returns the statement created first.
+     *
+     * @param table : The interned name of the table to select from.
+     * @param columns : The interned names of the columns to select; copied into the arena.
+     * @return The created SQL statement, valid as long as the factory.
      */
-    std::shared_ptr<sql_statement> create_select_statement(const std::wstring& table, const std::vector<std::wstring>& columns);
+    const sql_statement& create_select_statement(name_id table, std::span<const name_id> columns);
 
     /**
      * @brief Creates a SELECT * (all) SQL statement from a table.
      *
-     * @param table : The name of the table to select from.
-     * @return A shared pointer to the created SQL statement.
+     * @param table : The interned name of the table to select from.
+     * @return The created SQL statement, valid as long as the factory.
      */
-    std::shared_ptr<sql_statement> create_select_all_statement(const std::wstring& table);
+    const sql_statement& create_select_all_statement(name_id table);
 
-    std::shared_ptr<sql_statement> create_filter_statement(const std::wstring& table, const std::wstring& column, const std::wstring& operation, const std::wstring& value);
+    /**
+     * @brief Creates a 'SELECT * FROM <table> WHERE <column> <op> <value>' SQL statement.
+     *
+     * The value is written as a literal of the column type and is also bound, as is,
+     * to the parameter of the statement's template. 'IS' compares against the value
+     * verbatim, such as 'NULL', and has no parameter.
+     *
+     * @param table : The interned name of the table to select from.
+     * @param column : The interned name of the column to filter on.
+     * @param type : The type of the column.
+     * @param operation : The comparison operator.
+     * @param value : The value to compare against, unquoted; copied into the arena.
+     * @return The created SQL statement, valid as long as the factory.
+     */
+    const sql_statement& create_filter_statement(name_id table, name_id column, const data_type_info& type, comparison_operators operation, std::wstring_view value);
+
+    /**
+     * @brief Creates a 'SELECT * FROM <table> WHERE <term1> AND <term2> ...' SQL statement.
+     *
+     * Terms are compared as a set, so the same terms in another order return the
+     * statement created first. Every term other than 'IS' is bound to a parameter.
+     *
+     * @param table : The interned name of the table to select from.
+     * @param terms : The comparisons, on distinct columns; the values are copied into the arena.
+     * @return The created SQL statement, valid as long as the factory.
+     */
+    const sql_statement& create_conjunction_statement(name_id table, std::span<const filter_term> terms);
+
+    /**
+     * @brief Creates a 'SELECT * FROM <table> WHERE <column> BETWEEN <low> AND <high>' SQL statement.
+     *
+     * @param table : The interned name of the table to select from.
+     * @param column : The interned name of the column to filter on.
+     * @param type : The type of the column.
+     * @param low : The low bound, unquoted; copied into the arena.
+     * @param high : The high bound, unquoted; copied into the arena.
+     * @return The created SQL statement, valid as long as the factory.
+     */
+    const sql_statement& create_range_statement(name_id table, name_id column, const data_type_info& type, std::wstring_view low, std::wstring_view high);
+
+    /**
+     * @brief Creates a 'SELECT * FROM <table> WHERE <column> IN (<value1>, ...)' SQL statement.
+     *
+     * The values are listed sorted and without repeats, so lists of the same values
+     * return the statement created first.
+     *
+     * @param table : The interned name of the table to select from.
+     * @param column : The interned name of the column to filter on.
+     * @param type : The type of the column.
+     * @param values : The values, unquoted; must not be empty; copied into the arena.
+     * @return The created SQL statement, valid as long as the factory.
+     */
+    const sql_statement& create_in_list_statement(name_id table, name_id column, const data_type_info& type, std::span<const std::wstring_view> values);
 
     /**
-     * @brief Generates all created SQL statements and their corresponding labels.
-     * 
-     * @return Vector of wstring each of which is a SQL statement or label.
+     * @brief Creates a 'SELECT TOP (<rows>) * FROM <table> ORDER BY <column>' SQL statement.
+     *
+     * @param table : The interned name of the table to select from.
+     * @param column : The interned name of the column to order by.
+     * @param rows : The number of rows to read.
+     * @param descending : Orders from the highest value down.
+     * @return The created SQL statement, valid as long as the factory.
      */
-    std::vector<std::wstring> generate_all();
+    const sql_statement& create_top_statement(name_id table, name_id column, uint32_t rows, bool descending);
 
     /**
-     * @brief Generates all created SQL statements.
+     * @brief Creates a 'SELECT * FROM <table1> AS t0 JOIN <table2> AS t1 ON ...' SQL statement.
+     *
+     * Joins are compared by the tables and equalities they join on, so the same join
+     * with its tables in another order returns the statement created first.
      *
-     * @return Vector of wstring each of which is a SQL statement.
+     * @param tables : The interned names of the tables, distinct and in join order; copied into the arena.
+     * @param conditions : The equalities, grouped by table, at least one for every table after the first; copied into the arena.
+     * @return The created SQL statement, valid as long as the factory.
+     */
+    const sql_statement& create_join_statement(std::span<const name_id> tables, std::span<const join_condition> conditions);
+
+    /**
+     * @brief Returns the number of created SQL statements, without duplicates.
+     */
+    size_t size() const { return statements.size(); }
+
+    /**
+     * @brief Returns the number of create calls that returned an existing statement.
+     */
+    size_t duplicates_removed() const { return duplicates; }
+
+    /**
+     * @brief Returns the number of created SQL statements that have a template.
      */
-    std::vector<std::wstring> generate_all_sql();
+    size_t templated_count() const;
 
     /**
-     * @brief Generates all created SQL statements' labels.
+     * @brief Renders the SQL, label and template of one statement into a buffer.
      *
-     * @return Vector of wstring each of which is a label.
+     * @param statement : The position of the statement in creation order.
+     * @param buffer : Replaced with the text; the views point into it, so it must outlive them and not be modified.
+     * @return The rendered statement.
      */
-    std::vector<std::wstring> generate_all_labels();
+    rendered_statement render(size_t statement, std::wstring& buffer) const;
 };
 
-#endif // !_SQL_STATEMENT_FACTORY_H
\ No newline at end of file
+#endif // !_SQL_STATEMENT_FACTORY_H
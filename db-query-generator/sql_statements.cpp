@@ -1,73 +1,121 @@
 #include "sql_statements.h"
 #include <iostream>
 
-const wchar_t* operator_to_string(std::wstring op) {
-    if (op == L"=") {
-        return L"EQUALS";
-    }
-    if (op == L"!=") {
-        return L"NOT_EQUALS";
-    }
-    if (op == L">") {
-        return L"GREATER";
-    }
-    if (op == L"<") {
-        return L"LESS";
-    }
-    if (op == L">=") {
-        return L"GREATER_EQUALS";
+using namespace std::literals;
+
+// Returns the number of decimal digits of a number
+static size_t digit_count(size_t number) {
+    size_t count{ 1 };
+
+    for (; number >= 10; number /= 10) {
+        count++;
     }
-    if (op == L"<=") {
-        return L"LESS_EQUALS";
+
+    return count;
+}
+
+static void append_number(std::wstring& out, size_t number) {
+    size_t first{ out.size() };
+    out.append(digit_count(number), L'0');
+
+    for (size_t i{ out.size() }; i > first; i--, number /= 10) {
+        out[i - 1] = static_cast<wchar_t>(L'0' + number % 10);
     }
+}
+
+// Appends the ':<number>' marker of a parameter
+static void append_marker(std::wstring& out, size_t number) {
+    out += L':';
+    append_number(out, number);
+}
 
-    return L"UNKNOWN";
+static size_t marker_length(size_t number) {
+    return 1 + digit_count(number);
 }
 
+// --------------------
+// START OF STATEMENT FUNCTIONS
+// --------------------
+
+// Generates the SQL into a string sized for it
+std::wstring sql_statement::generate_sql(const name_pool& names) const {
+    std::wstring sql{};
+    sql.reserve(sql_length(names));
+    append_sql(sql, names);
+    return sql;
+}
+
+// Generates the label into a string sized for it
+std::wstring sql_statement::generate_label(const name_pool& names) const {
+    std::wstring label{};
+    label.reserve(label_length(names));
+    append_label(label, names);
+    return label;
+}
+
+// --------------------
+// END OF STATEMENT FUNCTIONS
+// --------------------
 // --------------------
 // START OF SELECT FUNCTIONS
 // --------------------
 
 // Sets the table name for the select statement
-void select_statement::set_table(const std::wstring& table) {
+void select_statement::set_table(name_id table) {
     this->table = table; // 'this->table' refers to the class's table member
 }
 
-// Adds the list of columns to the select statement
-void select_statement::add_columns(const std::vector<std::wstring>& new_columns) {
-    for (const auto& column : new_columns) {
-        columns.emplace_back(column); // Adds each column to the columns vector
-    }
+// Sets the list of columns of the select statement
+void select_statement::set_columns(std::span<const name_id> columns) {
+    this->columns = columns;
 }
 
-// Generates the SQL select statement
-std::wstring select_statement::generate_sql() const {
-    std::wostringstream ss{};
-    ss << L"SELECT ";
+// Appends 'SELECT <column1>, ... FROM <table>;'
+void select_statement::append_sql(std::wstring& out, const name_pool& names) const {
+    out += L"SELECT "sv;
 
     // Loop through each column
     for (size_t i{}; i < columns.size(); i++) {
-        ss << columns[i]; // Add the column name to the string stream
-        if (i != columns.size() - 1) ss << L", "; // Add a comma separator unless it's the last column
+        out += names[columns[i]]; // Add the column name
+        if (i != columns.size() - 1) out += L", "sv; // Add a comma separator unless it's the last column
     }
 
-    ss << L" FROM " + table + L";"; // Add the table name
-
-    return ss.str();
+    out += L" FROM "sv; // Add the table name
+    out += names[table];
+    out += L';';
 }
 
-std::wstring select_statement::generate_label() const {
-    std::wostringstream ss{};
-
-    ss << L"select_" + table + L'_';
+// Appends 'select_<table>_<column1>_...'
+void select_statement::append_label(std::wstring& out, const name_pool& names) const {
+    out += L"select_"sv;
+    out += names[table];
+    out += L'_';
 
     // Loop through each column
     for (size_t i{}; i < columns.size(); i++) {
-        ss << columns[i];
-        if (i != columns.size() - 1) ss << L'_'; // Add a underscore separator unless it's the last column
+        out += names[columns[i]];
+        if (i != columns.size() - 1) out += L'_'; // Add a underscore separator unless it's the last column
+    }
+}
+
+size_t select_statement::sql_length(const name_pool& names) const {
+    size_t length{ L"SELECT "sv.size() + L" FROM "sv.size() + names[table].size() + 1 };
+
+    for (name_id column : columns) {
+        length += names[column].size();
     }
 
-    return ss.str();
+    return columns.empty() ? length : length + (columns.size() - 1) * L", "sv.size();
+}
+
+size_t select_statement::label_length(const name_pool& names) const {
+    size_t length{ L"select_"sv.size() + names[table].size() + 1 };
+
+    for (name_id column : columns) {
+        length += names[column].size();
+    }
+
+    return columns.empty() ? length : length + columns.size() - 1;
 }
 
 // --------------------
@@ -78,25 +126,29 @@ std::wstring select_statement::generate_label() const {
 // --------------------
 
 // Sets the table name for the select all statement
-void select_all_statement::set_table(const std::wstring& table) {
+void select_all_statement::set_table(name_id table) {
     this->table = table;
 }
 
-// Generates the SQL select all statement
-std::wstring select_all_statement::generate_sql() const {
-    std::wostringstream ss{};
-
-    ss << L"SELECT * FROM " << table << L";"; // Add the table name
-
-    return ss.str();
+// Appends 'SELECT * FROM <table>;'
+void select_all_statement::append_sql(std::wstring& out, const name_pool& names) const {
+    out += L"SELECT * FROM "sv;
+    out += names[table]; // Add the table name
+    out += L';';
 }
 
-std::wstring select_all_statement::generate_label() const {
-    std::wostringstream ss{};
+// Appends 'select_all_<table>'
+void select_all_statement::append_label(std::wstring& out, const name_pool& names) const {
+    out += L"select_all_"sv;
+    out += names[table];
+}
 
-    ss << L"select_all_" + table;
+size_t select_all_statement::sql_length(const name_pool& names) const {
+    return L"SELECT * FROM "sv.size() + names[table].size() + 1;
+}
 
-    return ss.str();
+size_t select_all_statement::label_length(const name_pool& names) const {
+    return L"select_all_"sv.size() + names[table].size();
 }
 
 // --------------------
@@ -106,38 +158,432 @@ std::wstring select_all_statement::generate_label() const {
 // START OF FILTER FUNCTIONS
 // --------------------
 
-void filter_statement::set_table(const std::wstring& table) {
+void filter_statement::set_table(name_id table) {
     this->table = table;
 }
 
-void filter_statement::set_column(const std::wstring& column) {
+void filter_statement::set_column(name_id column) {
     this->column = column;
 }
 
-void filter_statement::set_operation(const std::wstring& op) {
+void filter_statement::set_operation(comparison_operators op) {
     this->op = op;
 }
 
-void filter_statement::set_value(const std::wstring& value) {
+void filter_statement::set_value(std::wstring_view value) {
     this->value = value;
 }
 
-std::wstring filter_statement::generate_sql() const {
-    std::wostringstream ss{};
+void filter_statement::set_parameter(statement_parameter parameter) {
+    bound = parameter;
+}
+
+// Appends 'SELECT * FROM <table> WHERE <column> <op> <compared>;'
+void filter_statement::append_filter(std::wstring& out, const name_pool& names, std::wstring_view compared) const {
+    out += L"SELECT * FROM "sv;
+    out += names[table];
+    out += L" WHERE "sv;
+    out += names[column];
+    out += L' ';
+    out += comparison_sql(op);
+    out += L' ';
+    out += compared;
+    out += L';';
+}
 
-    ss << L"SELECT * FROM " + table + L" WHERE " + column + L' ' + op + L' ' + value + L';'; // Add the table name
+void filter_statement::append_sql(std::wstring& out, const name_pool& names) const {
+    append_filter(out, names, value);
+}
 
-    return ss.str();
-};
+void filter_statement::append_template(std::wstring& out, const name_pool& names) const {
+    if (bound.type) {
+        append_filter(out, names, L":1"sv);
+    }
+}
 
-std::wstring filter_statement::generate_label() const {
-    std::wostringstream ss{};
+void filter_statement::append_label(std::wstring& out, const name_pool& names) const {
+    out += L"filter_statement"sv;
+}
 
-    ss << L"filter_statement";
+size_t filter_statement::sql_length(const name_pool& names) const {
+    return L"SELECT * FROM "sv.size() + names[table].size() + L" WHERE "sv.size() + names[column].size() + comparison_sql(op).size() + value.size() + 3;
+}
 
-    return ss.str();
+size_t filter_statement::label_length(const name_pool& names) const {
+    return L"filter_statement"sv.size();
+}
+
+size_t filter_statement::template_length(const name_pool& names) const {
+    return bound.type ? sql_length(names) - value.size() + L":1"sv.size() : 0;
 }
 
 // --------------------
 // END OF FILTER FUNCTIONS
-// --------------------
\ No newline at end of file
+// --------------------
+// --------------------
+// START OF CONJUNCTION FUNCTIONS
+// --------------------
+
+void conjunction_statement::set_table(name_id table) {
+    this->table = table;
+}
+
+void conjunction_statement::set_predicates(std::span<const column_predicate> predicates) {
+    this->predicates = predicates;
+}
+
+void conjunction_statement::set_parameters(std::span<const statement_parameter> parameters) {
+    bound = parameters;
+}
+
+// Appends '<column1> <op1> <value1> AND ...', numbering the markers in place of values other than those of 'IS'
+void conjunction_statement::append_predicates(std::wstring& out, const name_pool& names, bool markers) const {
+    size_t marker{};
+
+    for (size_t i{}; i < predicates.size(); i++) {
+        const column_predicate& predicate{ predicates[i] };
+
+        if (i) {
+            out += L" AND "sv;
+        }
+
+        out += names[predicate.column];
+        out += L' ';
+        out += comparison_sql(predicate.op);
+        out += L' ';
+
+        if (markers && predicate.op != comparison_operators::is) {
+            append_marker(out, ++marker);
+        }
+        else {
+            out += predicate.value;
+        }
+    }
+}
+
+size_t conjunction_statement::predicates_length(const name_pool& names, bool markers) const {
+    size_t length{ predicates.empty() ? 0 : (predicates.size() - 1) * L" AND "sv.size() };
+    size_t marker{};
+
+    for (const column_predicate& predicate : predicates) {
+        length += names[predicate.column].size() + comparison_sql(predicate.op).size() + 2;
+        length += markers && predicate.op != comparison_operators::is ? marker_length(++marker) : predicate.value.size();
+    }
+
+    return length;
+}
+
+// Appends 'SELECT * FROM <table> WHERE <column1> <op1> <value1> AND ...;'
+void conjunction_statement::append_sql(std::wstring& out, const name_pool& names) const {
+    out += L"SELECT * FROM "sv;
+    out += names[table];
+    out += L" WHERE "sv;
+    append_predicates(out, names, false);
+    out += L';';
+}
+
+void conjunction_statement::append_label(std::wstring& out, const name_pool& names) const {
+    out += L"conjunction_statement"sv;
+}
+
+void conjunction_statement::append_template(std::wstring& out, const name_pool& names) const {
+    if (bound.empty()) {
+        return;
+    }
+
+    out += L"SELECT * FROM "sv;
+    out += names[table];
+    out += L" WHERE "sv;
+    append_predicates(out, names, true);
+    out += L';';
+}
+
+size_t conjunction_statement::sql_length(const name_pool& names) const {
+    return L"SELECT * FROM "sv.size() + names[table].size() + L" WHERE "sv.size() + predicates_length(names, false) + 1;
+}
+
+size_t conjunction_statement::label_length(const name_pool& names) const {
+    return L"conjunction_statement"sv.size();
+}
+
+size_t conjunction_statement::template_length(const name_pool& names) const {
+    return bound.empty() ? 0 : L"SELECT * FROM "sv.size() + names[table].size() + L" WHERE "sv.size() + predicates_length(names, true) + 1;
+}
+
+// --------------------
+// END OF CONJUNCTION FUNCTIONS
+// --------------------
+// --------------------
+// START OF RANGE FUNCTIONS
+// --------------------
+
+void range_statement::set_table(name_id table) {
+    this->table = table;
+}
+
+void range_statement::set_column(name_id column) {
+    this->column = column;
+}
+
+void range_statement::set_bounds(std::wstring_view low, std::wstring_view high, std::span<const statement_parameter> parameters) {
+    this->low = low;
+    this->high = high;
+    bound = parameters;
+}
+
+// Appends 'SELECT * FROM <table> WHERE <column> BETWEEN <from> AND <to>;'
+void range_statement::append_range(std::wstring& out, const name_pool& names, std::wstring_view from, std::wstring_view to) const {
+    out += L"SELECT * FROM "sv;
+    out += names[table];
+    out += L" WHERE "sv;
+    out += names[column];
+    out += L" BETWEEN "sv;
+    out += from;
+    out += L" AND "sv;
+    out += to;
+    out += L';';
+}
+
+void range_statement::append_sql(std::wstring& out, const name_pool& names) const {
+    append_range(out, names, low, high);
+}
+
+void range_statement::append_label(std::wstring& out, const name_pool& names) const {
+    out += L"range_statement"sv;
+}
+
+void range_statement::append_template(std::wstring& out, const name_pool& names) const {
+    if (!bound.empty()) {
+        append_range(out, names, L":1"sv, L":2"sv);
+    }
+}
+
+size_t range_statement::sql_length(const name_pool& names) const {
+    return L"SELECT * FROM "sv.size() + names[table].size() + L" WHERE "sv.size() + names[column].size()
+        + L" BETWEEN "sv.size() + low.size() + L" AND "sv.size() + high.size() + 1;
+}
+
+size_t range_statement::label_length(const name_pool& names) const {
+    return L"range_statement"sv.size();
+}
+
+size_t range_statement::template_length(const name_pool& names) const {
+    return bound.empty() ? 0 : sql_length(names) - low.size() - high.size() + L":1"sv.size() + L":2"sv.size();
+}
+
+// --------------------
+// END OF RANGE FUNCTIONS
+// --------------------
+// --------------------
+// START OF IN LIST FUNCTIONS
+// --------------------
+
+void in_list_statement::set_table(name_id table) {
+    this->table = table;
+}
+
+void in_list_statement::set_column(name_id column) {
+    this->column = column;
+}
+
+void in_list_statement::set_values(std::span<const std::wstring_view> values, std::span<const statement_parameter> parameters) {
+    this->values = values;
+    bound = parameters;
+}
+
+// Appends 'SELECT * FROM <table> WHERE <column> IN (<value1>, ...);', with markers in place of the values if asked to
+void in_list_statement::append_list(std::wstring& out, const name_pool& names, bool markers) const {
+    out += L"SELECT * FROM "sv;
+    out += names[table];
+    out += L" WHERE "sv;
+    out += names[column];
+    out += L" IN ("sv;
+
+    for (size_t i{}; i < values.size(); i++) {
+        if (i) {
+            out += L", "sv;
+        }
+
+        if (markers) {
+            append_marker(out, i + 1);
+        }
+        else {
+            out += values[i];
+        }
+    }
+
+    out += L");"sv;
+}
+
+size_t in_list_statement::list_length(const name_pool& names, bool markers) const {
+    size_t length{ L"SELECT * FROM "sv.size() + names[table].size() + L" WHERE "sv.size() + names[column].size() + L" IN ("sv.size() + L");"sv.size() };
+
+    for (size_t i{}; i < values.size(); i++) {
+        length += (i ? L", "sv.size() : 0) + (markers ? marker_length(i + 1) : values[i].size());
+    }
+
+    return length;
+}
+
+void in_list_statement::append_sql(std::wstring& out, const name_pool& names) const {
+    append_list(out, names, false);
+}
+
+void in_list_statement::append_label(std::wstring& out, const name_pool& names) const {
+    out += L"in_list_statement"sv;
+}
+
+void in_list_statement::append_template(std::wstring& out, const name_pool& names) const {
+    if (!bound.empty()) {
+        append_list(out, names, true);
+    }
+}
+
+size_t in_list_statement::sql_length(const name_pool& names) const {
+    return list_length(names, false);
+}
+
+size_t in_list_statement::label_length(const name_pool& names) const {
+    return L"in_list_statement"sv.size();
+}
+
+size_t in_list_statement::template_length(const name_pool& names) const {
+    return bound.empty() ? 0 : list_length(names, true);
+}
+
+// --------------------
+// END OF IN LIST FUNCTIONS
+// --------------------
+// --------------------
+// START OF TOP FUNCTIONS
+// --------------------
+
+void top_statement::set_table(name_id table) {
+    this->table = table;
+}
+
+void top_statement::set_order(name_id column, bool descending) {
+    this->column = column;
+    this->descending = descending;
+}
+
+void top_statement::set_rows(uint32_t rows) {
+    this->rows = rows;
+}
+
+// Appends 'SELECT TOP (<rows>) * FROM <table> ORDER BY <column> [DESC];'
+void top_statement::append_sql(std::wstring& out, const name_pool& names) const {
+    out += L"SELECT TOP ("sv;
+    append_number(out, rows);
+    out += L") * FROM "sv;
+    out += names[table];
+    out += L" ORDER BY "sv;
+    out += names[column];
+
+    if (descending) {
+        out += L" DESC"sv;
+    }
+
+    out += L';';
+}
+
+void top_statement::append_label(std::wstring& out, const name_pool& names) const {
+    out += L"top_statement"sv;
+}
+
+size_t top_statement::sql_length(const name_pool& names) const {
+    return L"SELECT TOP ("sv.size() + digit_count(rows) + L") * FROM "sv.size() + names[table].size()
+        + L" ORDER BY "sv.size() + names[column].size() + (descending ? L" DESC"sv.size() : 0) + 1;
+}
+
+size_t top_statement::label_length(const name_pool& names) const {
+    return L"top_statement"sv.size();
+}
+
+// --------------------
+// END OF TOP FUNCTIONS
+// --------------------
+// --------------------
+// START OF JOIN FUNCTIONS
+// --------------------
+
+void join_statement::set_tables(std::span<const name_id> tables) {
+    this->tables = tables;
+}
+
+void join_statement::set_conditions(std::span<const join_condition> conditions) {
+    this->conditions = conditions;
+}
+
+// Appends 't<position>.<column>'
+static void append_aliased(std::wstring& out, const name_pool& names, size_t position, name_id column) {
+    out += L't';
+    append_number(out, position);
+    out += L'.';
+    out += names[column];
+}
+
+static size_t aliased_length(const name_pool& names, size_t position, name_id column) {
+    return 2 + digit_count(position) + names[column].size();
+}
+
+// Appends 'SELECT * FROM <table1> AS t0 JOIN <table2> AS t1 ON t1.<column> = t0.<column> [AND ...] ...;'
+void join_statement::append_sql(std::wstring& out, const name_pool& names) const {
+    out += L"SELECT * FROM "sv;
+
+    for (size_t i{}; i < tables.size(); i++) {
+        if (i) {
+            out += L" JOIN "sv;
+        }
+
+        out += names[tables[i]];
+        out += L" AS t"sv;
+        append_number(out, i);
+
+        bool first{ true };
+        for (const join_condition& condition : conditions) {
+            if (condition.table != i) {
+                continue;
+            }
+
+            out += first ? L" ON "sv : L" AND "sv;
+            first = false;
+
+            append_aliased(out, names, condition.table, condition.column);
+            out += L" = "sv;
+            append_aliased(out, names, condition.other, condition.other_column);
+        }
+    }
+
+    out += L';';
+}
+
+void join_statement::append_label(std::wstring& out, const name_pool& names) const {
+    out += L"join_statement"sv;
+}
+
+size_t join_statement::sql_length(const name_pool& names) const {
+    size_t length{ L"SELECT * FROM "sv.size() + 1 };
+
+    for (size_t i{}; i < tables.size(); i++) {
+        length += (i ? L" JOIN "sv.size() : 0) + names[tables[i]].size() + L" AS t"sv.size() + digit_count(i);
+    }
+
+    // The first condition of a table follows ' ON ', the others ' AND '
+    for (size_t i{}; i < conditions.size(); i++) {
+        const join_condition& condition{ conditions[i] };
+
+        length += (i && conditions[i - 1].table == condition.table ? L" AND "sv.size() : L" ON "sv.size())
+            + aliased_length(names, condition.table, condition.column) + L" = "sv.size() + aliased_length(names, condition.other, condition.other_column);
+    }
+
+    return length;
+}
+
+size_t join_statement::label_length(const name_pool& names) const {
+    return L"join_statement"sv.size();
+}
+
+// --------------------
+// END OF JOIN FUNCTIONS
+// --------------------
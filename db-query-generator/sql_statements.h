@@ -1,134 +1,435 @@
 #ifndef _SQL_STATEMENTS_H
 #define _SQL_STATEMENTS_H
 
+#include <cstdint>
 #include <string>
-#include <vector>
-#include <sstream>
-#include <memory>
+#include <string_view>
+#include <span>
+
+#include "data_types.h"
+#include "name_pool.h"
+
+// The kinds of statements the factory creates
+enum struct statement_kind : uint8_t {
+	select_all,
+	select,
+	filter,
+	conjunction,
+	range,
+	in_list,
+	top,
+	join
+};
+
+constexpr size_t statement_kind_count{ static_cast<size_t>(statement_kind::join) + 1 };
+
+// The value a parameterized statement binds to one of its ':<n>' markers, unquoted, and the type it is bound as
+struct statement_parameter {
+	std::wstring_view value{};
+	const data_type_info* type{};	///< Null when the statement has no parameter.
+};
+
+// A comparison of a column against a literal, one of the terms of a conjunction
+struct column_predicate {
+	name_id column{};
+	comparison_operators op{};
+	std::wstring_view value{};		///< The literal, or what 'IS' compares against verbatim.
+};
+
+// An equality of a join: a column of a table against a column of a table joined before it
+struct join_condition {
+	uint32_t table{};				///< The position of the table in the join.
+	uint32_t other{};				///< The position of the earlier table.
+	name_id column{}, other_column{};
+};
 
 // Base class for SQL statements
+//
+// Statements only refer to their names by ID and to memory owned by the
+// sql_statement_factory that created them, so they are trivially destructible
+// and freed all at once with the factory's arena.
 class sql_statement {
 public:
 
-	// Pure virtual function for generating SQL
-	virtual std::wstring generate_sql() const = 0;
-	virtual std::wstring generate_label() const = 0;
+	// Appends the SQL of the statement to a buffer
+	virtual void append_sql(std::wstring& out, const name_pool& names) const = 0;
+	virtual void append_label(std::wstring& out, const name_pool& names) const = 0;
+
+	// Returns the exact number of characters append_sql and append_label add
+	virtual size_t sql_length(const name_pool& names) const = 0;
+	virtual size_t label_length(const name_pool& names) const = 0;
+
+	// Appends the SQL with its values replaced by the ':1', ':2', ... parameter markers; statements without parameters append nothing
+	virtual void append_template(std::wstring& out, const name_pool& names) const {}
+	virtual size_t template_length(const name_pool& names) const { return 0; }
+
+	// Returns the values bound to the markers of the template, in marker order
+	virtual std::span<const statement_parameter> parameters() const { return {}; }
+
+	/**
+	 * @brief Generates the SQL of the statement into a string of its own.
+	 *
+	 * @param names : The pool the names were interned in.
+	 */
+	std::wstring generate_sql(const name_pool& names) const;
+
+	/**
+	 * @brief Generates the label of the statement into a string of its own.
+	 *
+	 * @param names : The pool the names were interned in.
+	 */
+	std::wstring generate_label(const name_pool& names) const;
 
 };
 
 // Class for select SQL statements
 class select_statement : public sql_statement {
-	std::wstring table{}; // Name of the table to select from
-	std::vector<std::wstring> columns{}; // Names of the columns to select
+	name_id table{}; // Name of the table to select from
+	std::span<const name_id> columns{}; // Names of the columns to select
 
 public:
 
 	/**
 	 * @brief Sets the name of the table for the 'SELECT' statement.
 	 *
-	 * @param table : The name of the table.
+	 * @param table : The ID of the qualified table name.
 	 */
-	void set_table(const std::wstring& table);
+	void set_table(name_id table);
 
 	/**
-	 * @brief Adds column names for the 'SELECT' statement.
+	 * @brief Sets the column names for the 'SELECT' statement.
 	 *
-	 * @param new_columns : A vector of column names.
+	 * @param columns : The IDs of the column names; must outlive the statement.
 	 */
-	void add_columns(const std::vector<std::wstring>& new_columns);
+	void set_columns(std::span<const name_id> columns);
 
 	/**
-	 * @brief Generates a 'SELECT <column1>, ... FROM <table>' statement.
+	 * @brief Appends a 'SELECT <column1>, ... FROM <table>;' SQL statement.
 	 *
-	 * @return The generated SQL statement as a string.
+	 * @param out : The buffer to append to.
+	 * @param names : The pool the names were interned in.
 	 */
-	std::wstring generate_sql() const override;
+	void append_sql(std::wstring& out, const name_pool& names) const override;
 
 	/**
-	 * @brief Generates a label for a 'SELECT' statement.
+	 * @brief Appends the label of a 'SELECT' statement.
 	 *
-	 * @return The generated label as a string.
+	 * @param out : The buffer to append to.
+	 * @param names : The pool the names were interned in.
 	 */
-	std::wstring generate_label() const override;
+	void append_label(std::wstring& out, const name_pool& names) const override;
+
+	size_t sql_length(const name_pool& names) const override;
+	size_t label_length(const name_pool& names) const override;
 };
 
 // Class for select all (*) SQL statements
 class select_all_statement : public sql_statement {
-	std::wstring table{}; // Name of the table to select from
+	name_id table{}; // Name of the table to select from
 
 public:
 
 	/**
 	 * @brief Sets the name of the table for the 'SELECT ALL' statement.
 	 *
-	 * @param table : The name of the table.
+	 * @param table : The ID of the qualified table name.
 	 */
-	void set_table(const std::wstring& table);
+	void set_table(name_id table);
 
 	/**
-	 * @brief Generates a 'SELECT * FROM <table>' SQL statement.
+	 * @brief Appends a 'SELECT * FROM <table>;' SQL statement.
 	 *
-	 * @return The generated SQL statement as a string.
+	 * @param out : The buffer to append to.
+	 * @param names : The pool the names were interned in.
 	 */
-	std::wstring generate_sql() const override;
+	void append_sql(std::wstring& out, const name_pool& names) const override;
 
 	/**
-	 * @brief Generates a label for a 'SELECT ALL' statement.
+	 * @brief Appends the label of a 'SELECT ALL' statement.
 	 *
-	 * @return The generated label as a string.
+	 * @param out : The buffer to append to.
+	 * @param names : The pool the names were interned in.
 	 */
-	std::wstring generate_label() const override;
+	void append_label(std::wstring& out, const name_pool& names) const override;
+
+	size_t sql_length(const name_pool& names) const override;
+	size_t label_length(const name_pool& names) const override;
 };
 
 class filter_statement : public sql_statement {
-	std::wstring table{};
-	std::wstring column{};
-	std::wstring op{};
-	std::wstring value{};
+	name_id table{};
+	name_id column{};
+	comparison_operators op{};
+	std::wstring_view value{};
+	statement_parameter bound{};
+
+	void append_filter(std::wstring& out, const name_pool& names, std::wstring_view compared) const;
 
 public:
 
 	/**
       * @brief Sets the name of the table for the 'FILTER' statement.
       *
-      * @param table : The name of the table.
+      * @param table : The ID of the qualified table name.
       */
-	void set_table(const std::wstring& table);
+	void set_table(name_id table);
 
 	/**
       * @brief Sets the name of the column for the 'FILTER' statement.
       *
-      * @param column : The name of the column.
+      * @param column : The ID of the column name.
       */
-	void set_column(const std::wstring& column);
+	void set_column(name_id column);
 
 	/**
 	 * @brief Sets the operation for the 'FILTER' statement.
 	 *
-	 * @param column : The operator e.g. (=, <, >, etc.).
+	 * @param op : The comparison operator.
 	 */
-	void set_operation(const std::wstring& op);
+	void set_operation(comparison_operators op);
 
 	/**
 	 * @brief Sets the value for the 'FILTER' statement.
 	 *
-	 * @param column : The value to filter against.
+	 * @param value : The value to filter against; must outlive the statement.
+	 */
+	void set_value(std::wstring_view value);
+
+	/**
+	 * @brief Sets the value bound to the parameter of the template, unquoted.
+	 *
+	 * @param parameter : The value and the type of the column; the value must outlive the statement.
+	 */
+	void set_parameter(statement_parameter parameter);
+
+	/**
+	 * @brief Appends a 'SELECT * FROM <table> WHERE <column> <op> <value>;' SQL statement.
+	 *
+	 * @param out : The buffer to append to.
+	 * @param names : The pool the names were interned in.
+	 */
+	void append_sql(std::wstring& out, const name_pool& names) const override;
+
+	/**
+	 * @brief Appends the label of a 'FILTER' statement.
+	 *
+	 * @param out : The buffer to append to.
+	 * @param names : The pool the names were interned in.
+	 */
+	void append_label(std::wstring& out, const name_pool& names) const override;
+
+	/**
+	 * @brief Appends a 'SELECT * FROM <table> WHERE <column> <op> :1;' template, if a parameter was set.
+	 *
+	 * @param out : The buffer to append to.
+	 * @param names : The pool the names were interned in.
+	 */
+	void append_template(std::wstring& out, const name_pool& names) const override;
+
+	size_t sql_length(const name_pool& names) const override;
+	size_t label_length(const name_pool& names) const override;
+	size_t template_length(const name_pool& names) const override;
+	std::span<const statement_parameter> parameters() const override { return { &bound, bound.type ? size_t{ 1 } : size_t{ 0 } }; }
+};
+
+// Class for filters on several columns at once, joined with AND
+class conjunction_statement : public sql_statement {
+	name_id table{};
+	std::span<const column_predicate> predicates{};
+	std::span<const statement_parameter> bound{};	///< One per predicate other than 'IS', in predicate order.
+
+public:
+
+	/**
+	 * @brief Sets the name of the table for the conjunction.
+	 *
+	 * @param table : The ID of the qualified table name.
+	 */
+	void set_table(name_id table);
+
+	/**
+	 * @brief Sets the predicates joined with AND.
+	 *
+	 * @param predicates : The predicates; must outlive the statement.
 	 */
-	void set_value(const std::wstring& value);
+	void set_predicates(std::span<const column_predicate> predicates);
 
 	/**
-	 * @brief Generates a 'SELECT * FROM <table> WHERE <column> <op> <value>;' SQL statement.
+	 * @brief Sets the values bound to the template, one per predicate other than 'IS'.
 	 *
-	 * @return The generated SQL statement as a string.
+	 * @param parameters : The values, in predicate order; must outlive the statement.
 	 */
-	std::wstring generate_sql() const override;
+	void set_parameters(std::span<const statement_parameter> parameters);
 
 	/**
-	 * @brief Generates a label for a 'FILTER' statement.
+	 * @brief Appends a 'SELECT * FROM <table> WHERE <column1> <op1> <value1> AND ...;' SQL statement.
 	 *
-	 * @return The generated label as a string.
+	 * @param out : The buffer to append to.
+	 * @param names : The pool the names were interned in.
 	 */
-	std::wstring generate_label() const override;
+	void append_sql(std::wstring& out, const name_pool& names) const override;
+	void append_label(std::wstring& out, const name_pool& names) const override;
+	void append_template(std::wstring& out, const name_pool& names) const override;
+
+	size_t sql_length(const name_pool& names) const override;
+	size_t label_length(const name_pool& names) const override;
+	size_t template_length(const name_pool& names) const override;
+	std::span<const statement_parameter> parameters() const override { return bound; }
+
+private:
+	void append_predicates(std::wstring& out, const name_pool& names, bool markers) const;
+	size_t predicates_length(const name_pool& names, bool markers) const;
+};
+
+// Class for 'BETWEEN' range filters
+class range_statement : public sql_statement {
+	name_id table{};
+	name_id column{};
+	std::wstring_view low{}, high{};				///< The literals of the bounds.
+	std::span<const statement_parameter> bound{};	///< The low and the high bound.
+
+public:
+
+	void set_table(name_id table);
+	void set_column(name_id column);
+
+	/**
+	 * @brief Sets the bounds of the range, both included.
+	 *
+	 * @param low : The literal of the low bound; must outlive the statement.
+	 * @param high : The literal of the high bound; must outlive the statement.
+	 * @param parameters : The low and high bound as bound to the template; must outlive the statement.
+	 */
+	void set_bounds(std::wstring_view low, std::wstring_view high, std::span<const statement_parameter> parameters);
+
+	/**
+	 * @brief Appends a 'SELECT * FROM <table> WHERE <column> BETWEEN <low> AND <high>;' SQL statement.
+	 *
+	 * @param out : The buffer to append to.
+	 * @param names : The pool the names were interned in.
+	 */
+	void append_sql(std::wstring& out, const name_pool& names) const override;
+	void append_label(std::wstring& out, const name_pool& names) const override;
+	void append_template(std::wstring& out, const name_pool& names) const override;
+
+	size_t sql_length(const name_pool& names) const override;
+	size_t label_length(const name_pool& names) const override;
+	size_t template_length(const name_pool& names) const override;
+	std::span<const statement_parameter> parameters() const override { return bound; }
+
+private:
+	void append_range(std::wstring& out, const name_pool& names, std::wstring_view from, std::wstring_view to) const;
+};
+
+// Class for 'IN' list filters
+class in_list_statement : public sql_statement {
+	name_id table{};
+	name_id column{};
+	std::span<const std::wstring_view> values{};	///< The literals of the list.
+	std::span<const statement_parameter> bound{};	///< The values as bound to the template, in list order.
+
+public:
+
+	void set_table(name_id table);
+	void set_column(name_id column);
+
+	/**
+	 * @brief Sets the values of the list.
+	 *
+	 * @param values : The literals; must outlive the statement.
+	 * @param parameters : The same values as bound to the template; must outlive the statement.
+	 */
+	void set_values(std::span<const std::wstring_view> values, std::span<const statement_parameter> parameters);
+
+	/**
+	 * @brief Appends a 'SELECT * FROM <table> WHERE <column> IN (<value1>, ...);' SQL statement.
+	 *
+	 * @param out : The buffer to append to.
+	 * @param names : The pool the names were interned in.
+	 */
+	void append_sql(std::wstring& out, const name_pool& names) const override;
+	void append_label(std::wstring& out, const name_pool& names) const override;
+	void append_template(std::wstring& out, const name_pool& names) const override;
+
+	size_t sql_length(const name_pool& names) const override;
+	size_t label_length(const name_pool& names) const override;
+	size_t template_length(const name_pool& names) const override;
+	std::span<const statement_parameter> parameters() const override { return bound; }
+
+private:
+	void append_list(std::wstring& out, const name_pool& names, bool markers) const;
+	size_t list_length(const name_pool& names, bool markers) const;
+};
+
+// Class for 'TOP' statements reading the first rows in the order of a column
+class top_statement : public sql_statement {
+	name_id table{};
+	name_id column{};
+	uint32_t rows{};
+	bool descending{};
+
+public:
+
+	void set_table(name_id table);
+
+	/**
+	 * @brief Sets the column the rows are ordered by.
+	 *
+	 * @param column : The ID of the column name.
+	 * @param descending : Orders from the highest value down.
+	 */
+	void set_order(name_id column, bool descending);
+
+	/**
+	 * @brief Sets the number of rows read.
+	 */
+	void set_rows(uint32_t rows);
+
+	/**
+	 * @brief Appends a 'SELECT TOP (<rows>) * FROM <table> ORDER BY <column> [DESC];' SQL statement.
+	 *
+	 * @param out : The buffer to append to.
+	 * @param names : The pool the names were interned in.
+	 */
+	void append_sql(std::wstring& out, const name_pool& names) const override;
+	void append_label(std::wstring& out, const name_pool& names) const override;
+
+	size_t sql_length(const name_pool& names) const override;
+	size_t label_length(const name_pool& names) const override;
+};
+
+// Class for joins of several tables along their foreign keys
+class join_statement : public sql_statement {
+	std::span<const name_id> tables{};				///< In join order; the table at position i is aliased 't<i>'.
+	std::span<const join_condition> conditions{};	///< Grouped by table; every table after the first has at least one.
+
+public:
+
+	/**
+	 * @brief Sets the tables joined, in join order.
+	 *
+	 * @param tables : The IDs of the qualified table names; must outlive the statement.
+	 */
+	void set_tables(std::span<const name_id> tables);
+
+	/**
+	 * @brief Sets the equalities every table is joined on.
+	 *
+	 * @param conditions : The equalities, grouped by the position of their table; must outlive the statement.
+	 */
+	void set_conditions(std::span<const join_condition> conditions);
+
+	/**
+	 * @brief Appends a 'SELECT * FROM <table1> AS t0 JOIN <table2> AS t1 ON t1.<column> = t0.<column> ...;' SQL statement.
+	 *
+	 * @param out : The buffer to append to.
+	 * @param names : The pool the names were interned in.
+	 */
+	void append_sql(std::wstring& out, const name_pool& names) const override;
+	void append_label(std::wstring& out, const name_pool& names) const override;
+
+	size_t sql_length(const name_pool& names) const override;
+	size_t label_length(const name_pool& names) const override;
 };
 
 #endif // !_SQL_STATEMENTS_H
@@ -0,0 +1,146 @@
+#include "statement_budget.h"
+#include "hashing.h"
+
+#include <algorithm>
+#include <set>
+
+// Draws per combination asked for before giving up on finding new ones
+static constexpr size_t draws_per_combination{ 4 };
+
+// Returns the number of combinations of 'size' out of 'count', or 'cap' if there are more
+static size_t combination_count(size_t count, size_t size, size_t cap) {
+    size_t combinations{ 1 };
+
+    // Up to half of the items the partial products only grow, so stopping at the cap cannot overflow; each stays exact
+    for (size_t i{}; i < std::min(size, count - size) && combinations < cap; i++) {
+        combinations = combinations * (count - i) / (i + 1);
+    }
+
+    return std::min(combinations, cap);
+}
+
+// --------------------
+// START OF BUDGETED ENUMERATOR FUNCTIONS
+// --------------------
+
+budgeted_enumerator::budgeted_enumerator(const generation_budget& budget, uint64_t seed) :
+    budget(budget), state(seed) {}
+
+void budgeted_enumerator::plan(std::span<const statement_kind> kinds) {
+    shares.fill(0);
+
+    // Shares count what a kind already took, as remaining() keeps what is not taken of them
+    size_t share{ (budget.per_table - std::min(total, budget.per_table)) / std::max<size_t>(kinds.size(), 1) };
+
+    for (statement_kind kind : kinds) {
+        shares[static_cast<size_t>(kind)] = std::min(budget.per_kind, taken[static_cast<size_t>(kind)] + share);
+    }
+}
+
+bool budgeted_enumerator::take(statement_kind kind) {
+    if (!remaining(kind)) {
+        return false;
+    }
+
+    taken[static_cast<size_t>(kind)]++;
+    total++;
+    return true;
+}
+
+// What the other kinds have not taken of their shares is not available
+size_t budgeted_enumerator::remaining(statement_kind kind) const {
+    size_t used{ taken[static_cast<size_t>(kind)] };
+    size_t kept{};
+
+    for (size_t other{}; other < statement_kind_count; other++) {
+        if (other != static_cast<size_t>(kind) && taken[other] < shares[other]) {
+            kept += shares[other] - taken[other];
+        }
+    }
+
+    if (used >= budget.per_kind || total + kept >= budget.per_table) {
+        return 0;
+    }
+
+    return std::min(budget.per_kind - used, budget.per_table - total - kept);
+}
+
+// Uniform below the bound; the modulo bias is negligible for the bounds of column counts
+size_t budgeted_enumerator::below(size_t bound) {
+    state += 0x9E3779B97F4A7C15ull;
+    return static_cast<size_t>(mix_bits(state) % bound);
+}
+
+std::vector<std::vector<size_t>> budgeted_enumerator::sample_combinations(size_t count, size_t size, size_t wanted) {
+    std::vector<std::vector<size_t>> combinations{};
+
+    if (!wanted || !size || size > count) {
+        return combinations;
+    }
+
+    // Few enough to list them all: walk them in lexicographic order
+    if (combination_count(count, size, wanted + 1) <= wanted) {
+        std::vector<size_t> combination(size);
+
+        for (size_t i{}; i < size; i++) {
+            combination[i] = i;
+        }
+
+        while (true) {
+            combinations.push_back(combination);
+
+            size_t i{ size };
+            while (i > 0 && combination[i - 1] == count - size + i - 1) {
+                i--;
+            }
+
+            if (i == 0) {
+                return combinations;
+            }
+
+            combination[i - 1]++;
+            for (size_t j{ i }; j < size; j++) {
+                combination[j] = combination[j - 1] + 1;
+            }
+        }
+    }
+
+    // Floyd's algorithm draws 'size' distinct items in 'size' steps
+    std::set<std::vector<size_t>> seen{};
+
+    for (size_t draw{}; draw < wanted * draws_per_combination && combinations.size() < wanted; draw++) {
+        std::vector<size_t> combination{};
+
+        for (size_t j{ count - size }; j < count; j++) {
+            size_t item{ below(j + 1) };
+            combination.push_back(std::find(combination.begin(), combination.end(), item) == combination.end() ? item : j);
+        }
+
+        std::sort(combination.begin(), combination.end());
+
+        if (seen.insert(combination).second) {
+            combinations.push_back(std::move(combination));
+        }
+    }
+
+    return combinations;
+}
+
+// Fisher-Yates
+std::vector<size_t> budgeted_enumerator::sample_order(size_t count) {
+    std::vector<size_t> order(count);
+
+    for (size_t i{}; i < count; i++) {
+        order[i] = i;
+    }
+
+    for (size_t i{ count }; i > 1; i--) {
+        std::swap(order[i - 1], order[below(i)]);
+    }
+
+    return order;
+}
+
+// --------------------
+// END OF BUDGETED ENUMERATOR FUNCTIONS
+// --------------------
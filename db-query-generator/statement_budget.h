@@ -0,0 +1,106 @@
+#ifndef _STATEMENT_BUDGET_H
+#define _STATEMENT_BUDGET_H
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "sql_statements.h"
+
+/* Type Definitions
+************************************************************************/
+
+// How many statements may be generated per table
+struct generation_budget {
+    size_t per_table{ 256 };    ///< Statements of every kind together.
+    size_t per_kind{ 64 };      ///< Statements of any one kind.
+    size_t max_terms{ 3 };      ///< Most columns a conjunction filters on.
+    size_t list_size{ 5 };      ///< Values of an IN list.
+    uint32_t top_rows{ 100 };   ///< Rows a TOP statement reads.
+    size_t max_join_tables{ 3 };    ///< Most tables a join reads.
+};
+
+/**
+ * @class budgeted_enumerator
+ * @brief Grants the statements of one table within a generation_budget and samples the column combinations they use.
+ *
+ * Every statement is granted by take() before it is created, so no table yields
+ * more than its budget however wide it is, and the work of generating a table is
+ * bounded by the budget instead of by the number of combinations of its columns.
+ * The kinds planned for a table each keep an even share of its budget, so the
+ * kinds generated first cannot use it all up on wide tables. Combinations and
+ * orders are drawn from a seeded generator, so a seed and a table always give
+ * the same statements.
+ */
+class budgeted_enumerator {
+    generation_budget budget{};
+    std::array<size_t, statement_kind_count> taken{};
+    std::array<size_t, statement_kind_count> shares{};  ///< Kept for each planned kind until it takes them.
+    size_t total{};
+    uint64_t state{};
+
+public:
+
+    /**
+     * @param budget : The limits of the table.
+     * @param seed : Seeds the combinations drawn.
+     */
+    budgeted_enumerator(const generation_budget& budget, uint64_t seed);
+
+    /**
+     * @brief Returns the limits of the table.
+     */
+    const generation_budget& limits() const { return budget; }
+
+    /**
+     * @brief Declares the kinds that will be generated, keeping an even share of what is left of the budget for each.
+     *
+     * Planning again once some kinds are done hands what they did not use to the kinds still to come.
+     *
+     * @param kinds : The kinds; replaces those of an earlier plan.
+     */
+    void plan(std::span<const statement_kind> kinds);
+
+    /**
+     * @brief Grants one more statement of a kind, if the budget allows it.
+     *
+     * @param kind : The kind of the statement.
+     * @return Whether the statement may be created.
+     */
+    bool take(statement_kind kind);
+
+    /**
+     * @brief Returns how many more statements of a kind would be granted.
+     *
+     * @param kind : The kind of statement.
+     */
+    size_t remaining(statement_kind kind) const;
+
+    /**
+     * @brief Returns distinct combinations of 'size' out of 'count' items.
+     *
+     * When there are no more combinations than asked for they are all returned,
+     * in lexicographic order; otherwise they are drawn at random, with a bounded
+     * number of draws, so fewer may come back.
+     *
+     * @param count : The number of items to choose from.
+     * @param size : The number of items in a combination.
+     * @param wanted : The most combinations to return.
+     * @return The combinations, each as sorted item indices.
+     */
+    std::vector<std::vector<size_t>> sample_combinations(size_t count, size_t size, size_t wanted);
+
+    /**
+     * @brief Returns the items in a random order, so those visited first are not always the same.
+     *
+     * @param count : The number of items.
+     * @return A permutation of the indices below 'count'.
+     */
+    std::vector<size_t> sample_order(size_t count);
+
+private:
+    size_t below(size_t bound);
+};
+
+#endif // !_STATEMENT_BUDGET_H
@@ -0,0 +1,355 @@
+#include "statement_generation.h"
+#include "hashing.h"
+
+#include <algorithm>
+#include <cmath>
+
+// --------------------
+// START OF STATEMENT GENERATION FUNCTIONS
+// --------------------
+
+// Returns the frequent value of a column whose frequency is closest to a fraction, by ratio, as the fractions span orders of magnitude
+static const value_frequency& closest_frequent(const column_statistics& stats, double fraction) {
+    return *std::min_element(stats.frequent.begin(), stats.frequent.end(), [&](const value_frequency& a, const value_frequency& b) {
+        return std::abs(std::log(a.fraction / fraction)) < std::abs(std::log(b.fraction / fraction));
+    });
+}
+
+// Creates a filter on a column for every selectivity, choosing its literal from the statistics of the column
+//
+// Types that allow '<=' get it at the quantile of every selectivity and '=' on their most frequent value.
+// Types only compared for equality get '=' on the frequent value closest to every selectivity.
+// Columns without frequent values get '=' on their median instead.
+static void generate_filters(sql_statement_factory& factory, budgeted_enumerator& budget, name_id table, name_id column, const data_type_info& type,
+    const column_statistics& stats, std::span<const double> selectivities) {
+    // Selectivities often land on the same value; the factory drops the repeated statements
+    auto add_filter = [&](comparison_operators comparison, std::wstring_view value) {
+        if (budget.take(statement_kind::filter)) {
+            factory.create_filter_statement(table, column, type, comparison, value);
+        }
+    };
+
+    // Nulls only match IS NULL
+    if (stats.nulls && type.allows(comparison_operators::is)) {
+        add_filter(comparison_operators::is, L"NULL");
+    }
+
+    if (stats.steps.empty() || !type.allows(comparison_operators::equals)) {
+        return;
+    }
+
+    bool ordered{ type.allows(comparison_operators::less_equals) };
+
+    if (ordered) {
+        for (double selectivity : selectivities) {
+            add_filter(comparison_operators::less_equals, stats.quantile(selectivity));
+        }
+    }
+
+    if (stats.frequent.empty()) {
+        add_filter(comparison_operators::equals, stats.quantile(0.5));
+    }
+    else if (ordered) {
+        add_filter(comparison_operators::equals, stats.frequent.front().value);
+    }
+    else {
+        for (double selectivity : selectivities) {
+            add_filter(comparison_operators::equals, closest_frequent(stats, selectivity).value);
+        }
+    }
+}
+
+// Creates a BETWEEN around the median of a column for every selectivity
+static void generate_ranges(sql_statement_factory& factory, budgeted_enumerator& budget, name_id table, name_id column, const data_type_info& type,
+    const column_statistics& stats, std::span<const double> selectivities) {
+    for (double selectivity : selectivities) {
+        std::wstring_view low{ stats.quantile(0.5 - selectivity / 2) }, high{ stats.quantile(0.5 + selectivity / 2) };
+
+        // A range of one value is an equality filter
+        if (low != high && budget.take(statement_kind::range)) {
+            factory.create_range_statement(table, column, type, low, high);
+        }
+    }
+}
+
+// Creates an IN list of the most frequent values of a column, or of values spread over its quantiles when too few repeat
+static void generate_in_list(sql_statement_factory& factory, budgeted_enumerator& budget, name_id table, name_id column, const data_type_info& type,
+    const column_statistics& stats) {
+    size_t list_size{ budget.limits().list_size };
+    std::vector<std::wstring_view> values{};
+
+    if (stats.frequent.size() >= 2) {
+        for (size_t i{}; i < std::min(list_size, stats.frequent.size()); i++) {
+            values.emplace_back(stats.frequent[i].value);
+        }
+    }
+    else {
+        for (size_t i{}; i < list_size; i++) {
+            values.emplace_back(stats.quantile((static_cast<double>(i) + 0.5) / static_cast<double>(list_size)));
+        }
+    }
+
+    if (values.size() >= 2 && budget.take(statement_kind::in_list)) {
+        factory.create_in_list_statement(table, column, type, values);
+    }
+}
+
+// Creates conjunctions of 2 up to 'max_terms' columns, sampling which columns are combined
+//
+// Each term selects the k-th root of the selectivity, so that the conjunction of k terms
+// selects about the selectivity if the columns are independent.
+static void generate_conjunctions(sql_statement_factory& factory, budgeted_enumerator& budget, const table_info& table, name_id table_name,
+    std::span<const name_id> columns, const table_statistics& stats, std::span<const double> selectivities) {
+    if (selectivities.empty()) {
+        return;
+    }
+
+    std::vector<size_t> candidates{};
+    for (size_t i{}; i < table.columns.size(); i++) {
+        if (!stats.column(i).steps.empty() && table.columns[i]->type->allows(comparison_operators::equals)) {
+            candidates.emplace_back(i);
+        }
+    }
+
+    size_t max_terms{ std::min(budget.limits().max_terms, candidates.size()) };
+    std::vector<filter_term> terms{};
+
+    for (size_t size{ 2 }; size <= max_terms; size++) {
+        // What is left is shared evenly by the sizes still to come
+        size_t wanted{ budget.remaining(statement_kind::conjunction) / (max_terms - size + 1) };
+        auto combinations{ budget.sample_combinations(candidates.size(), size, wanted) };
+
+        for (size_t i{}; i < combinations.size() && budget.take(statement_kind::conjunction); i++) {
+            double fraction{ std::pow(selectivities[i % selectivities.size()], 1.0 / static_cast<double>(size)) };
+            terms.clear();
+
+            for (size_t candidate : combinations[i]) {
+                size_t column{ candidates[candidate] };
+                const data_type_info& type{ *table.columns[column]->type };
+                const column_statistics& column_stats{ stats.column(column) };
+
+                if (type.allows(comparison_operators::less_equals)) {
+                    terms.emplace_back(filter_term{ columns[column], &type, comparison_operators::less_equals, column_stats.quantile(fraction) });
+                }
+                else {
+                    std::wstring_view value{ column_stats.frequent.empty() ? column_stats.quantile(0.5) : std::wstring_view{ closest_frequent(column_stats, fraction).value } };
+                    terms.emplace_back(filter_term{ columns[column], &type, comparison_operators::equals, value });
+                }
+            }
+
+            factory.create_conjunction_statement(table_name, terms);
+        }
+    }
+}
+
+// Joins 'start' with up to 'max_join_tables' - 1 more tables along the foreign keys of the catalog
+//
+// Paths are walked depth first, never through a table twice, taking the edges of every
+// table in a sampled order. Every path of two or more tables is one statement, so the walk
+// ends once the budget of joins is spent, and it follows a bounded number of edges per
+// statement granted, so the fan-out of a dense graph cannot make it explode. A path and its
+// reverse are the same join, so only paths ending at a table listed after 'start' are created.
+static void generate_joins(sql_statement_factory& factory, budgeted_enumerator& budget, const catalog& db, size_t start) {
+    static constexpr size_t edges_per_join{ 8 };
+
+    size_t max_tables{ budget.limits().max_join_tables };
+    size_t edges_left{ budget.remaining(statement_kind::join) * edges_per_join };
+
+    std::vector<size_t> path{ start };
+    std::vector<name_id> tables{ factory.intern(db.tables()[start]->schema + L'.' + db.tables()[start]->name) };
+    std::vector<join_condition> conditions{};
+
+    auto walk = [&](auto& self, size_t table) -> void {
+        std::span<const join_edge> edges{ db.joins(table) };
+        uint32_t position{ static_cast<uint32_t>(path.size()) };
+
+        for (size_t e : budget.sample_order(edges.size())) {
+            const join_edge& edge{ edges[e] };
+
+            if (std::find(path.begin(), path.end(), edge.table) != path.end()) {
+                continue;
+            }
+
+            if (!edges_left || !budget.remaining(statement_kind::join)) {
+                return;
+            }
+
+            edges_left--;
+
+            // The table joined holds the referenced columns when the one before it holds the key
+            const foreign_key& key{ db.foreign_keys()[edge.key] };
+            const auto& joined_columns{ edge.referencing ? key.referenced_columns : key.columns };
+            const auto& earlier_columns{ edge.referencing ? key.columns : key.referenced_columns };
+            size_t condition_count{ conditions.size() };
+
+            for (size_t c{}; c < key.columns.size(); c++) {
+                conditions.emplace_back(join_condition{ position, position - 1, factory.intern(joined_columns[c]), factory.intern(earlier_columns[c]) });
+            }
+
+            const table_info& joined{ *db.tables()[edge.table] };
+            path.push_back(edge.table);
+            tables.push_back(factory.intern(joined.schema + L'.' + joined.name));
+
+            if (edge.table > start && budget.take(statement_kind::join)) {
+                factory.create_join_statement(tables, conditions);
+            }
+
+            if (path.size() < max_tables) {
+                self(self, edge.table);
+            }
+
+            path.pop_back();
+            tables.pop_back();
+            conditions.resize(condition_count);
+        }
+    };
+
+    if (max_tables >= 2) {
+        walk(walk, start);
+    }
+}
+
+void generate_table_statements(sql_statement_factory& factory, const catalog& db, size_t index, const table_statistics* stats, std::span<const double> selectivities,
+    const generation_budget& limits, uint64_t seed) {
+    const table_info& table{ *db.tables()[index] };
+    std::vector<name_id> columns{};
+
+    // Seeded by the table rather than by the order tables are generated in, so the shards do not change the statements
+    budgeted_enumerator budget{ limits, mix_bits(seed ^ hash_text(table.schema + L'.' + table.name)) };
+
+    // Without statistics only the statements that need none are generated, and joins only where there are foreign keys
+    using enum statement_kind;
+    std::vector<statement_kind> kinds{ select_all, select, top };
+
+    if (stats) {
+        kinds.insert(kinds.end(), { filter, range, in_list, conjunction });
+    }
+
+    if (!db.joins(index).empty()) {
+        kinds.push_back(join);
+    }
+
+    budget.plan(kinds);
+
+    name_id table_name{ factory.intern(table.schema + L'.' + table.name) };
+    if (budget.take(statement_kind::select_all)) {
+        factory.create_select_all_statement(table_name);
+    }
+
+    for (const auto& column : table.columns) {
+        columns.emplace_back(factory.intern(column->name));
+    }
+
+    // Columns are visited in a sampled order, so the budget of a wide table is not spent on its first columns only
+    std::vector<size_t> order{ budget.sample_order(columns.size()) };
+
+    // Every column on its own, and the growing set of the columns visited so far, listed in table order
+    std::vector<size_t> visited{};
+    std::vector<name_id> selected{};
+
+    for (size_t k{}; k < order.size(); k++) {
+        size_t i{ order[k] };
+
+        if (budget.take(statement_kind::select)) {
+            factory.create_select_statement(table_name, std::span{ &columns[i], 1 });
+        }
+
+        visited.insert(std::upper_bound(visited.begin(), visited.end(), i), i);
+
+        if (k > 0 && k + 1 < order.size() && budget.take(statement_kind::select)) {
+            selected.clear();
+            for (size_t column : visited) {
+                selected.emplace_back(columns[column]);
+            }
+
+            factory.create_select_statement(table_name, selected);
+        }
+    }
+
+    for (size_t i : order) {
+        if (table.columns[i]->type->allows(comparison_operators::less)) {
+            for (bool descending : { false, true }) {
+                if (budget.take(statement_kind::top)) {
+                    factory.create_top_statement(table_name, columns[i], limits.top_rows, descending);
+                }
+            }
+        }
+    }
+
+    generate_joins(factory, budget, db, index);
+
+    if (!stats) {
+        return;
+    }
+
+    // The kinds generated so far are done, so what they left of their shares goes to those still to come
+    static constexpr statement_kind from_statistics[]{ filter, range, in_list, conjunction };
+    budget.plan(from_statistics);
+
+    for (size_t i : order) {
+        generate_filters(factory, budget, table_name, columns[i], *table.columns[i]->type, stats->column(i), selectivities);
+    }
+
+    for (size_t i : order) {
+        const data_type_info& type{ *table.columns[i]->type };
+        const column_statistics& column_stats{ stats->column(i) };
+
+        if (column_stats.steps.empty()) {
+            continue;
+        }
+
+        if (type.allows(comparison_operators::greater_equals) && type.allows(comparison_operators::less_equals)) {
+            generate_ranges(factory, budget, table_name, columns[i], type, column_stats, selectivities);
+        }
+
+        if (type.allows(comparison_operators::equals)) {
+            generate_in_list(factory, budget, table_name, columns[i], type, column_stats);
+        }
+    }
+
+    generate_conjunctions(factory, budget, table, table_name, columns, *stats, selectivities);
+}
+
+void generate_statements(sharded_statement_factory& factory, const catalog& db, const generation_budget& budget, uint64_t seed,
+    const std::vector<std::unique_ptr<table_statistics>>& stats, std::span<const double> selectivities) {
+    factory.generate(db.size(), [&](sql_statement_factory& shard, size_t table) {
+        generate_table_statements(shard, db, table, stats.empty() ? nullptr : stats[table].get(), selectivities, budget, seed);
+    });
+}
+
+// --------------------
+// END OF STATEMENT GENERATION FUNCTIONS
+// --------------------
+// --------------------
+// START OF STATEMENT SINK FUNCTIONS
+// --------------------
+
+void statement_sink::begin_database(const std::vector<std::shared_ptr<table_info>>& tables) {
+    this->tables = tables;
+
+    for (const auto& table : tables) {
+        samples.emplace_back(std::make_unique<row_sampler>(*table, sampling));
+        sample_of.emplace(table.get(), samples.back().get());
+    }
+}
+
+void statement_sink::write_rows(const table_info& table, const table_info& chunk) {
+    sample_of.at(&table)->offer(chunk);
+}
+
+void statement_sink::end_database() {
+    // Statistics of the samples stand in for those of the tables, as when the sources sample
+    std::vector<std::unique_ptr<table_statistics>> stats{};
+
+    for (size_t i{}; i < tables.size(); i++) {
+        stats.emplace_back(std::make_unique<table_statistics>(*tables[i], sampling.seed));
+        samples[i]->for_each_row([&](const std::vector<field_value>& fields) { stats.back()->add(fields); });
+        stats.back()->finish();
+    }
+
+    generate_statements(factory, db, budget, sampling.seed, stats, selectivities);
+}
+
+// --------------------
+// END OF STATEMENT SINK FUNCTIONS
+// --------------------
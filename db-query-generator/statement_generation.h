@@ -0,0 +1,87 @@
+#ifndef _STATEMENT_GENERATION_H
+#define _STATEMENT_GENERATION_H
+
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "catalog.h"
+#include "pipeline.h"
+#include "sampler.h"
+#include "sharded_statement_factory.h"
+#include "statement_budget.h"
+#include "statistics.h"
+
+/* Type Definitions
+************************************************************************/
+
+/**
+ * @class statement_sink
+ * @brief Samples every table as its rows stream past, then generates the statements of every table from the statistics of its sample once extraction is done.
+ *
+ * The database is extracted with the tables of the catalog, so the samples are in catalog order.
+ */
+class statement_sink : public row_sink {
+    sharded_statement_factory& factory;
+    const catalog& db;
+    generation_budget budget{};
+    sampler_options sampling{};
+    std::vector<double> selectivities{};
+    std::vector<std::shared_ptr<table_info>> tables{};
+    std::vector<std::unique_ptr<row_sampler>> samples{};
+    std::unordered_map<const table_info*, row_sampler*> sample_of{};
+
+public:
+
+    /**
+     * @param factory : The factory the statements are generated on.
+     * @param db : The catalog the tables are extracted with.
+     * @param budget : Most statements generated per table.
+     * @param sampling : The rows sampled per table, their stratification and the seed of the samples, statistics and statements.
+     * @param selectivities : The fractions of rows the filters aim to select.
+     */
+    statement_sink(sharded_statement_factory& factory, const catalog& db, const generation_budget& budget, const sampler_options& sampling, std::vector<double> selectivities) :
+        factory(factory), db(db), budget(budget), sampling(sampling), selectivities(std::move(selectivities)) {}
+
+    void begin_database(const std::vector<std::shared_ptr<table_info>>& tables) override;
+    void write_rows(const table_info& table, const table_info& chunk) override;
+    void end_database() override;
+};
+
+/* Function Declarations
+************************************************************************/
+
+/**
+ * @brief Generates the statements of a table within its budget.
+ *
+ * Generates those that only depend on its columns and its foreign keys, then, if
+ * there are statistics, filters, ranges, IN lists and conjunctions chosen from them.
+ * The statements only depend on the seed and the table, not on the shard or the
+ * order tables are generated in.
+ *
+ * @param factory : The factory to create the statements on.
+ * @param db : The catalog the table belongs to.
+ * @param index : The index of the table in the catalog.
+ * @param stats : The finished statistics of the table, or nullptr when no rows were read.
+ * @param selectivities : The fractions of rows the filters aim to select.
+ * @param limits : Most statements generated for the table.
+ * @param seed : The seed of the sampled columns and combinations.
+ */
+void generate_table_statements(sql_statement_factory& factory, const catalog& db, size_t index, const table_statistics* stats, std::span<const double> selectivities,
+    const generation_budget& limits, uint64_t seed);
+
+/**
+ * @brief Generates the statements of every table of the catalog on the factory's threads, listed in table order.
+ *
+ * @param factory : The factory to generate on.
+ * @param db : The catalog.
+ * @param budget : Most statements generated per table.
+ * @param seed : The seed of the sampled columns and combinations.
+ * @param stats : The finished statistics of every table, in table order, or empty when no rows were read.
+ * @param selectivities : The fractions of rows the filters aim to select.
+ */
+void generate_statements(sharded_statement_factory& factory, const catalog& db, const generation_budget& budget, uint64_t seed,
+    const std::vector<std::unique_ptr<table_statistics>>& stats = {}, std::span<const double> selectivities = {});
+
+#endif // !_STATEMENT_GENERATION_H
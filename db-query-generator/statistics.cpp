@@ -0,0 +1,252 @@
+#include "statistics.h"
+#include "encoding.h"
+#include "hashing.h"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <limits>
+
+static constexpr double not_a_number{ std::numeric_limits<double>::quiet_NaN() };
+static constexpr double infinity{ std::numeric_limits<double>::infinity() };
+
+// Frequent values kept per column
+static constexpr size_t frequent_value_count{ 10 };
+
+// Parses an extracted field as a number; NaN for empty text and anything else that is not one
+static double as_number(std::wstring_view text) {
+    double value{};
+    return parse_number(text, value) ? value : not_a_number;
+}
+
+// Returns a field as a number, without parsing those the row store kept as such; NaN for nulls and text that is not one
+static double as_number(const field_value& value) {
+    switch (value.null ? value_storage::text : value.kind) {
+    case value_storage::integer:
+        return static_cast<double>(value.integer);
+    case value_storage::real:
+        return value.real;
+    default:
+        return value.null ? not_a_number : as_number(value.text);
+    }
+}
+
+// Writes a number back as the shortest text that parses to it
+static std::wstring format_number(double value) {
+    char digits[32];
+    auto [end, error] { std::to_chars(digits, digits + sizeof(digits), value) };
+    return std::wstring(digits, end);
+}
+
+// Folds an array into a running minimum and maximum; NaNs fall out since every comparison with them is false.
+// Four independent lanes of compare-and-select, so compilers can use vector min/max without reordering a reduction
+static void min_max_kernel(const double* values, size_t count, double& min, double& max) {
+    double low[4]{ min, min, min, min };
+    double high[4]{ max, max, max, max };
+
+    size_t i{};
+    for (; i + 4 <= count; i += 4) {
+        for (size_t lane{}; lane < 4; lane++) {
+            low[lane] = values[i + lane] < low[lane] ? values[i + lane] : low[lane];
+            high[lane] = values[i + lane] > high[lane] ? values[i + lane] : high[lane];
+        }
+    }
+
+    for (; i < count; i++) {
+        low[0] = values[i] < low[0] ? values[i] : low[0];
+        high[0] = values[i] > high[0] ? values[i] : high[0];
+    }
+
+    min = std::min({ low[0], low[1], low[2], low[3] });
+    max = std::max({ high[0], high[1], high[2], high[3] });
+}
+
+// --------------------
+// START OF COLUMN STATISTICS FUNCTIONS
+// --------------------
+
+std::wstring_view column_statistics::quantile(double fraction) const {
+    if (steps.empty()) {
+        return {};
+    }
+
+    double step{ std::ceil(fraction * static_cast<double>(steps.size())) - 1.0 };
+    return steps[static_cast<size_t>(std::clamp(step, 0.0, static_cast<double>(steps.size() - 1)))];
+}
+
+// --------------------
+// END OF COLUMN STATISTICS FUNCTIONS
+// --------------------
+// --------------------
+// START OF TABLE STATISTICS FUNCTIONS
+// --------------------
+
+table_statistics::table_statistics(const table_info& table, uint64_t seed, size_t sample_values, size_t steps) :
+    steps(std::max<size_t>(steps, 1)) {
+    uint64_t table_seed{ mix_bits(seed ^ hash_text(table.schema + L'.' + table.name)) };
+
+    for (size_t i{}; i < table.columns.size(); i++) {
+        columns.emplace_back(column_state{
+            table.columns[i]->type->numeric(),
+            infinity, -infinity, 0, {}, reservoir{ 1, sample_values, mix_bits(table_seed + i) } });
+    }
+}
+
+// Counts a non-null value into the sketch, the sample and, for text, the range
+void table_statistics::add_value(column_state& column, std::wstring_view value) {
+    uint64_t hash{ mix_bits(hash_text(value)) };
+    size_t index{ static_cast<size_t>(hash >> (64 - hll_bits)) };
+
+    // The position of the first set bit after the index bits; the bit or-ed in caps it
+    uint8_t rank{ static_cast<uint8_t>(std::countl_zero((hash << hll_bits) | (uint64_t{ 1 } << (hll_bits - 1))) + 1) };
+    column.registers[index] = std::max(column.registers[index], rank);
+
+    column.values.offer(value);
+
+    if (!column.numeric) {
+        bool first{ column.non_null == 0 };
+
+        if (first || value < column.result.min) {
+            column.result.min = value;
+        }
+
+        if (first || value > column.result.max) {
+            column.result.max = value;
+        }
+    }
+
+    column.non_null++;
+}
+
+void table_statistics::add(const table_info& chunk) {
+    size_t row_count{ chunk.row_count() };
+    number_buffer digits{};
+
+    // Column by column, following the columnar layout of the chunk
+    for (size_t i{}; i < columns.size(); i++) {
+        column_state& column{ columns[i] };
+        column.result.rows += row_count;
+
+        for (size_t row{}; row < row_count; row++) {
+            field_value value{ chunk.field(row, i) };
+
+            if (value.null) {
+                column.result.nulls++;
+            }
+            else {
+                add_value(column, format_field(value, digits));
+            }
+        }
+
+        if (column.numeric) {
+            numbers.resize(row_count);
+
+            // Numbers the row store kept as such need no parsing
+            for (size_t row{}; row < row_count; row++) {
+                numbers[row] = as_number(chunk.field(row, i));
+            }
+
+            min_max_kernel(numbers.data(), row_count, column.min_number, column.max_number);
+        }
+    }
+}
+
+void table_statistics::add(const std::vector<field_value>& fields) {
+    number_buffer digits{};
+
+    for (size_t i{}; i < columns.size(); i++) {
+        column_state& column{ columns[i] };
+        column.result.rows++;
+
+        if (fields[i].null) {
+            column.result.nulls++;
+            continue;
+        }
+
+        add_value(column, format_field(fields[i], digits));
+
+        if (column.numeric) {
+            double number{ as_number(fields[i]) };
+            min_max_kernel(&number, 1, column.min_number, column.max_number);
+        }
+    }
+}
+
+void table_statistics::finish() {
+    for (column_state& column : columns) {
+        column_statistics& result{ column.result };
+
+        // HyperLogLog estimate, with linear counting while many registers are still empty
+        constexpr double register_count{ static_cast<double>(size_t{ 1 } << hll_bits) };
+        double sum{};
+        size_t empty_registers{};
+
+        for (uint8_t rank : column.registers) {
+            sum += std::ldexp(1.0, -static_cast<int>(rank));
+            empty_registers += rank == 0;
+        }
+
+        double estimate{ 0.7213 / (1.0 + 1.079 / register_count) * register_count * register_count / sum };
+        if (estimate <= 2.5 * register_count && empty_registers) {
+            estimate = register_count * std::log(register_count / static_cast<double>(empty_registers));
+        }
+
+        result.distinct = std::min(static_cast<uint64_t>(std::llround(estimate)), result.rows - result.nulls);
+
+        if (column.numeric && column.min_number <= column.max_number) {
+            result.min = format_number(column.min_number);
+            result.max = format_number(column.max_number);
+        }
+
+        // The sampled values in order, numbers by value and anything else as text
+        std::vector<std::wstring_view> sorted{};
+        for (size_t i{}; i < column.values.size(); i++) {
+            if (!column.numeric || !std::isnan(as_number(column.values.value(i, 0)))) {
+                sorted.emplace_back(column.values.value(i, 0));
+            }
+        }
+
+        if (column.numeric) {
+            std::sort(sorted.begin(), sorted.end(), [](std::wstring_view a, std::wstring_view b) { return as_number(a) < as_number(b); });
+        }
+        else {
+            std::sort(sorted.begin(), sorted.end());
+        }
+
+        // Equi-depth: every bucket holds the same share of the sampled values
+        result.steps.clear();
+        size_t step_count{ std::min(steps, sorted.size()) };
+
+        for (size_t i{ 1 }; i <= step_count; i++) {
+            result.steps.emplace_back(sorted[i * sorted.size() / step_count - 1]);
+        }
+
+        // Runs of equal values in the sorted sample are their frequencies
+        result.frequent.clear();
+        double non_null_fraction{ 1.0 - result.null_fraction() };
+
+        for (size_t first{}; first < sorted.size();) {
+            size_t last{ first + 1 };
+            while (last < sorted.size() && sorted[last] == sorted[first]) {
+                last++;
+            }
+
+            if (last - first > 1) {
+                double fraction{ static_cast<double>(last - first) / static_cast<double>(sorted.size()) * non_null_fraction };
+                result.frequent.emplace_back(value_frequency{ std::wstring{ sorted[first] }, fraction });
+            }
+
+            first = last;
+        }
+
+        std::stable_sort(result.frequent.begin(), result.frequent.end(), [](const value_frequency& a, const value_frequency& b) { return a.fraction > b.fraction; });
+        if (result.frequent.size() > frequent_value_count) {
+            result.frequent.resize(frequent_value_count);
+        }
+    }
+}
+
+// --------------------
+// END OF TABLE STATISTICS FUNCTIONS
+// --------------------
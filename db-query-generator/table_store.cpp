@@ -0,0 +1,256 @@
+#include "table_store.h"
+#include "encoding.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+// Widens the ASCII of a formatted number into the buffer
+static std::wstring_view widen(const char* first, const char* last, number_buffer& digits) {
+    std::copy(first, last, digits.begin());
+    return { digits.data(), static_cast<size_t>(last - first) };
+}
+
+// Parses an integer; false unless formatting it gives the same text back, so storing it loses nothing
+static bool parse_integer(std::wstring_view text, int64_t& number) {
+    // No leading zeros and no '-0'; parse_number already refuses '+' and spaces
+    size_t first_digit{ text.starts_with(L'-') ? size_t{ 1 } : size_t{ 0 } };
+    if ((text.size() > first_digit + 1 && text[first_digit] == L'0') || (first_digit && text == L"-0")) {
+        return false;
+    }
+
+    return parse_number(text, number);
+}
+
+// Parses a real; false unless its shortest form is the same text, so storing it loses nothing
+static bool parse_real(std::wstring_view text, double& number) {
+    if (!parse_number(text, number) || !std::isfinite(number)) {
+        return false;
+    }
+
+    char shortest[32];
+    auto [shortest_end, shortest_error] { std::to_chars(shortest, shortest + sizeof(shortest), number) };
+    return std::equal(shortest, shortest_end, text.begin(), text.end());
+}
+
+// Appends a row to a null bitmap
+static void push_null_bit(std::vector<uint64_t>& nulls, size_t row, bool null) {
+    if (row % 64 == 0) {
+        nulls.push_back(0);
+    }
+
+    if (null) {
+        nulls.back() |= uint64_t{ 1 } << (row % 64);
+    }
+}
+
+// Appends a field to an integer column; false, leaving the column unchanged, if it does not fit
+static bool add_integer(column_info& column, const field_value& value) {
+    int64_t number{};
+
+    if (!value.null) {
+        if (value.kind == value_storage::integer) {
+            number = value.integer;
+        }
+        else if (value.kind != value_storage::text || !parse_integer(value.text, number)) {
+            return false;
+        }
+    }
+
+    push_null_bit(column.nulls, column.integers.size(), value.null);
+    column.integers.push_back(number);
+    return true;
+}
+
+// Appends a field to a real column; false, leaving the column unchanged, if it does not fit
+static bool add_real(column_info& column, const field_value& value) {
+    double number{};
+
+    if (!value.null) {
+        if (value.kind == value_storage::real) {
+            number = value.real;
+        }
+        // Integers beyond 2^53 would not round trip
+        else if (value.kind == value_storage::integer && value.integer >= -(int64_t{ 1 } << 53) && value.integer <= (int64_t{ 1 } << 53)) {
+            number = static_cast<double>(value.integer);
+        }
+        else if (value.kind != value_storage::text || !parse_real(value.text, number)) {
+            return false;
+        }
+    }
+
+    push_null_bit(column.nulls, column.reals.size(), value.null);
+    column.reals.push_back(number);
+    return true;
+}
+
+// Returns a stored field without converting it
+static field_value stored_field(const column_info& column, const std::vector<wchar_t>& arena, size_t row) {
+    switch (column.storage) {
+    case value_storage::integer:
+        return (column.nulls[row / 64] >> (row % 64)) & 1 ? field_value::null_field() : field_value::integer_field(column.integers[row]);
+    case value_storage::real:
+        return (column.nulls[row / 64] >> (row % 64)) & 1 ? field_value::null_field() : field_value::real_field(column.reals[row]);
+    default:
+        if ((column.nulls[row / 64] >> (row % 64)) & 1) {
+            return field_value::null_field();
+        }
+
+        const string_ref& ref{ column.values[row] };
+        return field_value::text_field(std::wstring_view{ arena.data() + ref.offset, ref.length });
+    }
+}
+
+std::wstring_view format_field(const field_value& value, number_buffer& digits) {
+    if (value.null) {
+        return {};
+    }
+
+    char ascii[32];
+
+    switch (value.kind) {
+    case value_storage::integer: {
+        auto [end, error] { std::to_chars(ascii, ascii + sizeof(ascii), value.integer) };
+        return widen(ascii, end, digits);
+    }
+    case value_storage::real: {
+        auto [end, error] { std::to_chars(ascii, ascii + sizeof(ascii), value.real) };
+        return widen(ascii, end, digits);
+    }
+    default:
+        return value.text;
+    }
+}
+
+// --------------------
+// START OF ROW VIEW FUNCTIONS
+// --------------------
+
+size_t row_view::size() const {
+    return table->columns.size();
+}
+
+field_view row_view::operator[](size_t column) const {
+    return field_view{ table->field(index, column), table->columns[column].get() };
+}
+
+// --------------------
+// END OF ROW VIEW FUNCTIONS
+// --------------------
+// --------------------
+// START OF TABLE FUNCTIONS
+// --------------------
+
+// Copies the value into the arena and records where it lives
+void table_info::append_text(column_info& column, std::wstring_view value) {
+    column.values.push_back(string_ref{ arena.size(), static_cast<uint32_t>(value.size()) });
+    arena.insert(arena.end(), value.begin(), value.end());
+}
+
+// Moves the values of a numeric column to the arena, once a value did not fit its type; the null bitmap stays as it is
+void table_info::demote(column_info& column) {
+    size_t count{ column.storage == value_storage::integer ? column.integers.size() : column.reals.size() };
+    number_buffer digits{};
+
+    column.values.clear();
+    column.values.reserve(std::max(count, column.integers.capacity() + column.reals.capacity()));
+
+    for (size_t row{}; row < count; row++) {
+        append_text(column, format_field(stored_field(column, arena, row), digits));
+    }
+
+    column.integers.clear();
+    column.reals.clear();
+    column.storage = value_storage::text;
+}
+
+void table_info::add_field(size_t column, const field_value& value) {
+    column_info& target{ *columns[column] };
+
+    if ((target.storage == value_storage::integer && add_integer(target, value)) ||
+        (target.storage == value_storage::real && add_real(target, value))) {
+        return;
+    }
+
+    if (target.storage != value_storage::text) {
+        demote(target);
+    }
+
+    number_buffer digits{};
+    push_null_bit(target.nulls, target.values.size(), value.null);
+    append_text(target, format_field(value, digits));
+}
+
+void table_info::reserve(size_t row_count, size_t char_count) {
+    for (const auto& column : columns) {
+        switch (column->storage) {
+        case value_storage::integer:
+            column->integers.reserve(row_count);
+            column->nulls.reserve((row_count + 63) / 64);
+            break;
+        case value_storage::real:
+            column->reals.reserve(row_count);
+            column->nulls.reserve((row_count + 63) / 64);
+            break;
+        default:
+            column->values.reserve(row_count);
+            column->nulls.reserve((row_count + 63) / 64);
+            break;
+        }
+    }
+
+    arena.reserve(char_count);
+}
+
+void table_info::copy_layout(const table_info& other) {
+    name = other.name;
+    schema = other.schema;
+    columns.clear();
+
+    for (const auto& column : other.columns) {
+        columns.emplace_back(std::make_shared<column_info>(column_info{ column->name, column->data_type }));
+        columns.back()->ordinal = column->ordinal;
+        columns.back()->primary_key = column->primary_key;
+    }
+
+    arena.clear();
+    rows = 0;
+}
+
+// Columns that fell back to text get their typed storage back for the next rows
+void table_info::clear_rows() {
+    for (const auto& column : columns) {
+        column->values.clear();
+        column->integers.clear();
+        column->reals.clear();
+        column->nulls.clear();
+        column->storage = column->type->storage;
+    }
+
+    arena.clear();
+    rows = 0;
+}
+
+field_value table_info::field(size_t row, size_t column) const {
+    return stored_field(*columns[column], arena, row);
+}
+
+std::wstring_view table_info::value(size_t row, size_t column, number_buffer& digits) const {
+    return format_field(field(row, column), digits);
+}
+
+size_t table_info::memory_usage() const {
+    size_t bytes{ arena.capacity() * sizeof(wchar_t) };
+
+    for (const auto& column : columns) {
+        bytes += column->values.capacity() * sizeof(string_ref);
+        bytes += column->integers.capacity() * sizeof(int64_t) + column->reals.capacity() * sizeof(double);
+        bytes += column->nulls.capacity() * sizeof(uint64_t);
+    }
+
+    return bytes;
+}
+
+// --------------------
+// END OF TABLE FUNCTIONS
+// --------------------
@@ -0,0 +1,263 @@
+#ifndef _TABLE_STORE_H
+#define _TABLE_STORE_H
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "data_types.h"
+
+/* Type Definitions
+************************************************************************/
+struct table_info;
+
+/**
+ * @struct string_ref
+ * @brief Location of a single value inside a table's character arena.
+ */
+struct string_ref {
+    uint64_t offset{};  ///< Index of the first character in the arena.
+    uint32_t length{};  ///< Number of characters in the value.
+};
+
+/**
+ * @struct field_value
+ * @brief A single field, either as the number it holds or as text.
+ *
+ * NULL is a flag of its own, so an empty string is a value like any other.
+ */
+struct field_value {
+    value_storage kind{};       ///< Which of integer, real and text holds the value.
+    bool null{};
+    int64_t integer{};
+    double real{};
+    std::wstring_view text{};
+
+    static field_value null_field() { return field_value{ value_storage::text, true }; }
+    static field_value integer_field(int64_t value) { return field_value{ value_storage::integer, false, value }; }
+    static field_value real_field(double value) { return field_value{ value_storage::real, false, 0, value }; }
+    static field_value text_field(std::wstring_view value) { return field_value{ value_storage::text, false, 0, 0.0, value }; }
+
+    // For text from sources that cannot tell them apart, such as CSV files: an empty field is NULL
+    static field_value text_or_null_field(std::wstring_view value) { return value.empty() ? null_field() : text_field(value); }
+};
+
+// Room for the text of any number, so formatting one needs no allocation
+using number_buffer = std::array<wchar_t, 32>;
+
+/**
+ * @struct column_info
+ * @brief A struct that contains the metadata and the values of a database column.
+ *
+ * Values are stored column-wise, in one contiguous buffer per column chosen by the
+ * type: integers and reals are kept as native numbers, anything else as references
+ * into the character arena owned by the parent table_info, and every column has a
+ * null bitmap, so NULLs and empty strings stay apart. A
+ * numeric column falls back to text for the rest of the chunk when a value does not
+ * fit, e.g. text a CSV file holds in an int column.
+ */
+struct column_info {
+
+    column_info(std::wstring name, std::wstring data_type) :
+        name(name), data_type(data_type), type(&lookup_type(this->data_type)), storage(type->storage) {}
+
+    std::wstring name{}, data_type{};
+    const data_type_info* type{};       ///< The registry entry of data_type, resolved once so values never compare type names.
+    value_storage storage{};            ///< Which of the buffers below holds the values.
+    int ordinal{};                      ///< 1-based position of the column in its table.
+    bool primary_key{};                 ///< Whether the column is part of the primary key of its table.
+    std::vector<string_ref> values{};   ///< Text storage: one entry per row, in row order.
+    std::vector<int64_t> integers{};    ///< Integer storage: one entry per row, in row order.
+    std::vector<double> reals{};        ///< Real storage: one entry per row, in row order.
+    std::vector<uint64_t> nulls{};      ///< One bit per row, set for NULL, whatever the storage.
+};
+
+/**
+ * @struct field_view
+ * @brief A lightweight, non-owning view of a single field.
+ *
+ * @var field_view::value
+ * Member 'value' holds the number or points into the character arena of the table the field belongs to.
+ *
+ * @var field_view::column
+ * Member 'column' is the column_info the field belongs to.
+ */
+struct field_view {
+    field_value value{};
+    const column_info* column{};
+};
+
+/**
+ * @class row_view
+ * @brief A lightweight, non-owning view of a single row, addressed by index.
+ *
+ * Only valid while the table it was taken from is alive and unmodified.
+ */
+class row_view {
+    const table_info* table{};
+    size_t index{};
+
+public:
+
+    class iterator {
+        const row_view* row{};
+        size_t column{};
+
+    public:
+        iterator(const row_view* row, size_t column) : row(row), column(column) {}
+
+        field_view operator*() const { return (*row)[column]; }
+        iterator& operator++() { column++; return *this; }
+        bool operator==(const iterator& other) const { return column == other.column; }
+        bool operator!=(const iterator& other) const { return column != other.column; }
+    };
+
+    row_view(const table_info* table, size_t index) : table(table), index(index) {}
+
+    /**
+     * @brief Returns the index of the row inside its table.
+     */
+    size_t position() const { return index; }
+
+    /**
+     * @brief Returns the number of fields in the row.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Returns a view of the field in the given column.
+     *
+     * @param column : The index of the column.
+     */
+    field_view operator[](size_t column) const;
+
+    iterator begin() const { return iterator{ this, 0 }; }
+    iterator end() const { return iterator{ this, size() }; }
+};
+
+/**
+ * @struct table_info
+ * @brief A columnar in-memory store for a database table.
+ *
+ * Every column keeps its own contiguous buffer of numbers or string_ref entries,
+ * while the characters of all text values live in a single arena shared by the
+ * whole table. Appending a row therefore costs no per-field heap allocation, and
+ * numbers are only turned into text when a writer asks for it.
+ */
+struct table_info {
+
+    table_info(std::wstring name, std::wstring schema) :
+        name(name), schema(schema) {}
+
+    std::wstring name{}, schema{};
+    std::vector<std::shared_ptr<column_info>> columns{};
+    std::vector<wchar_t> arena{};   ///< Characters of every value in the table.
+    size_t row_estimate{};          ///< Expected number of rows, as reported by the source.
+
+    /**
+     * @brief Appends the value of the next field to the given column.
+     *
+     * Numeric columns parse the text, and keep it as text when it is not a number
+     * that formats back to the same text.
+     *
+     * @param column : The index of the column.
+     * @param value : The value of the field, as text; an empty one is an empty string, not NULL.
+     */
+    void add_field(size_t column, std::wstring_view value) { add_field(column, field_value::text_field(value)); }
+
+    /**
+     * @brief Appends the value of the next field to the given column.
+     *
+     * @param column : The index of the column.
+     * @param value : The value of the field.
+     */
+    void add_field(size_t column, const field_value& value);
+
+    /**
+     * @brief Marks the row built with add_field() as complete.
+     */
+    void finish_row() { rows++; }
+
+    /**
+     * @brief Reserves room for the given number of rows and characters.
+     *
+     * @param row_count : The expected number of rows.
+     * @param char_count : The expected number of characters across all values.
+     */
+    void reserve(size_t row_count, size_t char_count);
+
+    /**
+     * @brief Makes this table an empty copy of another table's name and columns.
+     *
+     * @param other : The table whose layout to copy.
+     */
+    void copy_layout(const table_info& other);
+
+    /**
+     * @brief Releases every row while keeping the column definitions.
+     */
+    void clear_rows();
+
+    /**
+     * @brief Returns the number of complete rows.
+     */
+    size_t row_count() const { return rows; }
+
+    /**
+     * @brief Returns a view of the row at the given index.
+     */
+    row_view row(size_t index) const { return row_view{ this, index }; }
+
+    /**
+     * @brief Returns the field stored in the given row and column, without converting it.
+     */
+    field_value field(size_t row, size_t column) const;
+
+    /**
+     * @brief Returns the value stored in the given row and column, as text.
+     *
+     * @param row : The index of the row.
+     * @param column : The index of the column.
+     * @param digits : Where numbers are formatted; the view points into it until its next use.
+     */
+    std::wstring_view value(size_t row, size_t column, number_buffer& digits) const;
+
+    /**
+     * @brief Returns the number of bytes held by the row storage of the table.
+     */
+    size_t memory_usage() const;
+
+private:
+    size_t rows{};
+
+    void append_text(column_info& column, std::wstring_view value);
+    void demote(column_info& column);
+};
+
+/**
+ * @struct foreign_key
+ * @brief A foreign key constraint: columns of one table that reference the key of another.
+ */
+struct foreign_key {
+    std::wstring name{};
+    std::wstring schema{}, table{};                         ///< The referencing table.
+    std::wstring referenced_schema{}, referenced_table{};
+    std::vector<std::wstring> columns{};                    ///< The referencing columns, in key order.
+    std::vector<std::wstring> referenced_columns{};         ///< The column every referencing column points at.
+};
+
+/* Function Declarations
+************************************************************************/
+
+/**
+ * @brief Returns a field as text, the way the row store writes it.
+ *
+ * @param value : The field.
+ * @param digits : Where numbers are formatted; the view points into it until its next use.
+ */
+std::wstring_view format_field(const field_value& value, number_buffer& digits);
+
+#endif // !_TABLE_STORE_H
@@ -0,0 +1,344 @@
+#include "xml_output.h"
+#include "encoding.h"
+
+#include <deque>
+#include <stdexcept>
+#include <unordered_map>
+
+void append_xml_escaped(std::string& out, std::wstring_view text, xml_escape mode) {
+    size_t run{};
+
+    for (size_t i{}; i < text.size(); i++) {
+        const char* entity{};
+
+        switch (text[i]) {
+        case L'&': entity = "&amp;"; break;
+        case L'<': entity = "&lt;"; break;
+        case L'>': entity = mode == xml_escape::text ? "&gt;" : nullptr; break;
+        case L'"': entity = mode == xml_escape::attribute ? "&quot;" : nullptr; break;
+        case L'\t': entity = mode == xml_escape::attribute ? "&#x9;" : nullptr; break;
+        case L'\n': entity = mode == xml_escape::attribute ? "&#xA;" : nullptr; break;
+        case L'\r': entity = mode == xml_escape::attribute ? "&#xD;" : nullptr; break;
+        default: break;
+        }
+
+        if (entity) {
+            append_utf8(out, text.substr(run, i - run));
+            out.append(entity);
+            run = i + 1;
+        }
+    }
+
+    append_utf8(out, text.substr(run));
+}
+
+// --------------------
+// START OF DATABASE WRITER FUNCTIONS
+// --------------------
+
+xml_database_writer::xml_database_writer(std::filesystem::path file_path) :
+    file_path(std::move(file_path)) {}
+
+xml_database_writer::~xml_database_writer() {
+    // Only left behind when extraction failed part way
+    for (size_t i{}; i < states.size(); i++) {
+        if (states[i]) {
+            states[i]->body.reset();
+
+            std::error_code error{};
+            std::filesystem::remove(spill_path(i), error);
+        }
+    }
+}
+
+std::filesystem::path xml_database_writer::spill_path(size_t table) const {
+    std::filesystem::path path{ file_path };
+    path += "." + std::to_string(table) + ".part";
+    return path;
+}
+
+void xml_database_writer::begin_database(const std::vector<std::shared_ptr<table_info>>& tables) {
+    this->tables = tables;
+    states.clear();
+    states.resize(tables.size());
+    table_index.clear();
+    next_table = 0;
+
+    for (size_t i{}; i < tables.size(); i++) {
+        table_index.emplace(tables[i].get(), i);
+    }
+
+    output.open(file_path);
+
+    std::string& out{ output.buffer() };
+    out.append("<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\" ?>");
+    out.append("<database number_of_tables=\"").append(std::to_string(tables.size()));
+    out.append(tables.empty() ? "\"/>" : "\">");
+}
+
+void xml_database_writer::begin_table(const table_info& table) {
+    size_t index{ table_index.at(&table) };
+
+    auto state{ std::make_unique<table_state>() };
+    state->body = std::make_unique<output_file>();
+    state->body->open(spill_path(index));
+
+    std::string& out{ state->body->buffer() };
+
+    for (const auto& column : table.columns) {
+        out.append("<column name=\"");
+        append_xml_escaped(out, column->name, xml_escape::attribute);
+        out.append("\" type=\"");
+        append_xml_escaped(out, column->data_type, xml_escape::attribute);
+        out.append("\"/>");
+
+        // The column name repeats on every field, so escape it once
+        std::string prefix{ "<field parent_column=\"" };
+        append_xml_escaped(prefix, column->name, xml_escape::attribute);
+        prefix.append("\" value=\"");
+        state->field_prefixes.emplace_back(std::move(prefix));
+    }
+
+    states[index] = std::move(state);
+}
+
+void xml_database_writer::write_rows(const table_info& table, const table_info& chunk) {
+    table_state& state{ *states[table_index.at(&table)] };
+    std::string& out{ state.body->buffer() };
+    number_buffer digits{};
+
+    for (size_t i{}; i < chunk.row_count(); i++) {
+        if (chunk.columns.empty()) {
+            out.append("<row/>");
+            continue;
+        }
+
+        out.append("<row>");
+
+        for (size_t c{}; c < chunk.columns.size(); c++) {
+            out.append(state.field_prefixes[c]);
+            append_xml_escaped(out, chunk.value(i, c, digits), xml_escape::attribute);
+            out.append("\"/>");
+        }
+
+        out.append("</row>");
+        state.body->commit();
+    }
+}
+
+void xml_database_writer::end_table(const table_info& table, size_t row_count) {
+    table_state& state{ *states[table_index.at(&table)] };
+
+    state.row_count = row_count;
+    state.body->close();
+    state.body.reset();
+    state.field_prefixes = {};
+    state.done = true;
+
+    append_finished_tables();
+}
+
+// Moves every finished table at the front of the queue into the document
+void xml_database_writer::append_finished_tables() {
+    while (next_table < states.size() && states[next_table] && states[next_table]->done) {
+        const table_info& table{ *tables[next_table] };
+        std::filesystem::path body_path{ spill_path(next_table) };
+        bool empty{ std::filesystem::file_size(body_path) == 0 };
+
+        std::string& out{ output.buffer() };
+        out.append("<table name=\"");
+        append_xml_escaped(out, table.schema + L'.' + table.name, xml_escape::attribute);
+        out.append("\" number_of_columns=\"").append(std::to_string(table.columns.size()));
+        out.append("\" number_of_rows=\"").append(std::to_string(states[next_table]->row_count));
+        out.append(empty ? "\"/>" : "\">");
+
+        output.append_file(body_path);
+
+        if (!empty) {
+            output.write("</table>");
+        }
+
+        std::filesystem::remove(body_path);
+        states[next_table].reset();
+        next_table++;
+    }
+}
+
+void xml_database_writer::end_database() {
+    if (next_table != tables.size()) {
+        throw std::runtime_error{ "Database XML ended before every table was written" };
+    }
+
+    if (!tables.empty()) {
+        output.write("</database>");
+    }
+
+    output.close();
+}
+
+// --------------------
+// END OF DATABASE WRITER FUNCTIONS
+// --------------------
+// --------------------
+// START OF STATEMENT SET FUNCTIONS
+// --------------------
+
+// The statements of a table sharing a template, with the escaped '<parameters>' elements of each
+struct template_batch {
+    std::wstring query{}, label{};
+    std::vector<std::wstring> types{};
+    std::string parameters{};
+    size_t count{};
+};
+
+// Appends '<indent><tag>text</tag>' on a line of its own
+static void append_text_element(std::string& out, std::string_view indent, std::string_view tag, std::wstring_view text) {
+    out.append(indent).append("<").append(tag).append(">");
+    append_xml_escaped(out, text, xml_escape::text);
+    out.append("</").append(tag).append(">\n");
+}
+
+// Opens an element with a count attribute on a line of its own, or writes it empty when the count is 0; returns whether it was opened
+static bool append_counted_start(std::string& out, std::string_view indent, std::string_view tag, size_t count) {
+    out.append(indent).append("<").append(tag).append(" count=\"").append(std::to_string(count));
+    out.append(count ? "\">\n" : "\"/>\n");
+    return count != 0;
+}
+
+// Writes the batches of a table to the spill file, in the order their templates first appeared
+static void write_batches(output_file& spill, std::deque<template_batch>& batches) {
+    std::string& out{ spill.buffer() };
+
+    for (const template_batch& batch : batches) {
+        out.append("    <template>\n");
+        append_text_element(out, "      ", "query", batch.query);
+        append_text_element(out, "      ", "label", batch.label);
+
+        if (append_counted_start(out, "      ", "parameter_types", batch.types.size())) {
+            for (const auto& type : batch.types) {
+                append_text_element(out, "        ", "type", type);
+            }
+
+            out.append("      </parameter_types>\n");
+        }
+
+        append_counted_start(out, "      ", "batch", batch.count);
+        out.append(batch.parameters);
+        out.append("      </batch>\n");
+        out.append("    </template>\n");
+        spill.commit();
+    }
+
+    batches.clear();
+}
+
+size_t write_statement_set(const std::filesystem::path& file_path, const std::set<std::wstring>& schemas,
+    const std::vector<std::shared_ptr<table_info>>& tables, const sharded_statement_factory& factory) {
+    std::filesystem::path spill_path{ file_path };
+    spill_path += ".templates.part";
+
+    output_file output{};
+    output.open(file_path);
+
+    std::string& out{ output.buffer() };
+    out.append("<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\" ?>\n<sql_info>\n");
+
+    if (append_counted_start(out, "  ", "schemas", schemas.size())) {
+        for (const auto& schema : schemas) {
+            append_text_element(out, "    ", "schema", schema);
+        }
+
+        out.append("  </schemas>\n");
+    }
+
+    if (append_counted_start(out, "  ", "tables", tables.size())) {
+        for (const auto& table : tables) {
+            append_text_element(out, "    ", "table", table->schema + L'.' + table->name);
+        }
+
+        out.append("  </tables>\n");
+    }
+
+    output.commit();
+
+    size_t template_count{};
+
+    try {
+        output_file spill{};
+        spill.open(spill_path);
+
+        // The batches of the table being streamed, found by their template; a deque keeps the keys in place as it grows
+        std::deque<template_batch> batches{};
+        std::unordered_map<std::wstring_view, size_t> batch_index{};
+        size_t batch_table{};
+
+        bool open{ append_counted_start(out, "  ", "statements", factory.size() - factory.templated_count()) };
+
+        for (const rendered_statement& statement : factory.stream()) {
+            if (statement.template_sql.empty()) {
+                out.append("    <statement>\n");
+                append_text_element(out, "      ", "query", statement.sql);
+                append_text_element(out, "      ", "label", statement.label);
+                out.append("    </statement>\n");
+                output.commit();
+                continue;
+            }
+
+            if (statement.table != batch_table) {
+                template_count += batches.size();
+                batch_index.clear();
+                write_batches(spill, batches);
+                batch_table = statement.table;
+            }
+
+            auto found{ batch_index.find(statement.template_sql) };
+            if (found == batch_index.end()) {
+                template_batch& batch{ batches.emplace_back(template_batch{ std::wstring{ statement.template_sql }, std::wstring{ statement.label } }) };
+
+                for (const auto& parameter : statement.parameters) {
+                    batch.types.emplace_back(parameter.type->name);
+                }
+
+                found = batch_index.emplace(batch.query, batches.size() - 1).first;
+            }
+
+            template_batch& batch{ batches[found->second] };
+            batch.parameters.append("        <parameters>\n");
+
+            for (const auto& parameter : statement.parameters) {
+                append_text_element(batch.parameters, "          ", "value", parameter.value);
+            }
+
+            batch.parameters.append("        </parameters>\n");
+            batch.count++;
+        }
+
+        template_count += batches.size();
+        write_batches(spill, batches);
+        spill.close();
+
+        if (open) {
+            out.append("  </statements>\n");
+        }
+
+        if (append_counted_start(out, "  ", "templates", template_count)) {
+            output.append_file(spill_path);
+            output.write("  </templates>\n");
+        }
+
+        output.write("</sql_info>\n");
+        output.close();
+    }
+    catch (...) {
+        std::error_code error{};
+        std::filesystem::remove(spill_path, error);
+        throw;
+    }
+
+    std::filesystem::remove(spill_path);
+    return template_count;
+}
+
+// --------------------
+// END OF STATEMENT SET FUNCTIONS
+// --------------------
@@ -0,0 +1,98 @@
+#ifndef _XML_OUTPUT_H
+#define _XML_OUTPUT_H
+
+#include <set>
+#include <unordered_map>
+
+#include "exporter.h"
+#include "output_file.h"
+#include "sharded_statement_factory.h"
+
+/* Type Definitions
+************************************************************************/
+
+// Characters that have to be escaped differ between text and attribute values
+enum struct xml_escape {
+    text,       ///< Escapes & < >
+    attribute   ///< Escapes & < " and the whitespace characters tab, LF and CR
+};
+
+/**
+ * @brief Appends text as escaped UTF-8, the way the Xerces serializer escapes it.
+ *
+ * @param out : The string to append to.
+ * @param text : The text to escape.
+ * @param mode : Whether the text is element content or an attribute value.
+ */
+void append_xml_escaped(std::string& out, std::wstring_view text, xml_escape mode);
+
+/**
+ * @class xml_database_writer
+ * @brief Streams the extracted tables to a '<database>' XML document.
+ *
+ * Writes the same bytes as serializing the equivalent Xerces DOM without pretty
+ * printing, without ever holding more than a buffer of it in memory. The row count
+ * of a table is only known once the table is done, so each table is written to a
+ * spill file next to the output and appended to the document, in catalog order,
+ * as soon as every table before it has been appended.
+ */
+class xml_database_writer : public snapshot_exporter {
+    struct table_state {
+        std::unique_ptr<output_file> body{};        ///< Open while the table is being extracted.
+        std::vector<std::string> field_prefixes{};  ///< '<field parent_column="..." value="' per column.
+        size_t row_count{};
+        bool done{};
+    };
+
+    std::filesystem::path file_path{};
+    output_file output{};
+    std::unordered_map<const table_info*, size_t> table_index{};
+    std::vector<std::shared_ptr<table_info>> tables{};
+    std::vector<std::unique_ptr<table_state>> states{};
+    size_t next_table{};
+
+public:
+
+    /**
+     * @param file_path : The file to write the document to.
+     */
+    xml_database_writer(std::filesystem::path file_path);
+    ~xml_database_writer() override;
+
+    const std::filesystem::path& path() const override { return file_path; }
+
+    void begin_database(const std::vector<std::shared_ptr<table_info>>& tables) override;
+    void begin_table(const table_info& table) override;
+    void write_rows(const table_info& table, const table_info& chunk) override;
+    void end_table(const table_info& table, size_t row_count) override;
+    void end_database() override;
+
+private:
+    std::filesystem::path spill_path(size_t table) const;
+    void append_finished_tables();
+};
+
+/* Function Declarations
+************************************************************************/
+
+/**
+ * @brief Streams the generated statements to a 'statements.xml' document, rendering them one at a time.
+ *
+ * Lists the schemas and tables, then every statement without parameters under
+ * '<statements>', then every template under '<templates>' with the parameter sets
+ * of its statements as one batch, so a replay prepares it once. A template only
+ * ever holds statements of one table, so the batches of a table are gathered while
+ * its statements stream past and then written to a spill file next to the document,
+ * which is appended once the number of templates is known. Memory is bounded by the
+ * statements of one table rather than by the whole set.
+ *
+ * @param file_path : The file to write the document to.
+ * @param schemas : The schema names to list.
+ * @param tables : The tables to list, in the order the statements were generated for them.
+ * @param factory : The generated statements.
+ * @return The number of templates written.
+ */
+size_t write_statement_set(const std::filesystem::path& file_path, const std::set<std::wstring>& schemas,
+    const std::vector<std::shared_ptr<table_info>>& tables, const sharded_statement_factory& factory);
+
+#endif // !_XML_OUTPUT_H